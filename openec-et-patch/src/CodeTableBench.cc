@@ -0,0 +1,67 @@
+#include "ec/CodeTable.hh"
+#include "ec/ETHTEC.hh"
+#include "ec/HTEC.hh"
+
+#include "inc/include.hh"
+#include "util/RedisUtil.hh"
+
+#include <unistd.h>
+
+using namespace std;
+
+void usage() {
+  cout << "usage: ./CodeTableBench HTEC|ETHTEC n k w rounds [param]" << endl;
+}
+
+ECBase* construct(string cls, int n, int k, int w, vector<string> param) {
+  if (cls == "HTEC") return new HTEC(n, k, w, -1, param);
+  return new ETHTEC(n, k, w, -1, param);
+}
+
+// average construction time over rounds, tables in memory are dropped before each one if cold
+double benchConstruct(string cls, int n, int k, int w, vector<string> param, int rounds, bool cold) {
+  struct timeval time1, time2;
+  double total = 0;
+  for (int i=0; i<rounds; i++) {
+    if (cold) CodeTable::clear();
+    gettimeofday(&time1, NULL);
+    ECBase* ec = construct(cls, n, k, w, param);
+    gettimeofday(&time2, NULL);
+    total += RedisUtil::duration(time1, time2);
+    delete ec;
+  }
+  return total / rounds;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 6 || (string(argv[1]) != "HTEC" && string(argv[1]) != "ETHTEC")) {
+    usage();
+    return -1;
+  }
+  string cls(argv[1]);
+  int n = atoi(argv[2]);
+  int k = atoi(argv[3]);
+  int w = atoi(argv[4]);
+  int rounds = atoi(argv[5]);
+  vector<string> param;
+  for (int i=6; i<argc; i++) param.push_back(argv[i]);
+
+  // 1. every construction searches the tables, as before they are memoized
+  CodeTable::setDir("");
+  double searchMs = benchConstruct(cls, n, k, w, param, rounds, true);
+
+  // 2. tables shared in memory
+  double memoryMs = benchConstruct(cls, n, k, w, param, rounds, false);
+
+  // 3. tables loaded from the persisted artifact, as in a restarted process
+  string dir = "codeTableBench";
+  CodeTable::setDir(dir);
+  CodeTable::clear();
+  delete construct(cls, n, k, w, param);
+  double loadMs = benchConstruct(cls, n, k, w, param, rounds, true);
+
+  cout << "CodeTableBench::construct " << cls << "(" << n << "," << k << "," << w << ") over " << rounds << " rounds: "
+       << searchMs << " ms with search, " << memoryMs << " ms from memory, "
+       << loadMs << " ms from " << dir << endl;
+  return 0;
+}
@@ -0,0 +1,244 @@
+#include "common/Config.hh"
+#include "common/ECDAGExecutor.hh"
+#include "common/ETConvert.hh"
+#include "ec/Computation.hh"
+#include "ec/ECBase.hh"
+#include "ec/ECDAG.hh"
+#include "ec/ECPolicy.hh"
+
+#include "inc/include.hh"
+#include "util/RedisUtil.hh"
+
+#include <atomic>
+
+using namespace std;
+
+// heap allocations of the process, planning an ecdag is measured by the difference
+static atomic<long> allocCount(0);
+
+void* operator new(size_t size) {
+  allocCount++;
+  void* p = malloc(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void usage() {
+  cout << "usage: ./bench_ecdag [pktsize,pktsize,...] [rounds] [ecid]" << endl;
+}
+
+// parity of a stripe by the coefs ETConvert evaluates over the data, one op per parity sub-packet
+bool referenceEncode(ECPolicy* ecpolicy, unordered_map<int, pair<int, int>>& cid2off,
+                     unordered_map<int, char*>& stripe, int len, unordered_map<int, char*>& parity) {
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  unordered_map<int, vector<int>> coefs;
+  if (!ETConvert::evaluate(ecpolicy, w, coefs)) return false;
+
+  unordered_map<int, int> off2cid;
+  for (auto item: cid2off) off2cid[item.second.first*w + item.second.second] = item.first;
+  vector<char*> data;
+  for (int i=0; i<k*w; i++) data.push_back(stripe[off2cid[i]]);
+  for (int i=k*w; i<n*w; i++) {
+    char* code = (char*)calloc(len, sizeof(char));
+    Computation::Multi(&code, data.data(), coefs[i].data(), 1, k*w, len, "Isal");
+    parity[off2cid[i]] = code;
+  }
+  return true;
+}
+
+string format(string name, ExecStats& stats, int runs) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s %.3f GB/s, %.2f bytes touched per output byte, %ld plan allocs, %d buffers",
+           name.c_str(), stats._outBytes / (stats._ms / 1000) / 1e9,
+           (double)stats._touchedBytes / stats._outBytes, stats._planAllocs / runs, stats._buffers / runs);
+  return string(buf);
+}
+
+// encode and every single-node decode of a policy on random sub-packets of pktsize/w bytes,
+// returns the encode GB/s, 0 if it fails; rsGBps is the encode GB/s of RS of the same (n,k)
+double benchPolicy(ECPolicy* ecpolicy, int pktsize, int rounds, double rsGBps) {
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  string name = ecpolicy->getPolicyId() + " pkt " + to_string(pktsize);
+  if (pktsize % w != 0) {
+    cout << name << ": skipped, w does not divide the packet" << endl;
+    return 0;
+  }
+  int len = pktsize / w;
+  ECBase* ec = ecpolicy->createECClass();
+
+  // 0. node and sub-packet of each symbol, by the layout of the code
+  unordered_map<int, pair<int, int>> cid2off;
+  unordered_map<int, int> cid2node;
+  vector<vector<int>> layout = ec->GetLayout();
+  for (int sp=0; sp<layout.size(); sp++) {
+    for (int i=0; i<layout[sp].size(); i++) cid2off[layout[sp][i]] = make_pair(i, sp);
+  }
+  for (int cidx=0; cidx<n*w; cidx++) {
+    if (cid2off.find(cidx) == cid2off.end()) cid2off[cidx] = make_pair(cidx/w, cidx%w);
+    cid2node[cidx] = cid2off[cidx].first;
+  }
+
+  // 1. a stripe of random data
+  unordered_map<int, char*> stripe;
+  unordered_map<int, char*> data;
+  for (int cidx=0; cidx<n*w; cidx++) {
+    char* buf = (char*)calloc(len, sizeof(char));
+    if (cid2node[cidx] < k) {
+      for (int i=0; i<len; i++) buf[i] = rand() & 0xff;
+      data[cidx] = buf;
+    }
+    stripe[cidx] = buf;
+  }
+
+  // 2. encode, the parity fills the stripe
+  ExecStats encStats;
+  long allocs = allocCount;
+  ECDAG* encdag = ec->Encode();
+  encStats._planAllocs = allocCount - allocs;
+  ECDAGExecutor* encoder = new ECDAGExecutor(encdag, n*w, len);
+  bool ok = true;
+  for (int r=0; r<rounds && ok; r++) ok = encoder->run(data, encStats);
+  int nparity = 0;
+  for (int cidx=0; cidx<n*w && ok; cidx++) {
+    if (cid2node[cidx] < k) continue;
+    char* parity = encoder->get(cidx);
+    if (parity == NULL) {
+      cout << name << ": encode does not compute symbol " << cidx << endl;
+      ok = false;
+      break;
+    }
+    memcpy(stripe[cidx], parity, len);
+    nparity++;
+  }
+  encStats._outBytes = (long)nparity * len * rounds;
+  delete encoder;
+  delete encdag;
+
+  // 3. the parity against a reference encode, which does not walk the ecdag
+  unordered_map<int, char*> reference;
+  string refcheck = "no reference";
+  if (ok && referenceEncode(ecpolicy, cid2off, stripe, len, reference)) {
+    refcheck = "matches reference";
+    for (auto item: reference) {
+      if (memcmp(item.second, stripe[item.first], len) != 0) {
+        cout << name << ": symbol " << item.first << " differs from the reference encode" << endl;
+        refcheck = "differs from reference";
+        ok = false;
+      }
+    }
+  }
+  for (auto item: reference) free(item.second);
+
+  // 4. every single-node decode, checked against the stripe
+  ExecStats decStats;
+  int verified = 0;
+  for (int lost=0; lost<n && ok; lost++) {
+    vector<int> availcidx;
+    vector<int> toreccidx;
+    unordered_map<int, char*> avail;
+    for (int cidx=0; cidx<n*w; cidx++) {
+      if (cid2node[cidx] == lost) {
+        toreccidx.push_back(cidx);
+      } else {
+        availcidx.push_back(cidx);
+        avail[cidx] = stripe[cidx];
+      }
+    }
+    allocs = allocCount;
+    ECDAG* decdag = ec->Decode(availcidx, toreccidx);
+    decStats._planAllocs += allocCount - allocs;
+    if (decdag == NULL) {
+      cout << name << ": node " << lost << " is not decodable" << endl;
+      continue;
+    }
+    ECDAGExecutor* decoder = new ECDAGExecutor(decdag, n*w, len);
+    bool match = true;
+    for (int r=0; r<rounds && match; r++) match = decoder->run(avail, decStats);
+    for (auto cidx: toreccidx) {
+      if (!match) break;
+      char* decoded = decoder->get(cidx);
+      match = decoded != NULL && memcmp(decoded, stripe[cidx], len) == 0;
+    }
+    if (match) verified++;
+    else cout << name << ": node " << lost << " is decoded wrong" << endl;
+    decStats._outBytes += (long)toreccidx.size() * len * rounds;
+    delete decoder;
+    delete decdag;
+  }
+
+  double gbps = ok ? encStats._outBytes / (encStats._ms / 1000) / 1e9 : 0;
+  if (!ok) {
+    cout << name << ": encode FAILED" << endl;
+  } else {
+    string vsrs;
+    if (rsGBps > 0) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), ", %.2fx of RS", gbps / rsGBps);
+      vsrs = string(buf);
+    }
+    cout << name << ": " << format("encode", encStats, 1) << ", " << refcheck << vsrs << endl;
+    cout << name << ": " << format("decode", decStats, n) << ", " << verified << "/" << n << " nodes verified" << endl;
+  }
+
+  for (auto item: stripe) free(item.second);
+  delete ec;
+  return gbps;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 4) {
+    usage();
+    return -1;
+  }
+  vector<int> pktsizes = {65536, 262144, 1048576};
+  if (argc > 1) {
+    pktsizes.clear();
+    string text(argv[1]);
+    int start = 0;
+    int end = 0;
+    while ((end = text.find(",", start)) != -1) {
+      pktsizes.push_back(stoi(text.substr(start, end - start)));
+      start = end + 1;
+    }
+    pktsizes.push_back(stoi(text.substr(start)));
+  }
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  string only = argc > 3 ? string(argv[3]) : "";
+
+  string confpath("./conf/sysSetting.xml");
+  Config* conf = new Config(confpath);
+  srand(0);
+
+  // every policy of the config, in the order of their ids. RS of each (n,k)
+  // runs first as the baseline of the encode throughput of the others
+  vector<string> ecids;
+  vector<string> rsids;
+  for (auto item: conf->_ecPolicyMap) {
+    if (item.second->getClassName() == "RSCONV") rsids.push_back(item.first);
+    else if (only.empty() || item.first == only) ecids.push_back(item.first);
+  }
+  sort(ecids.begin(), ecids.end());
+  sort(rsids.begin(), rsids.end());
+  ecids.insert(ecids.begin(), rsids.begin(), rsids.end());
+  unordered_map<string, double> rsGBps;  // n:k:pktsize -> encode GB/s
+  for (auto ecid: ecids) {
+    ECPolicy* ecpolicy = conf->_ecPolicyMap[ecid];
+    for (auto pktsize: pktsizes) {
+      string key = to_string(ecpolicy->getN()) + ":" + to_string(ecpolicy->getK()) + ":" + to_string(pktsize);
+      bool rs = ecpolicy->getClassName() == "RSCONV";
+      double gbps = benchPolicy(ecpolicy, pktsize, rounds, rs ? 0 : rsGBps[key]);
+      if (rs) rsGBps[key] = gbps;
+    }
+  }
+
+  delete conf;
+  return 0;
+}
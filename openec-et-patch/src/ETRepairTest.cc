@@ -0,0 +1,178 @@
+#include "common/Config.hh"
+#include "common/ECDAGExecutor.hh"
+#include "ec/ECBase.hh"
+#include "ec/ECDAG.hh"
+#include "ec/ECPolicy.hh"
+
+#include "inc/include.hh"
+
+using namespace std;
+
+// codes that decode multiple node failures by ETRepair
+static const set<string> multiClasses = {"ETRSConv", "ETAzureLRC", "ETHHXORPlus"};
+// MDS codes among them, which decode every loss of up to n-k nodes
+static const set<string> mdsClasses = {"ETRSConv", "ETHHXORPlus"};
+
+void usage() {
+  cout << "usage: ./ETRepairTest [pktsize] [ecid]" << endl;
+}
+
+// failed nodes to decode: for an MDS code every set of up to n-k nodes,
+// otherwise every pair, and n-k consecutive nodes from each node
+vector<vector<int>> failureSets(int n, int k, bool mds) {
+  set<vector<int>> toret;
+  if (mds) {
+    for (int mask=1; mask<(1<<n); mask++) {
+      if (__builtin_popcount(mask) > n-k) continue;
+      vector<int> cur;
+      for (int i=0; i<n; i++) {
+        if (mask & (1<<i)) cur.push_back(i);
+      }
+      toret.insert(cur);
+    }
+    return vector<vector<int>>(toret.begin(), toret.end());
+  }
+  for (int a=0; a<n; a++) {
+    for (int b=a+1; b<n; b++) toret.insert({a, b});
+  }
+  for (int a=0; a<n && n-k > 2; a++) {
+    vector<int> cur;
+    for (int i=0; i<n-k; i++) cur.push_back((a+i) % n);
+    sort(cur.begin(), cur.end());
+    toret.insert(cur);
+  }
+  return vector<vector<int>>(toret.begin(), toret.end());
+}
+
+// false if a decodable failure is decoded wrong, or an MDS code does not
+// decode a loss of up to n-k nodes
+bool testPolicy(ECPolicy* ecpolicy, int pktsize) {
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  string name = ecpolicy->getPolicyId();
+  bool mds = mdsClasses.find(ecpolicy->getClassName()) != mdsClasses.end();
+  if (pktsize % w != 0) {
+    cout << name << ": skipped, w does not divide the packet" << endl;
+    return true;
+  }
+  int len = pktsize / w;
+  ECBase* ec = ecpolicy->createECClass();
+
+  // 0. node of each symbol, by the layout of the code
+  unordered_map<int, int> cid2node;
+  vector<vector<int>> layout = ec->GetLayout();
+  for (int sp=0; sp<layout.size(); sp++) {
+    for (int i=0; i<layout[sp].size(); i++) cid2node[layout[sp][i]] = i;
+  }
+  for (int cidx=0; cidx<n*w; cidx++) {
+    if (cid2node.find(cidx) == cid2node.end()) cid2node[cidx] = cidx/w;
+  }
+
+  // 1. an encoded stripe of random data
+  unordered_map<int, char*> stripe;
+  unordered_map<int, char*> data;
+  for (int cidx=0; cidx<n*w; cidx++) {
+    char* buf = (char*)calloc(len, sizeof(char));
+    if (cid2node[cidx] < k) {
+      for (int i=0; i<len; i++) buf[i] = rand() & 0xff;
+      data[cidx] = buf;
+    }
+    stripe[cidx] = buf;
+  }
+  ExecStats stats;
+  ECDAG* encdag = ec->Encode();
+  ECDAGExecutor* encoder = new ECDAGExecutor(encdag, n*w, len);
+  bool toret = encoder->run(data, stats);
+  for (int cidx=0; cidx<n*w && toret; cidx++) {
+    if (cid2node[cidx] < k) continue;
+    char* parity = encoder->get(cidx);
+    if (parity == NULL) {
+      cout << name << ": encode does not compute symbol " << cidx << endl;
+      toret = false;
+      break;
+    }
+    memcpy(stripe[cidx], parity, len);
+  }
+  delete encoder;
+  delete encdag;
+
+  // 2. every failure set, the decoded bytes against the stripe
+  int verified = 0, undecodable = 0, wrong = 0;
+  vector<vector<int>> failures = toret ? failureSets(n, k, mds) : vector<vector<int>>();
+  for (auto lost: failures) {
+    set<int> lostnodes(lost.begin(), lost.end());
+    vector<int> availcidx;
+    vector<int> toreccidx;
+    unordered_map<int, char*> avail;
+    for (int cidx=0; cidx<n*w; cidx++) {
+      if (lostnodes.find(cid2node[cidx]) != lostnodes.end()) {
+        toreccidx.push_back(cidx);
+      } else {
+        availcidx.push_back(cidx);
+        avail[cidx] = stripe[cidx];
+      }
+    }
+    string nodes;
+    for (auto node: lost) nodes += (nodes.empty() ? "" : ",") + to_string(node);
+
+    ECDAG* decdag = ec->Decode(availcidx, toreccidx);
+    if (decdag == NULL) {
+      if (mds) cout << name << ": nodes " << nodes << " are not decodable" << endl;
+      undecodable++;
+      continue;
+    }
+    ECDAGExecutor* decoder = new ECDAGExecutor(decdag, n*w, len);
+    bool match = decoder->run(avail, stats);
+    for (auto cidx: toreccidx) {
+      if (!match) break;
+      char* decoded = decoder->get(cidx);
+      match = decoded != NULL && memcmp(decoded, stripe[cidx], len) == 0;
+    }
+    if (match) {
+      verified++;
+    } else {
+      cout << name << ": nodes " << nodes << " are decoded wrong" << endl;
+      wrong++;
+    }
+    delete decoder;
+    delete decdag;
+  }
+  if (wrong || (mds && undecodable)) toret = false;
+  cout << name << ": " << (toret ? "PASS" : "FAIL") << ", " << verified << " verified, "
+       << undecodable << " not decodable, " << wrong << " wrong of " << failures.size() << " failure sets" << endl;
+
+  for (auto item: stripe) free(item.second);
+  delete ec;
+  return toret;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    usage();
+    return -1;
+  }
+  int pktsize = argc > 1 ? atoi(argv[1]) : 65536;
+  string only = argc > 2 ? string(argv[2]) : "";
+
+  string confpath("./conf/sysSetting.xml");
+  Config* conf = new Config(confpath);
+  srand(0);
+
+  vector<string> ecids;
+  for (auto item: conf->_ecPolicyMap) {
+    if (!only.empty() && item.first != only) continue;
+    if (only.empty() && multiClasses.find(item.second->getClassName()) == multiClasses.end()) continue;
+    ecids.push_back(item.first);
+  }
+  sort(ecids.begin(), ecids.end());
+
+  bool pass = true;
+  for (auto ecid: ecids) {
+    if (!testPolicy(conf->_ecPolicyMap[ecid], pktsize)) pass = false;
+  }
+  cout << "ETRepairTest: " << ecids.size() << " policies, " << (pass ? "PASS" : "FAIL") << endl;
+
+  delete conf;
+  return pass ? 0 : 1;
+}
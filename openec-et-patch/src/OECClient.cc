@@ -1,7 +1,11 @@
 #include "common/CoorBench.hh"
 #include "common/Config.hh"
+#include "common/ETSearch.hh"
 #include "common/OECInputStream.hh"
 #include "common/OECOutputStream.hh"
+#include "common/PlanAnalyzer.hh"
+#include "common/Throttle.hh"
+#include "protocol/AGCommand.hh"
 #include "protocol/CoorCommand.hh"
 
 #include "inc/include.hh"
@@ -12,10 +16,23 @@ void usage() {
   cout << "usage: ./OECClient write inputfile saveas ecid online sizeinMB" << endl;
   cout << "       ./OECClient write inputfile saveas poolid offline sizeinMB" << endl;
   cout << "       ./OECClient read filename saveas" << endl;
+  cout << "       ./OECClient readRange filename offset length saveas" << endl;
   cout << "       ./OECClient startEncode" << endl;
   cout << "       ./OECClient startRepair" << endl;
   cout << "       ./OECClient coorBench id number" << endl;
   cout << "       ./OECClient hdfsmeta" << endl;
+  cout << "       ./OECClient setThrottle agentip|all fg|repair|encode|all disk|netin|netout|compute|all rateKBps" << endl;
+  cout << "       ./OECClient throttleUsage" << endl;
+  cout << "       ./OECClient recoverNode failedip" << endl;
+  cout << "       ./OECClient recoveryProgress" << endl;
+  cout << "       ./OECClient metaUsage" << endl;
+  cout << "       ./OECClient planStats" << endl;
+  cout << "       ./OECClient planCost ecid sizeinMB [lostidx,lostidx ... | all:numlost]" << endl;
+  cout << "       ./OECClient etSearch n k w" << endl;
+  cout << "       ./OECClient convertPool poolid ecid" << endl;
+  cout << "       ./OECClient degradedBench etfile rsfile number" << endl;
+  cout << "       ./OECClient update filename objidx inputfile" << endl;
+  cout << "       ./OECClient tieringReport" << endl;
 }
 
 void read(string filename, string saveas) {
@@ -37,6 +54,77 @@ void read(string filename, string saveas) {
   delete conf;
 }
  
+void readRange(string filename, long offset, long length, string saveas) {
+  string confpath("./conf/sysSetting.xml");
+  Config* conf = new Config(confpath);
+  int pktsize = conf->_pktSize;
+
+  struct timeval time1, time2, time3;
+  gettimeofday(&time1, NULL);
+  // 0. the local agent caches the packets covering the range as filename:pktidx
+  AGCommand* agCmd = new AGCommand();
+  agCmd->buildType16(16, filename, offset, length);
+  agCmd->setRkey("ag_request");
+  agCmd->sendTo(conf->_localIp);
+  delete agCmd;
+
+  redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+  string skey = "filesize:" + filename;
+  redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", skey.c_str());
+  int filesizeMB;
+  memcpy((char*)&filesizeMB, rReply->element[1]->str, 4);
+  filesizeMB = ntohl(filesizeMB);
+  freeReplyObject(rReply);
+  long filebytes = (long)filesizeMB * 1048576;
+  if (offset + length > filebytes) length = filebytes - offset;
+  if (offset < 0 || length <= 0) {
+    cout << "ERROR: range " << offset << " is beyond the file of " << filesizeMB << " MB" << endl;
+    redisFree(waitCtx);
+    delete conf;
+    return;
+  }
+
+  // 1. copy the range out of its packets
+  FILE* outfile = fopen(saveas.c_str(), "wb");
+  int firstpkt = offset / pktsize;
+  int lastpkt = (offset + length - 1) / pktsize;
+  for (int i=firstpkt; i<=lastpkt; i++) {
+    string key = filename + ":" + to_string(i);
+    rReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", key.c_str());
+    if (i == firstpkt) gettimeofday(&time2, NULL);
+    char* data = rReply->element[1]->str + 4;
+    int start = (i == firstpkt) ? offset % pktsize : 0;
+    int end = (i == lastpkt) ? (offset + length - 1) % pktsize + 1 : pktsize;
+    fwrite(data + start, 1, end - start, outfile);
+    freeReplyObject(rReply);
+  }
+  fclose(outfile);
+  redisFree(waitCtx);
+
+  gettimeofday(&time3, NULL);
+  cout << "readRange.firstbyte.duration: " << RedisUtil::duration(time1, time2) << endl;
+  cout << "readRange.overall.duration: " << RedisUtil::duration(time1, time3) << ", packets " << lastpkt - firstpkt + 1 << endl;
+  delete conf;
+}
+
+double degradedRead(Config* conf, string filename, int number) {
+  // the file has a lost object, each read repairs it from the helpers
+  double total = 0;
+  for (int i=0; i<number; i++) {
+    struct timeval time1, time2;
+    gettimeofday(&time1, NULL);
+    OECInputStream* instream = new OECInputStream(conf, filename);
+    instream->output2file("/dev/null");
+    instream->close();
+    gettimeofday(&time2, NULL);
+    delete instream;
+    double duration = RedisUtil::duration(time1, time2);
+    cout << "degradedBench." << filename << "." << i << ".duration: " << duration << endl;
+    total += duration;
+  }
+  return total / number;
+}
+
 void write(string inputname, string filename, string ecidpool, string encodemode, int sizeinMB) {
    string confpath("./conf/sysSetting.xml");
    Config* conf = new Config(confpath);
@@ -83,6 +171,67 @@ void write(string inputname, string filename, string ecidpool, string encodemode
    delete conf;
 }
 
+void update(string filename, int objidx, string inputname) {
+  string confpath("./conf/sysSetting.xml");
+  Config* conf = new Config(confpath);
+  int pktsize = conf->_pktSize;
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+
+  // 0. the new obj is kept in the local redis, the data node stages it
+  // next to the obj and overwrites the obj from there
+  FILE* inputfile = fopen(inputname.c_str(), "rb");
+  fseek(inputfile, 0, SEEK_END);
+  int num = ftell(inputfile) / pktsize;
+  fseek(inputfile, 0, SEEK_SET);
+  string keybase = "update:" + filename + ":" + to_string(objidx) + ":0";
+  redisContext* writeCtx = RedisUtil::createContext(conf->_localIp);
+  char* buf = (char*)calloc(pktsize+4, sizeof(char));
+  int tmplen = htonl(pktsize);
+  memcpy(buf, (char*)&tmplen, 4);
+  for (int i=0; i<num; i++) {
+    fread(buf+4, pktsize, 1, inputfile);
+    string key = keybase + ":" + to_string(i);
+    redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), buf, pktsize+4);
+  }
+  for (int i=0; i<num; i++) {
+    redisReply* rReply;
+    redisGetReply(writeCtx, (void**)&rReply);
+    freeReplyObject(rReply);
+  }
+  free(buf);
+  fclose(inputfile);
+
+  // 1. the coordinator updates the parity by delta, then overwrites the obj
+  CoorCommand* cmd = new CoorCommand();
+  cmd->buildType24(24, conf->_localIp, filename, objidx);
+  cmd->sendTo(conf->_coorIp);
+  delete cmd;
+
+  string rkey = "updatereport:" + filename;
+  redisReply* rReply = (redisReply*)redisCommand(writeCtx, "blpop %s 0", rkey.c_str());
+  string report(rReply->element[1]->str, rReply->element[1]->len);
+  freeReplyObject(rReply);
+  cout << report;
+
+  // 2. a rejected update leaves the packets behind
+  if (report.find("error") == 0) {
+    for (int i=0; i<num; i++) {
+      string key = keybase + ":" + to_string(i);
+      redisAppendCommand(writeCtx, "DEL %s", key.c_str());
+    }
+    for (int i=0; i<num; i++) {
+      redisGetReply(writeCtx, (void**)&rReply);
+      freeReplyObject(rReply);
+    }
+  }
+  redisFree(writeCtx);
+
+  gettimeofday(&time2, NULL);
+  cout << "update.overall.duration: " << RedisUtil::duration(time1, time2) << endl;
+  delete conf;
+}
+
 int main(int argc, char** argv) {
 
   if (argc < 2) {
@@ -115,6 +264,16 @@ int main(int argc, char** argv) {
     string filename(argv[2]);
     string saveas(argv[3]);
     read(filename, saveas);
+  } else if (reqType == "readRange") {
+    if (argc != 6) {
+      usage();
+      return -1;
+    }
+    string filename(argv[2]);
+    long offset = atol(argv[3]);
+    long length = atol(argv[4]);
+    string saveas(argv[5]);
+    readRange(filename, offset, length, saveas);
   } else if (reqType == "startEncode") {
     string confpath("./conf/sysSetting.xml");
     Config* conf = new Config(confpath);    
@@ -156,6 +315,230 @@ int main(int argc, char** argv) {
     cmd->sendTo(conf->_coorIp);
     delete cmd;
     delete conf;
+  } else if (reqType == "setThrottle") {
+    if (argc != 6) {
+      usage();
+      return -1;
+    }
+    string agent(argv[2]);
+    string prioname(argv[3]);
+    string resname(argv[4]);
+    int rateKB = atoi(argv[5]);
+    int prio = Throttle::prioFromName(prioname);
+    int res = Throttle::resFromName(resname);
+    if (prio == THROTTLE_UNKNOWN || res == THROTTLE_UNKNOWN) {
+      cout << "error: unknown class " << prioname << " or resource " << resname << endl;
+      usage();
+      return -1;
+    }
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    unsigned int agentip = (agent == "all") ? 0 : inet_addr(agent.c_str());
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType13(13, conf->_localIp, agentip, prio, res, rateKB);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+    delete conf;
+  } else if (reqType == "throttleUsage") {
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType14(14, conf->_localIp);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    // agent class,resource,rateKB/s,usageKB/s,totalKB;...
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop throttleusage 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "recoverNode") {
+    if (argc != 3) {
+      usage();
+      return -1;
+    }
+    string failed(argv[2]);
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType15(15, conf->_localIp, inet_addr(failed.c_str()));
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop noderecovery 0");
+    int num = atoi(rReply->element[1]->str);
+    if (num < 0) cout << "another node recovery is in progress" << endl;
+    else cout << num << " lost objects on " << failed << " scheduled for recovery" << endl;
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "recoveryProgress") {
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType16(16, conf->_localIp);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop recoveryprogress 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "metaUsage") {
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType17(17, conf->_localIp);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop metausage 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "planStats") {
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType18(18, conf->_localIp);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop planstats 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "planCost") {
+    if (argc < 4) {
+      usage();
+      return -1;
+    }
+    // dry run, the plans are built locally without the coordinator
+    string ecid(argv[2]);
+    int size = atoi(argv[3]);
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    if (conf->_ecPolicyMap.find(ecid) == conf->_ecPolicyMap.end()) {
+      cout << "ERROR: unknown ecid " << ecid << endl;
+      delete conf;
+      return -1;
+    }
+    PlanAnalyzer* analyzer = new PlanAnalyzer(conf, conf->_ecPolicyMap[ecid], size);
+    vector<vector<int>> multilost;
+    for (int i=4; i<argc; i++) {
+      string item(argv[i]);
+      if (item.find("all:") == 0) {
+        // every pattern of that many lost objs
+        vector<vector<int>> patterns = analyzer->lostPatterns(atoi(item.substr(4).c_str()));
+        multilost.insert(multilost.end(), patterns.begin(), patterns.end());
+        continue;
+      }
+      vector<int> lostidx;
+      int start = 0;
+      int end = 0;
+      while ((end = item.find(",", start)) != -1) {
+        lostidx.push_back(atoi(item.substr(start, end - start).c_str()));
+        start = end + 1;
+      }
+      lostidx.push_back(atoi(item.substr(start).c_str()));
+      multilost.push_back(lostidx);
+    }
+    for (auto cost: analyzer->analyzeAll(multilost)) cout << cost.dump();
+    delete analyzer;
+    delete conf;
+  } else if (reqType == "etSearch") {
+    if (argc != 5) {
+      usage();
+      return -1;
+    }
+    int n = atoi(argv[2]);
+    int k = atoi(argv[3]);
+    int w = atoi(argv[4]);
+    ETSearch* etsearch = new ETSearch(n, k, w);
+    ETCandidate def, best;
+    try {
+      def = etsearch->defaultConstruction();
+      best = etsearch->search();
+    } catch (invalid_argument& e) {
+      // the default construction is not one that explicit groups can express
+      cout << e.what() << endl;
+      delete etsearch;
+      return -1;
+    }
+    for (auto item: etsearch->getRejected()) cout << "rejected: " << item.first << ", " << item.second << endl;
+    cout << "default: " << def.param() << ", avg read " << def._avgRead << " sub-packets, avg runs " << def._avgRuns << endl;
+    cout << "best: " << best.param() << ", avg read " << best._avgRead << " sub-packets, avg runs " << best._avgRuns << endl;
+    cout << etsearch->getEvaluated() << " constructions evaluated, RS reads " << k * w << " sub-packets" << endl;
+    cout << "<param>" << w << "," << best.param() << "</param>" << endl;
+    delete etsearch;
+  } else if (reqType == "convertPool") {
+    if (argc != 4) {
+      usage();
+      return -1;
+    }
+    string poolid(argv[2]);
+    string ecid(argv[3]);
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType20(20, conf->_localIp, poolid, ecid);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    // the report comes once the stripes are planned, they switch as their parity is persisted
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop convertreport 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "degradedBench") {
+    // files of an ET pool and an RSCONV pool of the same (n,k), each with a lost object
+    if (argc != 5) {
+      usage();
+      return -1;
+    }
+    string etfile(argv[2]);
+    string rsfile(argv[3]);
+    int number = atoi(argv[4]);
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    double etavg = degradedRead(conf, etfile, number);
+    double rsavg = degradedRead(conf, rsfile, number);
+    cout << "degradedBench.et: " << etavg << " ms, rs: " << rsavg << " ms, ratio " << etavg / rsavg << endl;
+    delete conf;
+  } else if (reqType == "tieringReport") {
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType25(25, conf->_localIp);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+
+    redisContext* waitCtx = RedisUtil::createContext(conf->_localIp);
+    redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop tieringreport 0");
+    cout << string(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+    redisFree(waitCtx);
+    delete conf;
+  } else if (reqType == "update") {
+    if (argc != 5) {
+      usage();
+      return -1;
+    }
+    string filename(argv[2]);
+    int objidx = atoi(argv[3]);
+    string inputname(argv[4]);
+    update(filename, objidx, inputname);
   } else {
     cout << "ERROR: un-recognized request!" << endl;
     usage();
@@ -0,0 +1,159 @@
+#include "common/MetaLog.hh"
+#include "common/SSEntryIndex.hh"
+
+#include "inc/include.hh"
+#include "util/RedisUtil.hh"
+
+#include <unistd.h>
+
+using namespace std;
+
+// objects of a file, as an online-encoded file with k splits
+#define BENCH_OBJS_PER_ENTRY 4
+
+void usage() {
+  cout << "usage: ./StripeStoreBench index objnum threadnum" << endl;
+  cout << "       ./StripeStoreBench log recordnum threadnum" << endl;
+}
+
+string benchObjName(long i) {
+  return "/bench-" + to_string(i / BENCH_OBJS_PER_ENTRY) + "-" + to_string(i % BENCH_OBJS_PER_ENTRY);
+}
+
+void insertWorker(SSEntryIndex* fileIndex, SSEntryIndex* objIndex, long start, long end) {
+  for (long f=start; f<end; f++) {
+    string filename = "/bench-" + to_string(f);
+    vector<string> objlist;
+    vector<unsigned int> objloc;
+    for (int i=0; i<BENCH_OBJS_PER_ENTRY; i++) {
+      objlist.push_back(filename + "-" + to_string(i));
+      objloc.push_back(i);
+    }
+    SSEntry* entry = new SSEntry(filename, 0, 1, "bench", objlist, objloc);
+    fileIndex->insert(filename, entry);
+    for (auto obj: objlist) objIndex->insert(obj, entry);
+  }
+}
+
+void lookupWorker(SSEntryIndex* objIndex, long objnum, int seed, long num, long* found) {
+  unsigned int rseed = seed;
+  long hit = 0;
+  for (long i=0; i<num; i++) {
+    long idx = (((long)rand_r(&rseed) << 31) | rand_r(&rseed)) % objnum;
+    if (objIndex->get(benchObjName(idx)) != NULL) hit++;
+  }
+  *found = hit;
+}
+
+void appendWorker(MetaLog* metaLog, long start, long end) {
+  for (long i=start; i<end; i++) {
+    string record = "benchpool;bench-" + to_string(i) + ";P;";
+    for (int j=0; j<BENCH_OBJS_PER_ENTRY; j++) record += benchObjName(i*BENCH_OBJS_PER_ENTRY+j) + ";";
+    if (!metaLog->append(METALOG_POOL, record)) {
+      cout << "appendWorker: the wal fails, stop at record " << i << endl;
+      return;
+    }
+  }
+}
+
+void benchLog(long recordnum, int threadnum) {
+  string walPath = "benchWal";
+  string snapPath = "benchSnapshot";
+  unlink(walPath.c_str());
+  unlink((walPath + ".old").c_str());
+  unlink(snapPath.c_str());
+  struct timeval time1, time2, time3;
+
+  // 1. appends from concurrent writers share the syncs
+  MetaLog* metaLog = new MetaLog(walPath, snapPath);
+  metaLog->load([](int type, string payload) {});
+  gettimeofday(&time1, NULL);
+  vector<thread> threads;
+  for (int i=0; i<threadnum; i++) {
+    long start = recordnum * i / threadnum;
+    long end = recordnum * (i+1) / threadnum;
+    threads.push_back(thread([=]{appendWorker(metaLog, start, end);}));
+  }
+  for (int i=0; i<threadnum; i++) threads[i].join();
+  gettimeofday(&time2, NULL);
+  double appendMs = RedisUtil::duration(time1, time2);
+  long syncs = metaLog->getSyncs();
+  cout << "StripeStoreBench::append " << recordnum << " records in " << appendMs << " ms, "
+       << (long)(recordnum / appendMs * 1000) << " records/s, " << syncs << " syncs, "
+       << (syncs ? recordnum / syncs : 0) << " records per sync" << endl;
+
+  // 2. replay of snapshot and wal by a new metalog, the records are counted
+  // and not applied, so the stripestore indexes are not rebuilt
+  long replayed = 0;
+  MetaLog* reloaded = new MetaLog(walPath, snapPath);
+  reloaded->load([&](int type, string payload) { replayed++; });
+  gettimeofday(&time3, NULL);
+  cout << "StripeStoreBench::replay " << replayed << " records in "
+       << RedisUtil::duration(time2, time3) << " ms, metalog only" << endl;
+}
+
+void benchIndex(long objnum, int threadnum) {
+  long filenum = objnum / BENCH_OBJS_PER_ENTRY;
+  objnum = filenum * BENCH_OBJS_PER_ENTRY;
+
+  NameTable* names = new NameTable();
+  SSEntryIndex* fileIndex = new SSEntryIndex(names);
+  SSEntryIndex* objIndex = new SSEntryIndex(names);
+  struct timeval time1, time2, time3;
+
+  // 1. insert
+  gettimeofday(&time1, NULL);
+  vector<thread> threads;
+  for (int i=0; i<threadnum; i++) {
+    long start = filenum * i / threadnum;
+    long end = filenum * (i+1) / threadnum;
+    threads.push_back(thread([=]{insertWorker(fileIndex, objIndex, start, end);}));
+  }
+  for (int i=0; i<threadnum; i++) threads[i].join();
+  gettimeofday(&time2, NULL);
+  double insertMs = RedisUtil::duration(time1, time2);
+  cout << "StripeStoreBench::insert " << objIndex->size() << " objects in " << insertMs << " ms, "
+       << (long)(objnum / insertMs * 1000) << " objects/s" << endl;
+
+  // 2. random lookups
+  threads.clear();
+  long* found = (long*)calloc(threadnum, sizeof(long));
+  for (int i=0; i<threadnum; i++) {
+    long num = objnum * (i+1) / threadnum - objnum * i / threadnum;
+    threads.push_back(thread([=]{lookupWorker(objIndex, objnum, i+1, num, found+i);}));
+  }
+  for (int i=0; i<threadnum; i++) threads[i].join();
+  gettimeofday(&time3, NULL);
+  double lookupMs = RedisUtil::duration(time2, time3);
+  long hit = 0;
+  for (int i=0; i<threadnum; i++) hit += found[i];
+  cout << "StripeStoreBench::lookup " << objnum << " objects in " << lookupMs << " ms, "
+       << (long)(objnum / lookupMs * 1000) << " lookups/s, " << hit << " found" << endl;
+  free(found);
+  long indexBytes = names->memoryBytes() + fileIndex->memoryBytes() + objIndex->memoryBytes();
+  cout << "StripeStoreBench::memory " << indexBytes/1048576 << " MB for names and indexes, "
+       << indexBytes / objnum << " bytes per object" << endl;
+
+  // entries are shared by the objects of a file
+  fileIndex->forEach([](string filename, SSEntry* entry) { delete entry; });
+  delete objIndex;
+  delete fileIndex;
+  delete names;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    usage();
+    return -1;
+  }
+  string benchType(argv[1]);
+  long num = atol(argv[2]);
+  int threadnum = atoi(argv[3]);
+  if (benchType == "index") benchIndex(num, threadnum);
+  else if (benchType == "log") benchLog(num, threadnum);
+  else {
+    usage();
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "CompletionChannel.hh"
+
+CompletionChannel::CompletionChannel(Config* conf) : _conf(conf) {
+  _loopThread = thread([=]{eventLoop();});
+  _loopThread.detach();
+}
+
+void CompletionChannel::expect(vector<string> objnames, function<void()> callback) {
+  if (objnames.size() == 0) {
+    callback();
+    return;
+  }
+  lock_guard<mutex> lk(_lock);
+  int group = _nextGroup++;
+  for (auto obj: objnames) {
+    if (_obj2group.find(obj) != _obj2group.end()) {
+      cerr << "CompletionChannel::expect " << obj << " is expected by another request, tag it" << endl;
+    }
+    _obj2group[obj] = group;
+  }
+  _groupRemain[group] = objnames.size();
+  _groupCallback[group] = callback;
+}
+
+string CompletionChannel::tag(string objname) {
+  lock_guard<mutex> lk(_lock);
+  return objname + COMPLETION_TAG + to_string(_nextTag++);
+}
+
+void CompletionChannel::eventLoop() {
+  redisContext* eventCtx = RedisUtil::createContext(_conf->_coorIp);
+  while (true) {
+    redisReply* rReply = (redisReply*)redisCommand(eventCtx, "blpop oec_completion 0");
+    if (rReply->type != REDIS_REPLY_ARRAY) {
+      cerr << "CompletionChannel::eventLoop get wrong reply" << endl;
+      freeReplyObject(rReply);
+      continue;
+    }
+    string objname(rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+
+    function<void()> callback;
+    _lock.lock();
+    if (_obj2group.find(objname) == _obj2group.end()) {
+      _lock.unlock();
+      cout << "CompletionChannel::eventLoop nobody waits for " << objname << endl;
+      continue;
+    }
+    int group = _obj2group[objname];
+    _obj2group.erase(objname);
+    if (--_groupRemain[group] == 0) {
+      callback = _groupCallback[group];
+      _groupRemain.erase(group);
+      _groupCallback.erase(group);
+    }
+    _lock.unlock();
+
+    // the callback may dispatch new work, so it runs without the lock
+    if (callback) callback();
+  }
+  redisFree(eventCtx);
+}
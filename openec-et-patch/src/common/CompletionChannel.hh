@@ -0,0 +1,46 @@
+#ifndef _COMPLETIONCHANNEL_HH_
+#define _COMPLETIONCHANNEL_HH_
+
+#include "Config.hh"
+
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+// an obj persisted as name#seq is written as name and reported as name#seq
+#define COMPLETION_TAG '#'
+
+/**
+ * Agents rpush the name of every object they persist to the completion
+ * list of the coordinator. A single event loop consumes the list and runs
+ * the callback of a group once all the objects of the group are persisted,
+ * so coordinator threads never block on a write finish.
+ *
+ * An obj that other requests may persist as well, e.g., a data obj that is
+ * repaired, written back and updated, is persisted under a tagged name, so
+ * each request waits for its own write.
+ */
+class CompletionChannel {
+  private:
+    Config* _conf;
+    mutex _lock;
+    int _nextGroup = 0;
+    long _nextTag = 0;
+    unordered_map<string, int> _obj2group;
+    unordered_map<int, int> _groupRemain;
+    unordered_map<int, function<void()>> _groupCallback;
+    thread _loopThread;
+
+    void eventLoop();
+
+  public:
+    CompletionChannel(Config* conf);
+
+    // register before the persist commands are sent
+    void expect(vector<string> objnames, function<void()> callback);
+    // name to persist objname as, unique among all the requests
+    string tag(string objname);
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Config.hh"
 
+#include "../ec/CodeTable.hh"
+
 Config::Config(std::string& filepath) {
    XMLDocument doc;
    doc.LoadFile(filepath.c_str());
@@ -32,12 +34,20 @@ Config::Config(std::string& filepath) {
        }
     } else if (attName == "oec.agent.thread.num") {
       _agWorkerThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.agent.encode.thread.num") {
+      _agEncodeThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "oec.controller.thread.num") {
       _coorThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.controller.plan.thread.num") {
+      _coorPlanThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "oec.cmddist.thread.num") {
       _distThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "ec.concurrent.num") {
       _ec_concurrent = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "ec.batch.num") {
+      _ec_batch = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "ec.table.dir") {
+      CodeTable::setDir(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "local.addr") {
       _localIp = inet_addr(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "packet.size") {
@@ -62,6 +72,38 @@ Config::Config(std::string& filepath) {
 //      std::string avoidlocal = ele->NextSiblingElement("value")->GetText();
 //      if (avoidlocal == "true") _avoid_local = true;
 //      else _avoid_local = false;
+    } else if (attName == "repair.onread") {
+      std::string onread = ele->NextSiblingElement("value")->GetText();
+      _repairOnRead = (onread == "true");
+    } else if (attName == "oec.agent.lane.weight" || attName == "oec.agent.lane.limit") {
+      std::string valtext = ele->NextSiblingElement("value")->GetText();
+      std::vector<int> vals;
+      int start = 0;
+      int end = 0;
+
+      while ((end = valtext.find(",", start)) != -1) {
+        vals.push_back(std::stoi(valtext.substr(start, end - start)));
+        start = end + 1;
+      }
+      vals.push_back(std::stoi(valtext.substr(start)));
+      if (attName == "oec.agent.lane.weight") _agLaneWeight = vals;
+      else _agLaneLimit = vals;
+    } else if (attName == "oec.network.bandwidth.inner") {
+      _linkBwInner = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.network.bandwidth.cross") {
+      _linkBwCross = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.period.sec") {
+      _tieringPeriodSec = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.hot.reads") {
+      _tieringHotReads = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.cold.reads") {
+      _tieringColdReads = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.repairs") {
+      _tieringRepairs = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.small.mb") {
+      _tieringSmallMB = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "oec.tiering.budget.mb") {
+      _tieringBudgetMB = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "dss.parameter") {
       std::string paramtext = ele->NextSiblingElement("value")->GetText();
       int start = 0;
@@ -216,6 +258,9 @@ Config::Config(std::string& filepath) {
    }
 
    _fsFactory.insert(make_pair(_fsType, _fsParam));
+
+   // lanes without an explicit limit may use every worker thread
+   while (_agLaneLimit.size() < _agLaneWeight.size()) _agLaneLimit.push_back(_agWorkerThreadNum);
 }
 
 Config::~Config() {
@@ -0,0 +1,79 @@
+#ifndef _CONFIG_HH_
+#define _CONFIG_HH_
+
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+#include "../util/tinyxml2.h"
+
+using namespace tinyxml2;
+using namespace std;
+
+class Config {
+  public:
+    Config(std::string& filepath);
+    ~Config();
+
+    // common
+    unsigned int _coorIp;
+    std::vector<unsigned int> _agentsIPs;
+    std::unordered_map<unsigned int, std::string> _ip2Rack;
+    std::unordered_map<std::string, std::vector<unsigned int>> _rack2Ips;
+
+    int _agWorkerThreadNum;
+    int _coorThreadNum;
+    int _coorPlanThreadNum = 8;
+    int _agEncodeThreadNum = 1;  // stripes of an online write encoded in parallel
+    int _distThreadNum;
+    int _ec_concurrent;
+    int _ec_batch = 1;  // stripes of a pool encoded, or objs of a node recovery repaired, by one batch job
+
+    unsigned int _localIp;
+    int _pktSize;
+
+    // underlying fs
+    std::string _fsType;
+    std::vector<std::string> _fsParam;
+    std::unordered_map<std::string, std::vector<std::string>> _fsFactory;
+
+    // ec policy and offline pools
+    std::unordered_map<std::string, ECPolicy*> _ecPolicyMap;
+    std::unordered_map<std::string, std::string> _offlineECMap;
+    std::unordered_map<std::string, int> _offlineECBase;
+
+    // scheduling policies
+    std::string _control_policy = "random";
+    std::string _data_policy = "random";
+    std::string _encode_scheduling = "delay";
+    std::string _encode_policy = "random";
+    std::string _repair_scheduling = "delay";
+    std::string _repair_policy = "random";
+    int _repair_threshold = 1;
+    // agents that decode a lost obj for a whole-obj degraded read also persist it
+    bool _repairOnRead = false;
+    bool _avoid_local = false;
+
+    // agent priority lanes, indexed by AG_PRIO_* (foreground, repair, encode)
+    // weight: share of dequeues a lane gets when several lanes are backlogged
+    // limit: max disk reads of a lane running at the same time on one agent,
+    //        defaults to oec.agent.thread.num (no cap). Commands that wait on
+    //        other agents are dequeued by weight too, but start on runners of
+    //        their own and are not limited, see OECWorker::waitsOnAgents
+    std::vector<int> _agLaneWeight = {4, 2, 1};
+    std::vector<int> _agLaneLimit;
+
+    // link bandwidth in MB/s inside a rack and across racks, used by opt 4
+    // until the agents have observed the real one
+    double _linkBwInner = 125;
+    double _linkBwCross = 125;
+
+    // sub-packetization tiering of encoded stripes, off if the period is 0,
+    // the thresholds apply to access counts that halve every period
+    int _tieringPeriodSec = 0;
+    double _tieringHotReads = 16;  // reads of the data objs, at least this is hot
+    double _tieringColdReads = 1;  // at most this is cold
+    double _tieringRepairs = 1;  // repairs and degraded reads that move a stripe one tier up in w
+    int _tieringSmallMB = 4;  // files at most this size keep the smallest w
+    int _tieringBudgetMB = 4096;  // data read by the conversions of a period
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Coordinator.hh"
 
+#include "hdfs.h"
+
 Coordinator::Coordinator(Config* conf, StripeStore* ss) : _conf(conf) {
   // create local context
   try {
@@ -11,10 +13,28 @@ Coordinator::Coordinator(Config* conf, StripeStore* ss) : _conf(conf) {
   _stripeStore = ss;
   _underfs = FSUtil::createFS(_conf->_fsType, _conf->_fsFactory[_conf->_fsType], _conf);
   srand((unsigned)time(0));
+  // one planning pool for all the instances
+  if (_stripeStore->claimTask("planPool")) {
+    for (int i=0; i<_conf->_coorPlanThreadNum; i++) {
+      thread([=]{_stripeStore->getPlanPool()->work([=](CoorCommand* cmd) { dispatch(cmd); });}).detach();
+    }
+  }
+  // one tiering loop over the heat recorded by all the instances
+  _tiering = _stripeStore->getTiering();
+  if (_conf->_tieringPeriodSec > 0 && _stripeStore->claimTask("tiering")) thread([=]{tieringWorker();}).detach();
+
+  // overwrites of updates committed before a restart, resumed by one instance only
+  if (_stripeStore->claimTask("resumeUpdates")) {
+    for (auto item: _stripeStore->getPendingUpdates()) {
+      cout << "Coordinator::Coordinator resume the update of " << item.first << endl;
+      writeUpdate(item.first, item.second, 0, "", "");
+    }
+  }
 }
 
 Coordinator::~Coordinator() {
   redisFree(_localCtx);
+  for (auto item: _updatePlans) delete item.second;
 }
 
 void Coordinator::doProcess() {
@@ -32,34 +52,153 @@ void Coordinator::doProcess() {
       char* reqStr = rReply -> element[1] -> str;
       CoorCommand* coorCmd = new CoorCommand(reqStr);
       coorCmd->dump();
-      int type = coorCmd->getType();
-      switch (type) {
-        case 0: registerFile(coorCmd); break;
-        case 1: getLocation(coorCmd); break;
-        case 2: finalizeFile(coorCmd); break;
-        case 3: getFileMeta(coorCmd); break;
-        case 4: offlineEnc(coorCmd); break;
-        case 5: offlineDegradedInst(coorCmd); break;
-        case 6: reportLost(coorCmd); break;
-        case 7: setECStatus(coorCmd); break;
-        case 8: repairReqFromSS(coorCmd); break;
-        case 9: onlineDegradedInst(coorCmd); break;
-        case 11: reportRepaired(coorCmd); break;
-        case 12: coorBenchmark(coorCmd); break;
-
-        // for ET
-        case 21: getHDFSMeta(coorCmd); break;
-        case 22: offlineDegradedET(coorCmd); break;
-
-        default: break;
+      if (isPlanning(coorCmd->getType())) {
+        // the planning pool deletes coorCmd
+        _stripeStore->getPlanPool()->push(coorCmd);
+      } else {
+        dispatch(coorCmd);
+        delete coorCmd;
       }
-      delete coorCmd;
     }
     // free reply object
     freeReplyObject(rReply);
   }
 }
 
+void Coordinator::dispatch(CoorCommand* coorCmd) {
+  int type = coorCmd->getType();
+  switch (type) {
+    case 0: registerFile(coorCmd); break;
+    case 1: getLocation(coorCmd); break;
+    case 2: finalizeFile(coorCmd); break;
+    case 3: getFileMeta(coorCmd); break;
+    case 4: offlineEnc(coorCmd); break;
+    case 5: offlineDegradedInst(coorCmd); break;
+    case 6: reportLost(coorCmd); break;
+    case 7: setECStatus(coorCmd); break;
+    case 8: repairReqFromSS(coorCmd); break;
+    case 9: onlineDegradedInst(coorCmd); break;
+    case 11: reportRepaired(coorCmd); break;
+    case 12: coorBenchmark(coorCmd); break;
+    case 13: setThrottle(coorCmd); break;
+    case 14: getThrottleUsage(coorCmd); break;
+    case 15: nodeRecovery(coorCmd); break;
+    case 16: getRecoveryProgress(coorCmd); break;
+    case 17: getMetaUsage(coorCmd); break;
+    case 18: getPlanStats(coorCmd); break;
+    case 19: offlineEncBatch(coorCmd); break;
+    case 20: convertPool(coorCmd); break;
+    case 25: getTieringReport(coorCmd); break;
+    case 26: repairBatch(coorCmd); break;
+    case 27: convertStripe(coorCmd); break;
+
+    // for ET
+    case 21: getHDFSMeta(coorCmd); break;
+    case 22: offlineDegradedET(coorCmd); break;
+    case 23: writeBackDegraded(coorCmd); break;
+    case 24: updateObj(coorCmd); break;
+
+    default: break;
+  }
+}
+
+bool Coordinator::isPlanning(int type) {
+  // encode, conversion, degraded read, repair and node recovery build ecdags and placements
+  return type == 4 || type == 5 || type == 8 || type == 9 || type == 15 || type == 19 || type == 20 || type == 22 || type == 23 || type == 24 || type == 26 || type == 27;
+}
+
+void Coordinator::getPlanStats(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  string stats = _stripeStore->getPlanPool()->getStats();
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush planstats %b", stats.c_str(), stats.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::getTieringReport(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  string report = _tiering->getReport();
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush tieringreport %b", report.c_str(), report.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::tieringWorker() {
+  chrono::seconds period(_conf->_tieringPeriodSec);
+  chrono::steady_clock::time_point next = chrono::steady_clock::now() + period;
+  while (true) {
+    this_thread::sleep_until(next);
+    chrono::steady_clock::time_point start = next;
+    next += period;
+    vector<TierMove> moves = _tiering->plan();
+
+    // 1. stripes within the budget, the others are planned again next period
+    double budgetMB = _conf->_tieringBudgetMB;
+    int nconvert = 0, nreencode = 0, ndefer = 0, nskip = 0, nbusy = 0;
+    double readMB = 0, failureMB = 0, observedMB = 0;
+    vector<TierMove> accepted;
+    for (auto move: moves) {
+      ETConvert* conv = _tiering->getConvert(move._from, move._to);
+      if (!conv->valid()) {
+        nskip++;
+        continue;
+      }
+      int basesizeMB = _stripeStore->getECPool(move._ecpoolid)->getBasesize();
+      double costMB = conv->getReadObjs() * basesizeMB;
+      if (costMB > budgetMB) {
+        ndefer++;
+        continue;
+      }
+      budgetMB -= costMB;
+      accepted.push_back(move);
+    }
+
+    // 2. conversions are spread over the period, so they do not burst into
+    // the encode lanes at its start. A stripe that is encoded, converted or
+    // updated meanwhile is skipped and planned again next period
+    string detail;
+    for (int i=0; i<accepted.size(); i++) {
+      TierMove move = accepted[i];
+      if (i > 0) this_thread::sleep_until(start + period * i / accepted.size());
+      if (!_stripeStore->claimECStripe(move._stripename, _conf->_ec_concurrent)) {
+        nbusy++;
+        continue;
+      }
+      ETConvert* conv = _tiering->getConvert(move._from, move._to);
+      int basesizeMB = _stripeStore->getECPool(move._ecpoolid)->getBasesize();
+      readMB += conv->getReadObjs() * basesizeMB;
+      _tiering->setPending(move._stripename, move._to->getPolicyId());
+      vector<AGCommand*> agCmds = planConvert(move._ecpoolid, move._stripename, move._to, conv);
+      distribute(agCmds);
+      for (auto agcmd: agCmds) delete agcmd;
+      if (conv->reencode()) nreencode++;
+      else nconvert++;
+
+      // 3. read of a single-node repair of the stripe, before and after
+      double fromMB = _tiering->getRepairMB(move._from, basesizeMB);
+      double toMB = _tiering->getRepairMB(move._to, basesizeMB);
+      failureMB += fromMB - toMB;
+      observedMB += move._repairs * (fromMB - toMB);
+      char buf[512];
+      snprintf(buf, sizeof(buf), "%s %s -> %s: reads %.2f, repairs %.2f, repair read %.2f -> %.2f MB\n",
+               move._stripename.c_str(), move._from->getPolicyId().c_str(), move._to->getPolicyId().c_str(),
+               move._reads, move._repairs, fromMB, toMB);
+      detail += string(buf);
+    }
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%lu stripes change tier: %d converted, %d re-encoded, %d deferred by budget, %d skipped, %d in progress\n"
+             "read %.2f MB of %d MB budget\n"
+             "expected repair read saved %.2f MB per failure of each moved stripe, %.2f MB at the observed repair rate\n",
+             moves.size(), nconvert, nreencode, ndefer, nskip, nbusy, readMB, _conf->_tieringBudgetMB, failureMB, observedMB);
+    string report = string(buf) + detail;
+    cout << "Coordinator::tieringWorker " << report;
+    _tiering->setReport(report);
+  }
+}
+
 void Coordinator::registerFile(CoorCommand* coorCmd) {
   unsigned int clientIp = coorCmd->getClientip();
   string filename = coorCmd->getFilename();
@@ -76,7 +215,7 @@ void Coordinator::registerOnlineEC(unsigned int clientIp, string filename, strin
   assert (!_stripeStore->existEntry(filename));
   // 1. get ec instance 
   ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
   int ecw = ecpolicy->getW();
@@ -141,7 +280,7 @@ void Coordinator::registerOnlineEC(unsigned int clientIp, string filename, strin
     printf("add obj %d for poolstore, size: %d\n", i, ecpool->getStripeObjList(stripename).size());
   }
 
-  _stripeStore->backupPoolStripe(ecpool->stripe2String(stripename));
+  _stripeStore->backupPoolStripe(_stripeStore->stripeRecord(ecpoolid, ecpool, stripename));
 
   ecpool->unlock();
 
@@ -211,7 +350,7 @@ void Coordinator::registerOfflineEC(unsigned int clientIp, string filename, stri
   ecpool->lock();
 
   // 2. get placement group 
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
   vector<vector<int>> group;
   ec->Place(group);
   unordered_map<int, vector<int>> idx2group;
@@ -311,38 +450,10 @@ void Coordinator::registerOfflineEC(unsigned int clientIp, string filename, stri
   delete agCmd;
 
   // free
-  delete ec;
 }
 
 vector<unsigned int> Coordinator::getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith) {
-  vector<unsigned int> toret;
-  // 0. check colocWith
-  // candidate should be within the same rack
-  for (int i=0; i<colocWith.size(); i++) {
-    int curIdx = colocWith[i];
-    // check whether this idx has been placed
-    // if this idx has been placed
-    if (placedIp.size() > curIdx) {
-      // then figure out 
-      unsigned int curIp = placedIp[curIdx];
-      // find corresponding rack for this ip
-      string rack = _conf->_ip2Rack[curIp];
-      // for all the ip in this rack, if :
-      // 1> this ip is not in toret
-      // 2> this ip is not in placedId
-      for (auto item:_conf->_rack2Ips[rack]) {
-        if (find(toret.begin(), toret.end(), item) == toret.end() && 
-            find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
-      }
-    }
-  }
-  // if there is no constraints in colocWith, we add all ips into toret except for placedIp
-  if (toret.size() == 0) {
-    for (auto item:_conf->_agentsIPs) {
-      if (find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
-    }
-  }
-  return toret; 
+  return PlanBuilder::candidates(_conf, placedIp, placedIdx, colocWith);
 }
 
 unsigned int Coordinator::chooseFromCandidates(vector<unsigned int> candidates, string policy, string type) {
@@ -409,6 +520,56 @@ unsigned int Coordinator::chooseFromCandidates(vector<unsigned int> candidates,
   }
 }
 
+void Coordinator::setNodeCost(ECBase* ec, vector<string> stripeobjs, vector<int> integrity) {
+  ec->SetNodeCost(getNodeCost(stripeobjs, integrity));
+}
+
+vector<double> Coordinator::getNodeCost(vector<string> stripeobjs, vector<int> integrity) {
+  // busy agents are the last choice as helpers, lost objects are not read
+  vector<double> cost;
+  for (int i=0; i<stripeobjs.size(); i++) {
+    if (integrity[i] == 0) {
+      cost.push_back(0);
+      continue;
+    }
+    SSEntry* ssentry = _stripeStore->getEntryFromObj(stripeobjs[i]);
+    unsigned int loc = ssentry->getLocOfObj(stripeobjs[i]);
+    cost.push_back(_stripeStore->getNodeCost(loc));
+  }
+  return cost;
+}
+
+unsigned int Coordinator::repairLoc(ECBase* ec, vector<string> stripeobjs, int lostidx) {
+  // as recoveryOffline relocates a lost obj: colocate with its group, avoid
+  // the other objs of the stripe, and follow a node recovery reservation
+  int ecn = stripeobjs.size();
+  vector<unsigned int> stripeips;
+  for (int i=0; i<ecn; i++) {
+    if (i == lostidx) stripeips.push_back(0);
+    else stripeips.push_back(_stripeStore->getEntryFromObj(stripeobjs[i])->getLocOfObj(stripeobjs[i]));
+  }
+  vector<vector<int>> group;
+  ec->Place(group);
+  vector<int> colocWith;
+  for (auto item: group) {
+    if (find(item.begin(), item.end(), lostidx) != item.end()) colocWith = item;
+  }
+  vector<unsigned int> placedIps;
+  vector<int> placedIdx;
+  for (int i=0; i<lostidx; i++) {
+    placedIdx.push_back(i);
+    placedIps.push_back(stripeips[i]);
+  }
+  vector<unsigned int> candidates = getCandidates(placedIps, placedIdx, colocWith);
+  for (int j=lostidx+1; j<ecn; j++) {
+    vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), stripeips[j]);
+    if (position != candidates.end()) candidates.erase(position);
+  }
+  unsigned int toret = _stripeStore->getRecoveryDest(stripeobjs[lostidx], candidates);
+  if (toret == 0) toret = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+  return toret;
+}
+
 void Coordinator::getLocation(CoorCommand* coorCmd) {
   unsigned int clientIp = coorCmd->getClientip();
   string objname = coorCmd->getFilename();
@@ -496,15 +657,75 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   string stripename = coorCmd->getStripeName();
   cout << "Coordinator::offlineEnc start for " << stripename << endl; 
 
+  vector<AGCommand*> agCmds = planOfflineEnc(ecpoolid, stripename);
+  distribute(agCmds);
+  for (auto agcmd: agCmds) delete agcmd;
+}
+
+void Coordinator::offlineEncBatch(CoorCommand* coorCmd) {
+  string ecpoolid = coorCmd->getECPoolId();
+  vector<string> stripenames = coorCmd->getStripeNames();
+  int nstripes = stripenames.size();
+  cout << "Coordinator::offlineEncBatch start for " << nstripes << " stripes of " << ecpoolid << endl;
+
+  // 1. plan each stripe and group its commands by agent, stripes of a
+  // placement pattern that is planned already rebind the commands of it
+  unordered_map<string, PlanTemplate*> templates;
+  unordered_map<unsigned int, vector<vector<AGCommand*>>> ip2cmds;
+  vector<AGCommand*> planned;
+  for (int i=0; i<nstripes; i++) {
+    vector<AGCommand*> agCmds = planOfflineEnc(ecpoolid, stripenames[i], &templates);
+    for (auto agcmd: agCmds) {
+      unsigned int ip = agcmd->getSendIp();
+      if (ip2cmds.find(ip) == ip2cmds.end()) ip2cmds.insert(make_pair(ip, vector<vector<AGCommand*>>(nstripes)));
+      ip2cmds[ip][i].push_back(agcmd);
+      planned.push_back(agcmd);
+    }
+  }
+
+  // 2. one command per agent carries the commands of all the stripes
+  vector<AGCommand*> batches;
+  for (auto item: ip2cmds) {
+    AGCommand* batchCmd = new AGCommand();
+    batchCmd->buildType15(15, item.first, min(nstripes, BATCH_WINDOW), item.second);
+    batchCmd->setPriority(AG_PRIO_ENCODE);
+    batches.push_back(batchCmd);
+  }
+  distribute(batches);
+
+  cout << "Coordinator::offlineEncBatch planned " << templates.size() << " placement patterns for " << nstripes << " stripes" << endl;
+
+  // the commands of templates are in planned
+  for (auto item: templates) delete item.second;
+  for (auto agcmd: batches) delete agcmd;
+  for (auto agcmd: planned) delete agcmd;
+}
+
+string Coordinator::placePattern(unordered_map<int, unsigned int> sid2ip, int n) {
+  string toret;
+  for (int i=0; i<n; i++) {
+    int sameip = i, samerack = i;
+    for (int j=0; j<i; j++) {
+      if (sid2ip[j] == sid2ip[i]) { sameip = j; break; }
+    }
+    for (int j=0; j<i; j++) {
+      if (_conf->_ip2Rack[sid2ip[j]] == _conf->_ip2Rack[sid2ip[i]]) { samerack = j; break; }
+    }
+    toret += to_string(sameip) + "." + to_string(samerack) + ",";
+  }
+  return toret;
+}
+
+vector<AGCommand*> Coordinator::planOfflineEnc(string ecpoolid, string stripename, unordered_map<string, PlanTemplate*>* templates) {
   // 0. given ecpoolid, get OfflineECPool
+  // the stripe is in ECInProgress, so no one else plans it and the pool is
+  // only locked when its maps are accessed
   OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid); 
-  ecpool->lock();
   ECPolicy* ecpolicy = ecpool->getEcpolicy(); 
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
   int n = ecpolicy->getN();
   int k = ecpolicy->getK();
   int w = ecpolicy->getW(); 
-  bool locality = ecpolicy->getLocality();
   int opt = ecpolicy->getOpt();
 
   vector<vector<int>> group;
@@ -516,17 +737,15 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
     }
   }
 
-  // 1. encode ecdag
-  ECDAG* ecdag = ec->Encode();
-  ecdag->reconstruct(opt);
-
-  // 2. collect physical information
+  // 1. collect physical information
   // stripeidx -> {objname, location}
   unordered_map<int, pair<string, unsigned int>> objlist;
   // stripeidx -> location
   unordered_map<int, unsigned int> sid2ip;
   // objs in current stripe (now we only have source objs)
+  ecpool->lock();
   vector<string> stripelist = ecpool->getStripeObjList(stripename); 
+  ecpool->unlock();
   // location for current stripe, indexed by stripe idx (now we only have source locations)
   vector<unsigned int> stripeips;
   // stripeplaced records the objnames that have been stored in this stripe
@@ -540,7 +759,7 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   int basesizeMB = ecpool->getBasesize();
   int pktnum = basesizeMB * 1048576/_conf->_pktSize;
   
-  // 2.1 get physical information for k source objs
+  // 1.1 get physical information for k source objs
   for (int i=0; i<stripelist.size(); i++) {
     int sid = i;
     string objname = stripelist[i];
@@ -553,7 +772,7 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
     stripeips.push_back(loc);
     stripeplaced.push_back(i);
   }
-  // 2.2 prepare physical information for m parity objs
+  // 1.2 prepare physical information for m parity objs
   vector<string> parityobj;
   for (int i=k; i<n; i++) {
     string objname = "/"+ecpoolid+"-"+stripename+"-"+to_string(i);
@@ -570,12 +789,13 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
     stripeplaced.push_back(i);
 
     // add parity obj to ecpool
+    ecpool->lock();
     ecpool->addObj(objname, stripename);
+    ecpool->unlock();
     // create ssentry for parity obj, only has 1 obj in it
     SSEntry* ssentry = new SSEntry(objname, 1, basesizeMB, ecpoolid, {objname}, {loc});
     _stripeStore->insertEntry(ssentry);
   }
-  ecpool->unlock();
 
   // debug info
 //  for (auto item: objlist) {
@@ -585,23 +805,47 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
 //    unsigned int ip = pair.second;
 //    cout << "stripe physical info: idx: " << sid << ", objname: " << objname << ", ip: " << RedisUtil::ip2Str(ip) << endl;
 //  }
-  
-  // 4. topological sorting
-  vector<int> sortedList = ecdag->toposort();
 
-  // 5. figure out corresponding ip for corresponding node
-  unordered_map<int, unsigned int> cid2ip;
-  for (int i=0; i<sortedList.size(); i++) {
-    int cidx = sortedList[i];
-    ECNode* node = ecdag->getNode(cidx);
-    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, n, k, w, locality);
-    // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_encode_policy, "encode");
-    cid2ip.insert(make_pair(cidx, curip));
+  // 2. the stripe finishes when all the persist commands report to the completion channel
+  StripeStore* ss = _stripeStore;
+  auto expectPersisted = [=](vector<string> persisted) {
+    ss->getCompletion()->expect(persisted, [=]() {
+      cout << "Coordinator::offlineEnc for " << stripename << " finishes" << endl;
+      // the pool record of the stripe also backs up the entries of parity objs
+      ss->finishECStripe(ecpoolid, stripename);
+    });
+  };
+
+  // 3. a stripe of a planned placement pattern rebinds the planned commands,
+  // opt 4 depends on the links of each location and is always planned
+  string pattern;
+  if (templates && opt != 4) {
+    pattern = to_string(stripelist.size()) + ":" + placePattern(sid2ip, n);
+    if (templates->find(pattern) != templates->end()) {
+      PlanTemplate* plan = (*templates)[pattern];
+      unordered_map<unsigned int, unsigned int> ipmap;
+      unordered_map<string, string> objmap;
+      for (auto item: plan->objlist) {
+        ipmap[item.second.second] = objlist[item.first].second;
+        objmap[item.second.first] = objlist[item.first].first;
+      }
+      vector<AGCommand*> toret;
+      for (auto agcmd: plan->cmds) toret.push_back(agcmd->rebind(stripename, ipmap, objmap));
+      vector<string> persisted;
+      for (auto obj: plan->persisted) persisted.push_back(objmap[obj]);
+      expectPersisted(persisted);
+      return toret;
+    }
   }
 
-  // optimize
-  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, n, k, w, sid2ip, _conf->_agentsIPs, locality);
+  // 4-5. encode ecdag, place and optimize it
+  unordered_map<int, unsigned int> cid2ip;
+  auto choose = [&](vector<unsigned int> candidates) {
+    return chooseFromCandidates(candidates, _conf->_encode_policy, "encode");
+  };
+  unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw;
+  if (opt == 4) linkBw = getLinkBw();
+  ECDAG* ecdag = PlanBuilder::build(_conf, ecpolicy, {}, {}, sid2ip, pktnum, linkBw, choose, cid2ip);
   ecdag->dump();
 
 //  for (auto item: cid2ip) {
@@ -614,39 +858,101 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, n, k, w, pktnum, objlist);
 
-  // 8. send commands to cmddistributor
-  vector<char*> todelete;
-  redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
+  // 8. wait for the persisted objs
+  vector<string> persisted;
+  for (auto agcmd: persistCmds) {
+    if (agcmd != NULL) persisted.push_back(agcmd->getWriteObjName());
+  }
+  expectPersisted(persisted);
+
+  // 9. commands that should be sent, the others are freed
+  vector<AGCommand*> toret = toSend(agCmds, persistCmds, AG_PRIO_ENCODE);
+
+  // 10. the commands serve as the template of the pattern if they only use
+  // the locations of the stripe
+  if (templates && opt != 4) {
+    unordered_set<unsigned int> stripelocs;
+    for (auto item: sid2ip) stripelocs.insert(item.second);
+    stripelocs.insert(0);
+    bool relative = true;
+    for (auto agcmd: toret) {
+      if (stripelocs.find(agcmd->getSendIp()) == stripelocs.end()) relative = false;
+      for (auto loc: agcmd->getPrevLocs()) {
+        if (stripelocs.find(loc) == stripelocs.end()) relative = false;
+      }
+    }
+    if (relative) {
+      PlanTemplate* plan = new PlanTemplate();
+      plan->objlist = objlist;
+      plan->cmds = toret;
+      plan->persisted = persisted;
+      templates->insert(make_pair(pattern, plan));
+    }
+  }
 
-  redisAppendCommand(distCtx, "MULTI");
-  for (auto item: agCmds) {
-    auto agcmd = item.second;
+  // free
+  delete ecdag;
+  return toret;
+}
+
+vector<AGCommand*> Coordinator::toSend(unordered_map<int, AGCommand*> agCmds, vector<AGCommand*> persistCmds, int prio) {
+  vector<AGCommand*> toret;
+  for (auto item: agCmds) persistCmds.push_back(item.second);
+  for (auto agcmd: persistCmds) {
     if (agcmd == NULL) continue;
-    unsigned int ip = agcmd->getSendIp();
-    ip = htonl(ip);
     if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
+      agcmd->setPriority(prio);
+      toret.push_back(agcmd);
+    } else {
+      delete agcmd;
     }
   }
-  for (auto agcmd: persistCmds) {
-    if (agcmd == NULL) continue;
+  return toret;
+}
+
+string Coordinator::nextParityName(string ecpoolid, string stripename, int idx, string curobj) {
+  // /ecpoolid-stripename-idx as encoded, then /ecpoolid-stripename-idx.v<version>
+  string prefix = "/"+ecpoolid+"-"+stripename+"-"+to_string(idx);
+  int version = curobj.length() > prefix.length() + 2 ? atoi(curobj.substr(prefix.length()+2).c_str()) : 0;
+  return prefix + ".v" + to_string(version+1);
+}
+
+void Coordinator::removeObjs(vector<string> objnames) {
+  if (objnames.size() == 0) return;
+  // the under fs has no removal, objs in hdfs are removed by libhdfs directly
+  if (_conf->_fsType != "HDFS3") {
+    cout << "Coordinator::removeObjs cannot remove " << objnames.size() << " objs from " << _conf->_fsType << endl;
+    return;
+  }
+  vector<string> params = _conf->_fsFactory[_conf->_fsType];
+  hdfsFS fs = hdfsConnect(params[0].c_str(), atoi(params[1].c_str()));
+  if (!fs) {
+    cerr << "Coordinator::removeObjs fail to connect to " << params[0] << endl;
+    return;
+  }
+  for (auto obj: objnames) {
+    if (hdfsDelete(fs, obj.c_str(), 0) != 0) cerr << "Coordinator::removeObjs fail to remove " << obj << endl;
+    else cout << "Coordinator::removeObjs " << obj << endl;
+  }
+  hdfsDisconnect(fs);
+}
+
+void Coordinator::distribute(vector<AGCommand*> agCmds) {
+  // send commands to cmddistributor in one transaction
+  vector<char*> todelete;
+  redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
+
+  redisAppendCommand(distCtx, "MULTI");
+  for (auto agcmd: agCmds) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
-    if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
-    }
+    char* cmdstr = agcmd->getCmd();
+    int cmLen = agcmd->getCmdLen();
+    char* todist = (char*)calloc(cmLen + 4, sizeof(char));
+    memcpy(todist, (char*)&ip, 4);
+    memcpy(todist+4, cmdstr, cmLen); 
+    todelete.push_back(todist);
+    redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
   }
   redisAppendCommand(distCtx, "EXEC");
 
@@ -660,31 +966,168 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   redisGetReply(distCtx, (void **)&distReply);
   freeReplyObject(distReply);
   redisFree(distCtx);
-  
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
+
+  for (auto item: todelete) free(item);
+}
+
+void Coordinator::convertPool(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  string ecpoolid = coorCmd->getECPoolId();
+  string ecid = coorCmd->getEcid();
+  cout << "Coordinator::convertPool start for " << ecpoolid << " to " << ecid << endl;
+
+  string report;
+  if (_conf->_ecPolicyMap.find(ecid) == _conf->_ecPolicyMap.end()) {
+    report = "error: unknown ec policy " + ecid + "\n";
+  } else if (_conf->_offlineECMap.find(ecpoolid) == _conf->_offlineECMap.end()) {
+    report = "error: unknown ec pool " + ecpoolid + "\n";
+  } else {
+    ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+    // a pool without any file yet has no stripe to convert
+    OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid, _conf->_ecPolicyMap[_conf->_offlineECMap[ecpoolid]], _conf->_offlineECBase[ecpoolid]);
+    int basesizeMB = ecpool->getBasesize();
+
+    // 1. the plan of each policy the stripes are converted from, shared with tiering
+    int nconvert = 0, nreencode = 0, nskip = 0;
+    double convertMB = 0, reencodeMB = 0;
+    for (auto stripename: _stripeStore->getEncodedStripes(ecpoolid)) {
+      ecpool->lock();
+      ECPolicy* from = _stripeStore->getStripePolicy(ecpool, stripename);
+      ecpool->unlock();
+      if (from == ecpolicy) continue;
+      ETConvert* conv = _tiering->getConvert(from, ecpolicy);
+      if (!conv->valid()) {
+        nskip++;
+        continue;
+      }
+
+      // 2. the stripestore sends the stripe once an encode slot is free, so
+      // no planning thread waits for a slot
+      _stripeStore->addConvertCandidate(ecpoolid, stripename, ecid);
+
+      if (conv->reencode()) nreencode++;
+      else nconvert++;
+      convertMB += conv->getReadObjs() * basesizeMB;
+      reencodeMB += conv->getReencodeObjs() * basesizeMB;
+    }
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s to %s: %d stripes scheduled for conversion, %d for re-encoding, %d skipped\nread %.2f MB, re-encode reads %.2f MB\n",
+             ecpoolid.c_str(), ecid.c_str(), nconvert, nreencode, nskip, convertMB, reencodeMB);
+    report = string(buf);
   }
-  cout << "Coordinator::offlineEnc for " << stripename << " finishes" << endl;
-  _stripeStore->finishECStripe(ecpool, stripename);
+  cout << "Coordinator::convertPool " << report;
+
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush convertreport %b", report.c_str(), report.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::convertStripe(CoorCommand* coorCmd) {
+  string ecpoolid = coorCmd->getECPoolId();
+  string stripename = coorCmd->getStripeName();
+  string ecid = coorCmd->getEcid();
+  ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
+
+  // the stripe is claimed by the stripestore, a stripe converted by an
+  // earlier request is released as it is
+  ecpool->lock();
+  ECPolicy* from = _stripeStore->getStripePolicy(ecpool, stripename);
+  ecpool->unlock();
+  ETConvert* conv = _tiering->getConvert(from, ecpolicy);
+  if (from == ecpolicy || !conv->valid()) {
+    cout << "Coordinator::convertStripe skip " << stripename << " to " << ecid << endl;
+    _stripeStore->finishECStripe(ecpoolid, stripename);
+    return;
+  }
+  cout << "Coordinator::convertStripe start for " << stripename << " to " << ecid << endl;
+
+  // its policy switches once the new parity is persisted
+  vector<AGCommand*> agCmds = planConvert(ecpoolid, stripename, ecpolicy, conv);
+  distribute(agCmds);
+  for (auto agcmd: agCmds) delete agcmd;
+}
+
+vector<AGCommand*> Coordinator::planConvert(string ecpoolid, string stripename, ECPolicy* ecpolicy, ETConvert* conv) {
+  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
+  string ecid = ecpolicy->getPolicyId();
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = conv->getW();
+  int base = conv->getParityBase();
+  bool locality = ecpolicy->getLocality();
+  int opt = ecpolicy->getOpt();
+  int basesizeMB = ecpool->getBasesize();
+  int pktnum = basesizeMB * 1048576/_conf->_pktSize;
 
-  // backup entry for parity obj
-  for (int i=0; i<parityobj.size(); i++) {
-    SSEntry* curentry = _stripeStore->getEntryFromObj(parityobj[i]);
-    _stripeStore->backupEntry(curentry->toString());
+  // 1. conversion ecdag, or encode ecdag of the new policy
+  ECDAG* ecdag = conv->plan();
+  if (conv->reencode()) ecdag->reconstruct(opt);
+
+  // 2. collect physical information, objs stay on their agents and the new
+  // parity objs are written next to the old ones under a new version
+  ecpool->lock();
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+  ecpool->unlock();
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  unordered_map<int, unsigned int> sid2ip;
+  vector<string> convertedobjs;
+  vector<string> persisted;
+  for (int i=0; i<n; i++) {
+    string objname = stripeobjs[i];
+    unsigned int loc = _stripeStore->getEntryFromObj(objname)->getLocOfObj(objname);
+    objlist[i] = make_pair(objname, loc);
+    sid2ip[i] = loc;
+    if (i < k) {
+      convertedobjs.push_back(objname);
+      continue;
+    }
+    string parityname = nextParityName(ecpoolid, stripename, i, objname);
+    objlist[base+i] = make_pair(parityname, loc);
+    sid2ip[base+i] = loc;
+    convertedobjs.push_back(parityname);
+    persisted.push_back(parityname);
+    SSEntry* ssentry = new SSEntry(parityname, 1, basesizeMB, ecpoolid, {parityname}, {loc});
+    _stripeStore->insertEntry(ssentry);
   }
-  
-  // free
+
+  // 3. figure out corresponding ip for corresponding node
+  vector<int> sortedList = ecdag->toposort();
+  unordered_map<int, unsigned int> cid2ip;
+  for (int i=0; i<sortedList.size(); i++) {
+    int cidx = sortedList[i];
+    ECNode* node = ecdag->getNode(cidx);
+    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, n, k, w, locality);
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_encode_policy, "encode");
+    cid2ip.insert(make_pair(cidx, curip));
+  }
+  if (conv->reencode()) {
+    if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, pktnum);
+    ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, n, k, w, sid2ip, _conf->_agentsIPs, locality);
+  }
+
+  // 4. parse for oec and add persist cmd
+  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, n, k, w, pktnum, objlist);
+  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, n, k, w, pktnum, objlist);
+
+  // 5. the policy of the stripe switches when all the new parity objs are
+  // persisted, the old ones are still read until then and removed after
+  StripeStore* ss = _stripeStore;
+  ss->getCompletion()->expect(persisted, [=]() {
+    cout << "Coordinator::planConvert for " << stripename << " to " << ecid << " finishes" << endl;
+    vector<string> retired = ss->convertStripe(ecpoolid, stripename, ecid, convertedobjs);
+    // the pool record of the stripe carries its policy and parity objs
+    ss->finishECStripe(ecpoolid, stripename);
+    thread([=]{removeObjs(retired);}).detach();
+  });
+
+  // 6. commands that should be sent, the others are freed
+  vector<AGCommand*> toret = toSend(agCmds, persistCmds, AG_PRIO_ENCODE);
+
   delete ecdag;
-  delete ec; 
-  for (auto item: agCmds) if (item.second) delete item.second;
-  for (auto item: persistCmds) if (item) delete item;
-  for (auto item: todelete) free(item);
+  return toret;
 }
 
 void Coordinator::setECStatus(CoorCommand* coorCmd) {
@@ -723,7 +1166,6 @@ void Coordinator::getFileMeta(CoorCommand* coorCmd) {
     // for onlineec
     string ecid = ssentry->getEcidpool();
     ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-    ECBase* ec = ecpolicy->createECClass();
     int ecn = ecpolicy->getN();
     int eck = ecpolicy->getK();
     int ecw = ecpolicy->getW();
@@ -735,10 +1177,10 @@ void Coordinator::getFileMeta(CoorCommand* coorCmd) {
     int tmpw = htonl(ecw);
     memcpy(filemeta + metaoff, (char*)&tmpw, 4); metaoff += 4;
 
-    delete ec;
   } else {
     // for offlineec
     vector<string> objlist = ssentry->getObjlist();
+    for (auto objname: objlist) _tiering->recordRead(objname);
     // append number of obj
     int numobjs=objlist.size();
     int tmpnum = htonl(numobjs);
@@ -778,7 +1220,7 @@ void Coordinator::onlineDegradedInst(CoorCommand* coorCmd) {
   assert(ssentry != NULL);
   string ecid = ssentry->getEcidpool();
   ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
   int ecw = ecpolicy->getW();
@@ -814,6 +1256,8 @@ void Coordinator::onlineDegradedInst(CoorCommand* coorCmd) {
     }
   }
   // obtain decode ecdag
+  // the shared instance may keep a cost of another request of this thread
+  ec->SetNodeCost(vector<double>());
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   vector<int> toposeq = ecdag->toposort();
   cout << "toposeq: ";
@@ -870,7 +1314,6 @@ void Coordinator::onlineDegradedInst(CoorCommand* coorCmd) {
   // delete
   for (int i=0; i<computetasks.size(); i++) delete computetasks[i];
   delete ecdag;
-  delete ec;
   free(instruction);
 }
 
@@ -878,6 +1321,7 @@ void Coordinator::offlineDegradedInst(CoorCommand* coorCmd) {
   unsigned int clientIp = coorCmd->getClientip();
   string lostobj = coorCmd->getFilename();
   _stripeStore->addLostObj(lostobj);
+  _tiering->recordDegraded(lostobj);
 
   // 1. given lostobj, find SSEntry and figure out opt version
   SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
@@ -892,12 +1336,17 @@ void Coordinator::offlineDegradedInst(CoorCommand* coorCmd) {
     printf("found suffix, encoded by offline encoding\n");
   }
 
+  // the pool is locked only when the degraded read looks up the stripe
   OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
   ecpool->lock();
-  ECPolicy* ecpolicy = ecpool->getEcpolicy();  
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, _stripeStore->getStripeForObj(ecpool, lostobj));
+  ecpool->unlock();
   int opt = ecpolicy->getOpt();
 
-  if (opt < 0) {
+  if (opt < 0 && ecpolicy->isET()) {
+    // ET codes read sub-packets of the helpers with cached plans
+    etOfflineDegrade(lostobj, clientIp, ecpool, ecpolicy);
+  } else if (opt < 0) {
     nonOptOfflineDegrade(lostobj, clientIp, ecpool, ecpolicy); 
     // 2. if opt version < 0, apply non-optimized degraded read
     // 2.1 in this case, we need ecdag, toposort and parseForClient
@@ -905,27 +1354,28 @@ void Coordinator::offlineDegradedInst(CoorCommand* coorCmd) {
     // 2.3 we need lostidx computetasks n, k, w to compute lost pkt
     // return: lostidx|n|k|w|loadn|objname-objidx|objname-objidx|..|computen|computetasks|
   } else {
-    optOfflineDegrade(lostobj, clientIp, ecpool, ecpolicy);
+    optOfflineDegrade(lostobj, clientIp, ecpool, ecpolicy, coorCmd->getStartPkt(), coorCmd->getPktNum());
     // 3. if opt version >=0, apply optimized degraded read
     // 3.1 in this case, we need ecdag, toposort and parseForOEC, which requires cid2ip, stripename, n,k,w,pktnum,objlist
     // after we create commands, we send these commands to corresponding Agenst
     // we only need to tell client where to fetch and key to fetch
     // return: num|key-ip|key-ip|..|
   }
-  ecpool->unlock();
 }
 
-void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy) {
+void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy, int startpkt, int pktnum) {
   // return |opt|stripename|num|key-ip|key-ip|...|
   cout << "Coordinator::optOfflineDegrade" << endl;
   int opt = ecpolicy->getOpt();  
 
   // 0. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
 
   // 1, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  ecpool->lock();
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+  ecpool->unlock();
   int lostidx;
   vector<int> integrity;
   for (int i=0; i<stripeobjs.size(); i++) {
@@ -953,6 +1403,7 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
   }
 
   // create ecdag
+  setNodeCost(ec, stripeobjs, integrity);
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   ecdag->reconstruct(opt);
 
@@ -989,15 +1440,27 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
     cid2ip.insert(make_pair(cidx, curip));
   }
 
-  // prepare pktnum for parseForOEC
+  // prepare pktnum for parseForOEC, only the requested packets are repaired
   int basesizeMB = ecpool->getBasesize();
-  int pktnum = basesizeMB * 1048576/_conf->_pktSize;
+  int objpktnum = basesizeMB * 1048576/_conf->_pktSize;
+  startpkt = min(max(startpkt, 0), objpktnum);
+  if (pktnum < 0 || startpkt + pktnum > objpktnum) pktnum = objpktnum - startpkt;
 
   // optimize
+  if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, pktnum);
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
 
   // 6. parse for oec
   unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
+  // disk reads start at the first requested packet, cached packets are numbered from 0
+  if (startpkt > 0) {
+    for (auto item: agCmds) {
+      AGCommand* agcmd = item.second;
+      if (agcmd == NULL) continue;
+      int type = agcmd->getType();
+      if (type == 2 || type == 7 || type == 12) agcmd->setReadStart(startpkt);
+    }
+  }
 
   // 7. figure out roots and their ip
   vector<int> headers = ecdag->getHeaders();
@@ -1053,6 +1516,7 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_FOREGROUND);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1078,7 +1542,6 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
 
   // delete
   delete ecdag;
-  delete ec;
   for (auto item: agCmds) if(item.second) delete item.second;
   for (auto item: todelete) free(item);
 }
@@ -1087,11 +1550,13 @@ void Coordinator::nonOptOfflineDegrade(string lostobj, unsigned int clientIp, Of
   cout << "Coordinator::nonOptOfflineDegrade" << endl;
   int opt = ecpolicy->getOpt(); 
   // 0, create ec instance
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
 
   // 1, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  ecpool->lock();
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+  ecpool->unlock();
   int lostidx;
   vector<int> integrity;
   for (int i=0; i<stripeobjs.size(); i++) {
@@ -1121,6 +1586,7 @@ void Coordinator::nonOptOfflineDegrade(string lostobj, unsigned int clientIp, Of
   }
 
   // need availcidx and toreccidx
+  setNodeCost(ec, stripeobjs, integrity);
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   vector<int> toposeq = ecdag->toposort();
  
@@ -1214,7 +1680,6 @@ void Coordinator::nonOptOfflineDegrade(string lostobj, unsigned int clientIp, Of
   // free
   for (auto task: computetasks) delete task;
   delete ecdag;
-  delete ec;
   free(instruction);
 }
 
@@ -1229,37 +1694,391 @@ void Coordinator::reportRepaired(CoorCommand* coorCmd) {
   _stripeStore->finishRepair(objname);
 }
 
-void Coordinator::repairReqFromSS(CoorCommand* coorCmd) {
-  string objname = coorCmd->getFilename();
-  cout << "Coordinator::repairReqFromSS.repair request for " << objname << endl;
+void Coordinator::writeBackDegraded(CoorCommand* coorCmd) {
+  // the client agent keeps the decoded obj as writeback:<obj>:0:<pktidx>
+  unsigned int clientIp = coorCmd->getClientip();
+  string lostobj = coorCmd->getFilename();
+  cout << "Coordinator::writeBackDegraded for " << lostobj << " from " << RedisUtil::ip2Str(clientIp) << endl;
+  string keybase = "writeback:" + lostobj;
 
-  // figure out ec type
-  SSEntry* ssentry = _stripeStore->getEntryFromObj(objname);
-  int redundancy = ssentry->getType();
+  // 1. an obj that is gone meanwhile is not written back
+  SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
+  if (ssentry == NULL) {
+    cout << "Coordinator::writeBackDegraded " << lostobj << " is not stored any more" << endl;
+    dropWriteBack(clientIp, keybase);
+    return;
+  }
+  string ecpoolid = ssentry->getEcidpool();
+  if (ecpoolid.find("_pool") == -1) ecpoolid += "_pool";
+  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
+  int pktnum = ecpool->getBasesize() * 1048576/_conf->_pktSize;
 
-  if (redundancy == 0) {
-    // return recoveryOnline(objname);
-    return recoveryOnlineHCIP(objname);
-  } else {
-    return recoveryOfflineHCIP(objname);
-    // return recoveryOffline(objname);
+  // 2. a repair in progress persists the obj anyway, drop the decoded copy
+  if (!_stripeStore->claimRepair(lostobj)) {
+    cout << "Coordinator::writeBackDegraded " << lostobj << " is in repair already" << endl;
+    dropWriteBack(clientIp, keybase);
+    return;
   }
-}
 
-void Coordinator::recoveryOnline(string lostobj) {
-  // we need ecdag, toposort and parseForOEC, which requires cid2ip, stripename, n,k,w,pktnum,objlist
-  // we also need to create persist command to persist repaired block
-  // after we create commands, we send these commands to corresponding Agenst
+  // 3. new location of the obj
+  ecpool->lock();
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, stripename);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+  ecpool->unlock();
+  int lostidx = find(stripeobjs.begin(), stripeobjs.end(), lostobj) - stripeobjs.begin();
+  ECBase* ec = ecpolicy->getECClass();
+  unsigned int loc = repairLoc(ec, stripeobjs, lostidx);
+
+  // 4. the new location fetches the obj from the client and persists it, the
+  // obj moves there once it is persisted, reads go to the old one until then
+  StripeStore* ss = _stripeStore;
+  string lostkey = ss->getCompletion()->tag(lostobj);
+  AGCommand* persistCmd = new AGCommand();
+  persistCmd->buildType5(5, loc, keybase, 1, pktnum, 1, {0}, {clientIp}, lostkey);
+  persistCmd->setPriority(AG_PRIO_REPAIR);
+  ss->getCompletion()->expect({lostkey}, [=]() {
+    cout << "Coordinator::writeBackDegraded for " << lostobj << " finishes" << endl;
+    SSEntry* entry = ss->getEntryFromObj(lostobj);
+    if (entry != NULL) entry->updateObjLoc(lostobj, loc);
+    ss->finishRepair(lostobj);
+  });
+  distribute({persistCmd});
+  delete persistCmd;
+}
 
-  // 0. given lostobj, find SSEntry and figure out opt version
-  SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
-  string ecid = ssentry->getEcidpool();
-  ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+void Coordinator::dropWriteBack(unsigned int clientIp, string keybase) {
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "keys %s:0:*", keybase.c_str());
+  vector<string> keys;
+  for (int i=0; i<rReply->elements; i++) keys.push_back(string(rReply->element[i]->str, rReply->element[i]->len));
+  freeReplyObject(rReply);
+  for (auto key: keys) redisAppendCommand(cliCtx, "DEL %s", key.c_str());
+  for (int i=0; i<keys.size(); i++) {
+    redisGetReply(cliCtx, (void**)&rReply);
+    freeReplyObject(rReply);
+  }
+  redisFree(cliCtx);
+}
 
-  // 1. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
+void Coordinator::updateObj(CoorCommand* coorCmd) {
+  // the client keeps the new obj as update:<filename>:<objidx>:0:<pktidx>
+  unsigned int clientIp = coorCmd->getClientip();
+  string filename = coorCmd->getFilename();
+  int objidx = coorCmd->getObjIdx();
+  cout << "Coordinator::updateObj for " << filename << ":" << objidx << " from " << RedisUtil::ip2Str(clientIp) << endl;
 
-  // 2, get stripeobjs for lostobj to figure out lostidx
+  // 1. the obj should be a data obj of an encoded stripe
+  string error;
+  SSEntry* ssentry = _stripeStore->getEntry(filename);
+  OfflineECPool* ecpool = NULL;
+  string ecpoolid, objname, stripename;
+  ECPolicy* ecpolicy = NULL;
+  vector<string> stripeobjs;
+  int dataidx = -1;
+  if (ssentry == NULL || ssentry->getType() != 1) {
+    error = filename + " is not an offline-encoded file";
+  } else if (objidx < 0 || objidx >= ssentry->getObjlist().size()) {
+    error = filename + " has no obj " + to_string(objidx);
+  } else {
+    ecpoolid = ssentry->getEcidpool();
+    objname = ssentry->getObjlist()[objidx];
+    ecpool = _stripeStore->getECPool(ecpoolid);
+    ecpool->lock();
+    stripename = _stripeStore->getStripeForObj(ecpool, objname);
+    ecpolicy = _stripeStore->getStripePolicy(ecpool, stripename);
+    stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+    ecpool->unlock();
+    dataidx = find(stripeobjs.begin(), stripeobjs.end(), objname) - stripeobjs.begin();
+    if (stripeobjs.size() != ecpolicy->getN()) error = objname + " is not encoded yet";
+  }
+
+  // 2. delta coefs of the policy for the data idx
+  ETUpdate* update = NULL;
+  if (error.empty()) {
+    string plankey = ecpolicy->getPolicyId() + ":" + to_string(dataidx);
+    _updatePlanLock.lock();
+    if (_updatePlans.find(plankey) == _updatePlans.end()) {
+      _updatePlans.insert(make_pair(plankey, new ETUpdate(ecpolicy, dataidx)));
+    } else {
+      cout << "Coordinator::updateObj reuse plan " << plankey << endl;
+    }
+    update = _updatePlans[plankey];
+    _updatePlanLock.unlock();
+    if (!update->valid()) error = objname + " cannot be updated by delta under " + ecpolicy->getPolicyId();
+  }
+
+  // 3. no conversion, tiering or other update of the stripe runs meanwhile,
+  // they would derive the same parity versions
+  if (error.empty() && !_stripeStore->claimECStripe(stripename, 0)) {
+    error = stripename + " of " + objname + " is in progress, retry later";
+  }
+
+  if (!error.empty()) {
+    cout << "Coordinator::updateObj " << error << endl;
+    string report = "error: " + error + "\n";
+    redisContext* cliCtx = RedisUtil::createContext(clientIp);
+    redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush updatereport:%s %b", filename.c_str(), report.c_str(), report.length());
+    freeReplyObject(rReply);
+    redisFree(cliCtx);
+    return;
+  }
+
+  string ecid = ecpolicy->getPolicyId();
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  int basesizeMB = ecpool->getBasesize();
+  int pktnum = basesizeMB * 1048576/_conf->_pktSize;
+  string keybase = "update:" + filename + ":" + to_string(objidx);
+  unsigned int dataloc = _stripeStore->getEntryFromObj(objname)->getLocOfObj(objname);
+
+  // 4. the new data is staged next to the old one first
+  CompletionChannel* completion = _stripeStore->getCompletion();
+  string stagedname = objname + ".update";
+  string stagedkey = completion->tag(stagedname);
+  AGCommand* stageCmd = new AGCommand();
+  stageCmd->buildType5(5, dataloc, keybase, 1, pktnum, 1, {0}, {clientIp}, stagedkey);
+  stageCmd->setPriority(AG_PRIO_ENCODE);
+
+  // 5. the data node computes the delta, parity nodes add it to their old
+  // parity and write the new parity next to the old one under a new version
+  ECDAG* ecdag = update->plan();
+  int base = update->getParityBase();
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  unordered_map<int, unsigned int> sid2ip;
+  vector<string> updatedobjs;
+  vector<string> persisted;
+  for (int i=0; i<n; i++) {
+    string curobj = stripeobjs[i];
+    unsigned int loc = _stripeStore->getEntryFromObj(curobj)->getLocOfObj(curobj);
+    objlist[i] = make_pair(curobj, loc);
+    sid2ip[i] = loc;
+    if (i < k) {
+      updatedobjs.push_back(curobj);
+      continue;
+    }
+    string parityname = nextParityName(ecpoolid, stripename, i, curobj);
+    string paritykey = completion->tag(parityname);
+    objlist[base+i] = make_pair(paritykey, loc);
+    sid2ip[base+i] = loc;
+    updatedobjs.push_back(parityname);
+    persisted.push_back(paritykey);
+    SSEntry* parityentry = new SSEntry(parityname, 1, basesizeMB, ecpoolid, {parityname}, {loc});
+    _stripeStore->insertEntry(parityentry);
+  }
+  objlist[update->getStagedIdx()] = make_pair(stagedname, dataloc);
+  sid2ip[update->getStagedIdx()] = dataloc;
+  sid2ip[update->getDeltaIdx()] = dataloc;
+
+  vector<int> sortedList = ecdag->toposort();
+  unordered_map<int, unsigned int> cid2ip;
+  for (int i=0; i<sortedList.size(); i++) {
+    int cidx = sortedList[i];
+    ECNode* node = ecdag->getNode(cidx);
+    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, n, k, w, ecpolicy->getLocality());
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_encode_policy, "encode");
+    cid2ip.insert(make_pair(cidx, curip));
+  }
+  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, n, k, w, pktnum, objlist);
+  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, n, k, w, pktnum, objlist);
+  vector<AGCommand*> deltaCmds = toSend(agCmds, persistCmds, AG_PRIO_ENCODE);
+  delete ecdag;
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s obj %d updated under %s: delta ships %.2f MB, re-encode reads %.2f MB\n",
+           filename.c_str(), objidx, ecid.c_str(), update->getDeltaObjs() * basesizeMB, (double)update->getReencodeObjs() * basesizeMB);
+  string report(buf);
+
+  // 6. each phase starts when the objs of the previous one are persisted.
+  // Until the new parity is persisted, the stripe keeps its old data and
+  // parity. Then it switches to the new parity in the same record that makes
+  // the overwrite from the staged obj pending, so a restart finishes it.
+  StripeStore* ss = _stripeStore;
+  completion->expect({stagedkey}, [=]() {
+    cout << "Coordinator::updateObj staged " << stagedname << endl;
+    distribute(deltaCmds);
+    for (auto agcmd: deltaCmds) delete agcmd;
+  });
+  completion->expect(persisted, [=]() {
+    cout << "Coordinator::updateObj parity of " << stripename << " updated" << endl;
+    vector<string> retired = ss->commitUpdate(ecpoolid, stripename, ecid, updatedobjs, objname, stagedname);
+    thread([=]{removeObjs(retired);}).detach();
+    writeUpdate(objname, stagedname, clientIp, filename, report);
+  });
+  distribute({stageCmd});
+  delete stageCmd;
+}
+
+void Coordinator::writeUpdate(string objname, string stagedname, unsigned int clientIp, string filename, string report) {
+  // 1. the stripe of the obj, which is in progress until the obj is written
+  SSEntry* ssentry = _stripeStore->getEntryFromObj(objname);
+  string ecpoolid = ssentry->getEcidpool();
+  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
+  ecpool->lock();
+  string stripename = _stripeStore->getStripeForObj(ecpool, objname);
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, stripename);
+  ecpool->unlock();
+  // an update committed before a restart claims its stripe, as updateObj does
+  if (!clientIp && !_stripeStore->claimECStripe(stripename, 0)) {
+    cout << "Coordinator::writeUpdate " << stripename << " is in progress, " << objname << " is resumed already" << endl;
+    return;
+  }
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int pktnum = ecpool->getBasesize() * 1048576/_conf->_pktSize;
+  unsigned int dataloc = ssentry->getLocOfObj(objname);
+
+  // 2. the data node copies the staged obj over the obj, packet by packet
+  CompletionChannel* completion = _stripeStore->getCompletion();
+  string objkey = completion->tag(objname);
+  int staged = 2*n;
+  int target = 2*n+2;
+  ECDAG* ecdag = new ECDAG();
+  ecdag->Join(target, {staged}, {1});
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  objlist[staged] = make_pair(stagedname, dataloc);
+  objlist[target] = make_pair(objkey, dataloc);
+  unordered_map<int, unsigned int> cid2ip;
+  cid2ip[staged] = dataloc;
+  cid2ip[target] = dataloc;
+  string keybase = stripename + ":write";
+  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, keybase, n, k, 1, pktnum, objlist);
+  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, keybase, n, k, 1, pktnum, objlist);
+  vector<AGCommand*> writeCmds = toSend(agCmds, persistCmds, AG_PRIO_ENCODE);
+  delete ecdag;
+
+  // 3. the pool record of the stripe goes before the update record is
+  // dropped, then the staged obj is removed
+  StripeStore* ss = _stripeStore;
+  completion->expect({objkey}, [=]() {
+    cout << "Coordinator::updateObj for " << objname << " finishes" << endl;
+    ss->finishECStripe(ecpoolid, stripename);
+    ss->finishUpdate(objname);
+    thread([=]{removeObjs({stagedname});}).detach();
+    if (!clientIp) return;
+    redisContext* cliCtx = RedisUtil::createContext(clientIp);
+    redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush updatereport:%s %b", filename.c_str(), report.c_str(), report.length());
+    freeReplyObject(rReply);
+    redisFree(cliCtx);
+  });
+  distribute(writeCmds);
+  for (auto agcmd: writeCmds) delete agcmd;
+}
+
+void Coordinator::repairReqFromSS(CoorCommand* coorCmd) {
+  string objname = coorCmd->getFilename();
+  cout << "Coordinator::repairReqFromSS.repair request for " << objname << endl;
+  _tiering->recordRepair(objname);
+
+  // figure out ec type
+  SSEntry* ssentry = _stripeStore->getEntryFromObj(objname);
+  if (ssentry == NULL) {
+    cout << "Coordinator::repairReqFromSS " << objname << " is not stored any more" << endl;
+    _stripeStore->failRepair(objname);
+    return;
+  }
+  int redundancy = ssentry->getType();
+
+  if (redundancy == 0) {
+    // recoveryOnline(objname);
+    recoveryOnlineHCIP(objname);
+  } else {
+    recoveryOfflineHCIP(objname);
+    // recoveryOffline(objname);
+  }
+  // finishRepair is called by the completion channel once the object is persisted
+}
+
+void Coordinator::repairBatch(CoorCommand* coorCmd) {
+  vector<string> objnames = coorCmd->getObjNames();
+  cout << "Coordinator::repairBatch start for " << objnames.size() << " objs" << endl;
+
+  // 1. plan the repair of each offline-encoded obj and group its commands by
+  // agent, replicated objs are repaired on their own
+  vector<string> planlist;
+  for (auto objname: objnames) {
+    _tiering->recordRepair(objname);
+    SSEntry* ssentry = _stripeStore->getEntryFromObj(objname);
+    if (ssentry == NULL) _stripeStore->failRepair(objname);
+    else if (ssentry->getType() == 0) recoveryOnlineHCIP(objname);
+    else planlist.push_back(objname);
+  }
+  int nobjs = planlist.size();
+  if (nobjs == 0) return;
+  unordered_map<unsigned int, vector<vector<AGCommand*>>> ip2cmds;
+  vector<AGCommand*> planned;
+  for (int i=0; i<nobjs; i++) {
+    vector<AGCommand*> agCmds = planRecoveryOffline(planlist[i]);
+    for (auto agcmd: agCmds) {
+      unsigned int ip = agcmd->getSendIp();
+      if (ip2cmds.find(ip) == ip2cmds.end()) ip2cmds.insert(make_pair(ip, vector<vector<AGCommand*>>(nobjs)));
+      ip2cmds[ip][i].push_back(agcmd);
+      planned.push_back(agcmd);
+    }
+  }
+
+  // 2. one command per agent carries the commands of all the repairs
+  vector<AGCommand*> batches;
+  for (auto item: ip2cmds) {
+    AGCommand* batchCmd = new AGCommand();
+    batchCmd->buildType15(15, item.first, min(nobjs, BATCH_WINDOW), item.second);
+    batchCmd->setPriority(AG_PRIO_REPAIR);
+    batches.push_back(batchCmd);
+  }
+  distribute(batches);
+
+  // finishRepair is called by the completion channel once each obj is persisted
+  for (auto agcmd: batches) delete agcmd;
+  for (auto agcmd: planned) delete agcmd;
+}
+
+void Coordinator::nodeRecovery(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  unsigned int failedIp = coorCmd->getAgentIp();
+  cout << "Coordinator::nodeRecovery for " << RedisUtil::ip2Str(failedIp) << endl;
+  int num = _stripeStore->startNodeRecovery(failedIp);
+
+  // return the number of lost objects scheduled for repair, -1 if another recovery is running
+  string toret = to_string(num);
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush noderecovery %b", toret.c_str(), toret.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::getRecoveryProgress(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  string progress = _stripeStore->getRecoveryProgress();
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush recoveryprogress %b", progress.c_str(), progress.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::getMetaUsage(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+  string usage = _stripeStore->getMetaUsage();
+  redisContext* cliCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush metausage %b", usage.c_str(), usage.length());
+  freeReplyObject(rReply);
+  redisFree(cliCtx);
+}
+
+void Coordinator::recoveryOnline(string lostobj) {
+  // we need ecdag, toposort and parseForOEC, which requires cid2ip, stripename, n,k,w,pktnum,objlist
+  // we also need to create persist command to persist repaired block
+  // after we create commands, we send these commands to corresponding Agenst
+
+  // 0. given lostobj, find SSEntry and figure out opt version
+  SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
+  string ecid = ssentry->getEcidpool();
+  ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+
+  // 1. create ec instances
+  ECBase* ec = ecpolicy->getECClass();
+
+  // 2, get stripeobjs for lostobj to figure out lostidx
   string filename = ssentry->getFilename();
   string stripename = filename; 
   vector<string> stripeobjs = ssentry->getObjlist();
@@ -1291,6 +2110,7 @@ void Coordinator::recoveryOnline(string lostobj) {
   }
 
   // create ecdag
+  setNodeCost(ec, stripeobjs, integrity);
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   ecdag->reconstruct(opt);
 
@@ -1342,8 +2162,9 @@ void Coordinator::recoveryOnline(string lostobj) {
           if (position != candidates.end()) candidates.erase(position);
         }
       }
-      // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      // now we choose a loc from candidates, a node recovery job may have reserved one
+      unsigned int curip = _stripeStore->getRecoveryDest(objlist[i].first, candidates);
+      if (curip == 0) curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1376,6 +2197,7 @@ void Coordinator::recoveryOnline(string lostobj) {
   int pktnum = objsizeMB * 1048576/_conf->_pktSize;
 
   // optimize
+  if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, pktnum);
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
 
   // 6. parse for oec
@@ -1385,7 +2207,16 @@ void Coordinator::recoveryOnline(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
+  // 8. the repair finishes when the persist commands report to the completion channel
+  vector<string> persisted;
+  for (auto agcmd: persistCmds) persisted.push_back(agcmd->getWriteObjName());
+  StripeStore* ss = _stripeStore;
+  ss->getCompletion()->expect(persisted, [=]() {
+    cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+    ss->finishRepair(lostobj);
+  });
+
+  // 9. send commands to cmddistributor
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
@@ -1396,6 +2227,7 @@ void Coordinator::recoveryOnline(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1409,6 +2241,7 @@ void Coordinator::recoveryOnline(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1431,19 +2264,7 @@ void Coordinator::recoveryOnline(string lostobj) {
   freeReplyObject(distReply);
   redisFree(distCtx);
 
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
-
   // delete
-  delete ec;
   delete ecdag;
   for (auto item: agCmds) if(item.second) delete item.second;
   for (auto item: persistCmds) if(item) delete item;
@@ -1461,7 +2282,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
   ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
 
   // 1. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
 
   // 2, get stripeobjs for lostobj to figure out lostidx
   string filename = ssentry->getFilename();
@@ -1495,6 +2316,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
   }
 
   // create ecdag
+  setNodeCost(ec, stripeobjs, integrity);
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   ecdag->reconstruct(opt);
 
@@ -1546,8 +2368,9 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
           if (position != candidates.end()) candidates.erase(position);
         }
       }
-      // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      // now we choose a loc from candidates, a node recovery job may have reserved one
+      unsigned int curip = _stripeStore->getRecoveryDest(objlist[i].first, candidates);
+      if (curip == 0) curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1591,6 +2414,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
   int pktnum = objsizeMB * 1048576/_conf->_pktSize;
 
   // optimize
+  if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, pktnum);
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
 
   // 6. parse for oec
@@ -1600,7 +2424,16 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
+  // 8. the repair finishes when the persist commands report to the completion channel
+  vector<string> persisted;
+  for (auto agcmd: persistCmds) persisted.push_back(agcmd->getWriteObjName());
+  StripeStore* ss = _stripeStore;
+  ss->getCompletion()->expect(persisted, [=]() {
+    cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+    ss->finishRepair(lostobj);
+  });
+
+  // 9. send commands to cmddistributor
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
@@ -1611,6 +2444,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1624,6 +2458,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1646,19 +2481,7 @@ void Coordinator::recoveryOnlineHCIP(string lostobj) {
   freeReplyObject(distReply);
   redisFree(distCtx);
 
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
-
   // delete
-  delete ec;
   delete ecdag;
   for (auto item: agCmds) if(item.second) delete item.second;
   for (auto item: persistCmds) if(item) delete item;
@@ -1671,14 +2494,14 @@ void Coordinator::recoveryOffline(string lostobj) {
   string ecpoolid = ssentry->getEcidpool();
   OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
   ecpool->lock();
-  ECPolicy* ecpolicy = ecpool->getEcpolicy();  
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, stripename);
 
   // 1. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
 
   // 2, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
   ecpool->unlock();
   int lostidx;
   vector<int> integrity;
@@ -1708,6 +2531,7 @@ void Coordinator::recoveryOffline(string lostobj) {
   }
 
   // create ecdag
+  setNodeCost(ec, stripeobjs, integrity);
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   ecdag->reconstruct(opt);
 
@@ -1759,8 +2583,9 @@ void Coordinator::recoveryOffline(string lostobj) {
           if (position != candidates.end()) candidates.erase(position);
         }
       }
-      // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      // now we choose a loc from candidates, a node recovery job may have reserved one
+      unsigned int curip = _stripeStore->getRecoveryDest(objlist[i].first, candidates);
+      if (curip == 0) curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1793,6 +2618,7 @@ void Coordinator::recoveryOffline(string lostobj) {
   int pktnum = objsizeMB * 1048576/_conf->_pktSize;
 
   // optimize 
+  if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, pktnum);
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
 
   // 6. parse for oec
@@ -1802,7 +2628,16 @@ void Coordinator::recoveryOffline(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
+  // 8. the repair finishes when the persist commands report to the completion channel
+  vector<string> persisted;
+  for (auto agcmd: persistCmds) persisted.push_back(agcmd->getWriteObjName());
+  StripeStore* ss = _stripeStore;
+  ss->getCompletion()->expect(persisted, [=]() {
+    cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+    ss->finishRepair(lostobj);
+  });
+
+  // 9. send commands to cmddistributor
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
@@ -1813,6 +2648,7 @@ void Coordinator::recoveryOffline(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1827,6 +2663,7 @@ void Coordinator::recoveryOffline(string lostobj) {
     unsigned int ip = agcmd->getSendIp();
     ip = htonl(ip);
     if (agcmd->getShouldSend()) {
+      agcmd->setPriority(AG_PRIO_REPAIR);
       char* cmdstr = agcmd->getCmd();
       int cmLen = agcmd->getCmdLen();
       char* todist = (char*)calloc(cmLen + 4, sizeof(char));
@@ -1849,19 +2686,7 @@ void Coordinator::recoveryOffline(string lostobj) {
   freeReplyObject(distReply);
   redisFree(distCtx);
 
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
-
   // delete
-  delete ec;
   delete ecdag;
   for (auto item: agCmds) if (item.second) delete item.second;
   for (auto item: persistCmds) if (item) delete item;
@@ -1869,19 +2694,30 @@ void Coordinator::recoveryOffline(string lostobj) {
 }
 
 void Coordinator::recoveryOfflineHCIP(string lostobj) {
+  vector<AGCommand*> agCmds = planRecoveryOffline(lostobj);
+  distribute(agCmds);
+  for (auto agcmd: agCmds) delete agcmd;
+}
+
+vector<AGCommand*> Coordinator::planRecoveryOffline(string lostobj) {
   // obtain needed information
   SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
+  if (ssentry == NULL) {
+    cout << "Coordinator::planRecoveryOffline " << lostobj << " is not stored any more" << endl;
+    _stripeStore->failRepair(lostobj);
+    return {};
+  }
   string ecpoolid = ssentry->getEcidpool();
   OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
   ecpool->lock();
-  ECPolicy* ecpolicy = ecpool->getEcpolicy();  
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, stripename);
 
   // 1. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
+  ECBase* ec = ecpolicy->getECClass();
 
   // 2, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
   ecpool->unlock();
   int lostidx;
   vector<int> integrity;
@@ -1894,25 +2730,10 @@ void Coordinator::recoveryOfflineHCIP(string lostobj) {
     }
   }
 
-  // prepare availcidx and toreccidx
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
   int ecw = ecpolicy->getW();
-  bool locality = ecpolicy->getLocality();
   int opt = ecpolicy->getOpt();
-  vector<int> availcidx;
-  vector<int> toreccidx;
-  for (int i=0; i<ecn; i++) {
-    if (i == lostidx) {
-      for (int j=0; j<ecw; j++) toreccidx.push_back(i*ecw+j);
-    } else {
-      for (int j=0; j<ecw; j++) availcidx.push_back(i*ecw+j);
-    }
-  }
-
-  // create ecdag
-  ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
-  ecdag->reconstruct(opt);
 
   // prepare sid2ip, for cip2ip
   // prepare stripeips for client info
@@ -1962,8 +2783,9 @@ void Coordinator::recoveryOfflineHCIP(string lostobj) {
           if (position != candidates.end()) candidates.erase(position);
         }
       }
-      // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      // now we choose a loc from candidates, a node recovery job may have reserved one
+      unsigned int curip = _stripeStore->getRecoveryDest(objlist[i].first, candidates);
+      if (curip == 0) curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1978,36 +2800,23 @@ void Coordinator::recoveryOfflineHCIP(string lostobj) {
     }
   }
  
-  vector<int> toposeq = ecdag->toposort();
-
-  // prepare cid2ip, for parseForOEC
-  unordered_map<int, unsigned int> cid2ip;
-  for (int i=0; i<toposeq.size(); i++) {
-    int cidx = toposeq[i];
-    ECNode* node = ecdag->getNode(cidx);
-    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality, lostidx);
-    // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
-
-    printf("before fixed IP: %d, %s\n", cidx, RedisUtil::ip2Str(curip).c_str());
-
-    // it's not a symbol to recover, fix the ip to the failed node
-    if (find(toreccidx.begin(), toreccidx.end(), cidx) == toreccidx.end()
-         && 
-        find(availcidx.begin(), availcidx.end(), cidx) == availcidx.end()) {
-      curip = sid2ip[lostidx];
-    }
-    printf("after: fixed IP: %d, %s\n", cidx, RedisUtil::ip2Str(curip).c_str());
-
-    cid2ip.insert(make_pair(cidx, curip));
-  }
-
   int filesizeMB = ssentry->getFilesizeMB();
   int objsizeMB = filesizeMB / eck;
   int pktnum = objsizeMB * 1048576/_conf->_pktSize;
 
-  // optimize 
-  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
+  // create ecdag with the load of the helpers, place and optimize it
+  unordered_map<int, unsigned int> cid2ip;
+  auto choose = [&](vector<unsigned int> candidates) {
+    return chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+  };
+  unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw;
+  if (opt == 4) linkBw = getLinkBw();
+  ECDAG* ecdag = PlanBuilder::build(_conf, ecpolicy, {lostidx}, getNodeCost(stripeobjs, integrity), sid2ip, pktnum, linkBw, choose, cid2ip);
+  if (ecdag == NULL) {
+    cout << "Coordinator::planRecoveryOffline " << ecpolicy->getPolicyId() << " does not decode " << lostobj << endl;
+    _stripeStore->failRepair(lostobj);
+    return {};
+  }
 
   // 6. parse for oec
   //vector<AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
@@ -2016,70 +2825,21 @@ void Coordinator::recoveryOfflineHCIP(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
-  vector<char*> todelete;
-  redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
-
-  redisAppendCommand(distCtx, "MULTI");
-  for (auto item: agCmds) {
-    auto agcmd = item.second;
-    if (agcmd == NULL) continue;
-    unsigned int ip = agcmd->getSendIp();
-    ip = htonl(ip);
-    if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
-    }
-  }
-  for (auto agcmd: persistCmds) {
-    if (agcmd == NULL) continue;
-    unsigned int ip = agcmd->getSendIp();
-    ip = htonl(ip);
-    if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
-    }
-  }
-  redisAppendCommand(distCtx, "EXEC");
+  // 8. the repair finishes when the persist commands report to the completion channel
+  vector<string> persisted;
+  for (auto agcmd: persistCmds) persisted.push_back(agcmd->getWriteObjName());
+  StripeStore* ss = _stripeStore;
+  ss->getCompletion()->expect(persisted, [=]() {
+    cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+    ss->finishRepair(lostobj);
+  });
+
+  // 9. commands that should be sent, the others are freed
+  vector<AGCommand*> toret = toSend(agCmds, persistCmds, AG_PRIO_REPAIR);
 
-  redisReply* distReply;
-  redisGetReply(distCtx, (void **)&distReply);
-  freeReplyObject(distReply);
-  for (auto item: todelete) {
-    redisGetReply(distCtx, (void **)&distReply);
-    freeReplyObject(distReply);
-  }
-  redisGetReply(distCtx, (void **)&distReply);
-  freeReplyObject(distReply);
-  redisFree(distCtx);
-
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
-
-  // delete
-  delete ec;
+  // free
   delete ecdag;
-  for (auto item: agCmds) if (item.second) delete item.second;
-  for (auto item: persistCmds) if (item) delete item;
-  for (auto item: todelete) free(item);
+  return toret;
 }
 
 void Coordinator::coorBenchmark(CoorCommand* coorCmd) {
@@ -2088,7 +2848,7 @@ void Coordinator::coorBenchmark(CoorCommand* coorCmd) {
   // plan to do simple ECDAG parsing in benchmark
   string ecid="rs_9_6";
   ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-  ECBase* ec=ecpolicy->createECClass();
+  ECBase* ec=ecpolicy->getECClass();
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
   int ecw = ecpolicy->getW();
@@ -2123,6 +2883,7 @@ void Coordinator::coorBenchmark(CoorCommand* coorCmd) {
     cid2ip.insert(make_pair(curcid, ip));
   }
 
+  if (opt == 4) ecdag->setLinkBw(getLinkBw(), _conf->_linkBwInner*1048576, _conf->_linkBwCross*1048576, _conf->_pktSize, 1);
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality || (opt>0));
   ecdag->dump();
 
@@ -2155,7 +2916,87 @@ void Coordinator::coorBenchmark(CoorCommand* coorCmd) {
   for (auto item: persistCmds) delete item;
   for (auto item: agCmds) delete item.second;
   delete ecdag;
-  delete ec;
+}
+
+void Coordinator::setThrottle(CoorCommand* coorCmd) {
+  unsigned int agentIp = coorCmd->getAgentIp();
+  int prio = coorCmd->getThrottlePrio();
+  int res = coorCmd->getThrottleRes();
+  int rateKB = coorCmd->getThrottleRateKB();
+  // clients of other versions may send classes or resources agents do not have
+  if (!Throttle::validPrio(prio) || !Throttle::validRes(res)) {
+    cout << "Coordinator::setThrottle unknown class " << prio << " or resource " << res << endl;
+    return;
+  }
+
+  for (auto ip: _conf->_agentsIPs) {
+    if (agentIp != 0 && agentIp != ip) continue;
+    AGCommand* agCmd = new AGCommand();
+    agCmd->buildType13(13, prio, res, rateKB);
+    agCmd->sendTo(ip);
+    delete agCmd;
+  }
+}
+
+void Coordinator::getThrottleUsage(CoorCommand* coorCmd) {
+  unsigned int clientIp = coorCmd->getClientip();
+
+  // 1. ask every agent to report to the key of this request, so reports
+  // that come after an earlier request gave up are not taken for this one
+  redisReply* idReply = (redisReply*)redisCommand(_localCtx, "incr throttleusage:reqid");
+  int reqid = idReply->integer;
+  freeReplyObject(idReply);
+  for (auto ip: _conf->_agentsIPs) {
+    AGCommand* agCmd = new AGCommand();
+    agCmd->buildType14(14, reqid);
+    agCmd->sendTo(ip);
+    delete agCmd;
+  }
+
+  // 2. collect reports for at most 5s off the request loop, agents that do
+  // not answer in time are skipped
+  thread([=]() {
+    string wkey = "throttleusage:" + to_string(reqid);
+    unordered_map<unsigned int, string> reports;
+    struct timeval start, now;
+    gettimeofday(&start, NULL);
+    redisContext* waitCtx = RedisUtil::createContext(_conf->_localIp);
+    while (reports.size() < _conf->_agentsIPs.size()) {
+      gettimeofday(&now, NULL);
+      int remain = 5 - (int)(RedisUtil::duration(start, now) / 1000);
+      if (remain <= 0) break;
+      redisReply* rReply = (redisReply*)redisCommand(waitCtx, "blpop %s %d", wkey.c_str(), remain);
+      if (rReply->type == REDIS_REPLY_ARRAY) {
+        string report(rReply->element[1]->str, rReply->element[1]->len);
+        int pos = report.find(" ");
+        if (pos != -1) reports[inet_addr(report.substr(0, pos).c_str())] = report.substr(pos + 1);
+      }
+      freeReplyObject(rReply);
+    }
+    redisReply* delReply = (redisReply*)redisCommand(waitCtx, "del %s", wkey.c_str());
+    freeReplyObject(delReply);
+    redisFree(waitCtx);
+
+    string summary;
+    for (auto ip: _conf->_agentsIPs) {
+      string ipstr = RedisUtil::ip2Str(ip);
+      if (reports.find(ip) == reports.end()) {
+        cout << "Coordinator::getThrottleUsage no report from " << ipstr << endl;
+        continue;
+      }
+      _throttleLock.lock();
+      _throttleUsage[ip] = reports[ip];
+      _throttleLock.unlock();
+      summary += ipstr + " " + reports[ip] + "\n";
+    }
+    cout << "Coordinator::getThrottleUsage" << endl << summary;
+
+    // 3. return to client
+    redisContext* cliCtx = RedisUtil::createContext(clientIp);
+    redisReply* rReply = (redisReply*)redisCommand(cliCtx, "rpush throttleusage %b", summary.c_str(), summary.length());
+    freeReplyObject(rReply);
+    redisFree(cliCtx);
+  }).detach();
 }
 
 void Coordinator::getHDFSMeta(CoorCommand* coorCmd) {
@@ -2211,140 +3052,157 @@ void Coordinator::offlineDegradedET(CoorCommand* coorCmd) {
   unsigned int clientIp = coorCmd->getClientip();
   string lostobj = coorCmd->getFilename();
   _stripeStore->addLostObj(lostobj);
+  _tiering->recordDegraded(lostobj);
   cout << "lostobj: " << lostobj << endl;
 
-  // 1. given lostobj, find SSEntry and figure out opt version
+  // 1. given lostobj, find SSEntry and the policy of its stripe
   SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
   string ecpoolid = ssentry->getEcidpool();
   OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid);
   ecpool->lock();
-  ECPolicy* ecpolicy = ecpool->getEcpolicy();
-  int opt = ecpolicy->getOpt();
+  ECPolicy* ecpolicy = _stripeStore->getStripePolicy(ecpool, _stripeStore->getStripeForObj(ecpool, lostobj));
+  ecpool->unlock();
 
-  // 0, create ec instance
-  ECBase* ec = ecpolicy->createECClass();
+  etOfflineDegrade(lostobj, clientIp, ecpool, ecpolicy);
+}
+
+void Coordinator::etOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy) {
+  // the same instruction as nonOptOfflineDegrade, the client reads only the
+  // sub-packets of each helper in the decode ecdag
+  cout << "Coordinator::etOfflineDegrade" << endl;
+  int opt = ecpolicy->getOpt();
 
   // 1, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  ecpool->lock();
+  string stripename = _stripeStore->getStripeForObj(ecpool, lostobj);
+  vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+  ecpool->unlock();
   int lostidx;
-  vector<int> integrity;
   for (int i=0; i<stripeobjs.size(); i++) {
-    if (lostobj == stripeobjs[i]) {
-      integrity.push_back(0);
-      lostidx = i;
-    } else {
-      integrity.push_back(1);
-    }
+    if (lostobj == stripeobjs[i]) lostidx = i;
   }
-  cout << "Coordinator::offlineDegradedET.lostidx = " << lostidx << endl;
+  cout << "Coordinator::etOfflineDegrade.lostidx = " << lostidx << endl;
 
-  // 2. we need n, k, w to obtain availcidx and toreccidx
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
   int ecw = ecpolicy->getW();
-  vector<int> availcidx;
-  vector<int> toreccidx;
-  for (int i=0; i<ecn; i++) {
-    if (i == lostidx) {
-      for (int j=0; j<ecw; j++) toreccidx.push_back(i*ecw+j);
-    } else {
-      for (int j=0; j<ecw; j++) availcidx.push_back(i*ecw+j);
-    }
-  }
-  
-  // need availcidx and toreccidx
-  ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
-  vector<int> toposeq = ecdag->toposort();
+  int loststripe = lostidx / ecn;
+  lostidx = lostidx % ecn;
+  vector<string> lostobjs;
+  for (int i=0; i<ecn; i++) lostobjs.push_back(stripeobjs[i + loststripe * ecn]);
 
-  // obtain information for source objs
+  // 2. decode ecdag of the policy for the lost idx, shared by all instances
+  ECDAG* ecdag = _stripeStore->getDegradedPlan(ecpolicy, lostidx);
+  // cached ecdags are only read from here on
+
+  // 3. sub-packets each helper loads
   vector<int> leaves = ecdag->getLeaves();
   vector<int> loadidx;
   vector<string> loadobjs;
-  vector<string> loadblks;
-  vector<unsigned int> loagagents;
   unordered_map<int, vector<int>> sid2Cids;
   for (int i=0; i<leaves.size(); i++) {
     int sidx = leaves[i]/ecw;
+
+    // (for shortening): skip loading shortening symbols
+    if (sidx >= ecn) continue;
+
     if (sid2Cids.find(sidx) == sid2Cids.end()) {
       vector<int> curlist = {leaves[i]};
       sid2Cids.insert(make_pair(sidx, curlist));
       loadidx.push_back(sidx);
-      loadobjs.push_back(stripeobjs[sidx]);
-      loadblks.push_back(_stripeStore->getHDFSBlkName(stripeobjs[sidx]));
+      loadobjs.push_back(lostobjs[sidx]);
     } else {
       sid2Cids[sidx].push_back(leaves[i]);
     }
   }
-//  // obtain computetask
-//  vector<ECTask*> computetasks;
-//  for (int i=0; i<toposeq.size(); i++) {
-//    ECNode* curnode = ecdag->getNode(toposeq[i]);
-//    curnode->parseForClient(computetasks);
-//  }
-//  for (int i=0; i<computetasks.size(); i++) computetasks[i]->dump();
-//
-//  char* instruction = (char*)calloc(1048576,sizeof(char));
-//  int offset = 0; 
-//
-//  // we need to return 
-//  // |opt|lostidx|ecn|eck|ecw|loadn|loadidx-objname|cidnum|cidxs|..|computen|computetask|..|
-//  int tmpopt = htonl(opt);
-//  memcpy(instruction + offset, (char*)&tmpopt, 4); offset += 4;
-//  int tmplostidx = htonl(lostidx);
-//  memcpy(instruction + offset, (char*)&tmplostidx, 4); offset += 4;
-//  int tmpecn = htonl(ecn);
-//  memcpy(instruction + offset, (char*)&tmpecn, 4); offset += 4;
-//  int tmpeck = htonl(eck);
-//  memcpy(instruction + offset, (char*)&tmpeck, 4); offset += 4;
-//  int tmpecw = htonl(ecw);
-//  memcpy(instruction + offset, (char*)&tmpecw, 4); offset += 4;
-//  int tmploadn = htonl(loadidx.size());
-//  memcpy(instruction + offset, (char*)&tmploadn, 4); offset += 4;
-//  for (int i=0; i<loadidx.size(); i++) {
-//    int tmpidx = htonl(loadidx[i]);
-//    memcpy(instruction + offset, (char*)&tmpidx, 4); offset += 4;
-//    // objname
-//    string loadobjname = loadobjs[i];
-//    int len = loadobjname.size();
-//    int tmpobjlen = htonl(len);
-//    memcpy(instruction + offset, (char*)&tmpobjlen, 4); offset += 4;
-//    memcpy(instruction + offset, loadobjname.c_str(), len); offset += len;
-//    vector<int> curlist = sid2Cids[loadidx[i]];
-//    // num cids
-//    int numcids = curlist.size();
-//    int tmpnumcids = htonl(numcids);
-//    memcpy(instruction + offset, (char*)&tmpnumcids, 4); offset += 4;
-//    for (int j=0; j<numcids; j++) {
-//      int curcid = curlist[j];
-//      int tmpcid = htonl(curcid);
-//      memcpy(instruction + offset, (char*)&tmpcid, 4); offset += 4;
-//    }
-//  }
-//  int computen = computetasks.size();
-//  int tmpcomputen = htonl(computen);
-//  memcpy(instruction + offset, (char*)&tmpcomputen, 4); offset += 4;
-// 
-//  // first send out info without compute
-//  string key = "offlinedegradedinst:"+lostobj;
-//  redisContext* sendCtx = RedisUtil::createContext(clientIp);
-//  redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", key.c_str(), instruction, offset);
-//  freeReplyObject(rReply);
-//  redisFree(sendCtx);
-//
-//  // then send out computetasks
-//  for (int i=0; i<computetasks.size(); i++) {
-//    ECTask* curcompute = computetasks[i];
-//    curcompute->buildType2();
-//    string key = "compute:"+lostobj+":"+to_string(i);
-//    curcompute->sendTo(key, clientIp);
-//  }
-//
-//  // free
-//  for (auto task: computetasks) delete task;
-//  delete ecdag;
-//  delete ec;
-//  free(instruction);
 
-  ecpool->unlock();
+  // 4. compute tasks in topological order
+  vector<ECTask*> computetasks;
+  vector<int> toposeq = ecdag->toposort();
+  for (int i=0; i<toposeq.size(); i++) {
+    ECNode* curnode = ecdag->getNode(toposeq[i]);
+    curnode->parseForClient(computetasks);
+  }
+
+  // 5. send |opt|lostidx|ecn|eck|ecw|loadn|loadidx-objname|cidnum|cidxs|..|computen| to client
+  char* instruction = (char*)calloc(1048576,sizeof(char));
+  int offset = 0;
+  int tmpopt = htonl(opt);
+  memcpy(instruction + offset, (char*)&tmpopt, 4); offset += 4;
+  int tmplostidx = htonl(lostidx);
+  memcpy(instruction + offset, (char*)&tmplostidx, 4); offset += 4;
+  int tmpecn = htonl(ecn);
+  memcpy(instruction + offset, (char*)&tmpecn, 4); offset += 4;
+  int tmpeck = htonl(eck);
+  memcpy(instruction + offset, (char*)&tmpeck, 4); offset += 4;
+  int tmpecw = htonl(ecw);
+  memcpy(instruction + offset, (char*)&tmpecw, 4); offset += 4;
+  int tmploadn = htonl(loadidx.size());
+  memcpy(instruction + offset, (char*)&tmploadn, 4); offset += 4;
+  int numcidsall = 0;
+  for (int i=0; i<loadidx.size(); i++) {
+    int tmpidx = htonl(loadidx[i]);
+    memcpy(instruction + offset, (char*)&tmpidx, 4); offset += 4;
+    string loadobjname = loadobjs[i];
+    int len = loadobjname.size();
+    int tmpobjlen = htonl(len);
+    memcpy(instruction + offset, (char*)&tmpobjlen, 4); offset += 4;
+    memcpy(instruction + offset, loadobjname.c_str(), len); offset += len;
+    vector<int> curlist = sid2Cids[loadidx[i]];
+    int numcids = curlist.size();
+    int tmpnumcids = htonl(numcids);
+    memcpy(instruction + offset, (char*)&tmpnumcids, 4); offset += 4;
+    for (int j=0; j<numcids; j++) {
+      int tmpcid = htonl(curlist[j]);
+      memcpy(instruction + offset, (char*)&tmpcid, 4); offset += 4;
+    }
+    numcidsall += numcids;
+  }
+  int tmpcomputen = htonl(computetasks.size());
+  memcpy(instruction + offset, (char*)&tmpcomputen, 4); offset += 4;
+  cout << "Coordinator::etOfflineDegrade load " << numcidsall << " sub-packets from " << loadidx.size()
+       << " helpers, " << computetasks.size() << " compute tasks" << endl;
+
+  string key = "offlinedegradedinst:"+lostobj;
+  redisContext* sendCtx = RedisUtil::createContext(clientIp);
+  redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", key.c_str(), instruction, offset);
+  freeReplyObject(rReply);
+  redisFree(sendCtx);
+
+  // 6. then send out computetasks
+  for (int i=0; i<computetasks.size(); i++) {
+    ECTask* curcompute = computetasks[i];
+    curcompute->buildType2();
+    string key = "compute:"+lostobj+":"+to_string(i);
+    curcompute->sendTo(key, clientIp);
+  }
+
+  // free, the ecdag stays in the stripestore
+  for (auto task: computetasks) delete task;
+  free(instruction);
+}
+
+unordered_map<unsigned int, unordered_map<unsigned int, double>> Coordinator::getLinkBw() {
+  // agents keep linkbw:<dst> up to date in the local redis, re-read it at most every 10s
+  lock_guard<mutex> lk(_linkBwLock);
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  if (_linkBwTime.tv_sec != 0 && RedisUtil::duration(_linkBwTime, now) < 10000) return _linkBw;
+  _linkBwTime = now;
+
+  redisContext* bwCtx = RedisUtil::createContext(_conf->_localIp);
+  for (auto ip: _conf->_agentsIPs) {
+    string key = "linkbw:" + RedisUtil::ip2Str(ip);
+    redisReply* rReply = (redisReply*)redisCommand(bwCtx, "hgetall %s", key.c_str());
+    if (rReply->type == REDIS_REPLY_ARRAY) {
+      for (int i=0; i+1<rReply->elements; i+=2) {
+        unsigned int src = inet_addr(rReply->element[i]->str);
+        double bw = atof(rReply->element[i+1]->str);
+        _linkBw[ip][src] = bw;
+      }
+    }
+    freeReplyObject(rReply);
+  }
+  redisFree(bwCtx);
+  return _linkBw;
 }
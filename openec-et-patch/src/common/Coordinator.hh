@@ -3,9 +3,14 @@
 
 //#include "AGCommand.hh"
 #include "Config.hh"
+#include "ETConvert.hh"
+#include "ETTiering.hh"
+#include "ETUpdate.hh"
 #include "FSObjInputStream.hh"
+#include "PlanBuilder.hh"
 //#include "RedisUtil.hh"
 #include "StripeStore.hh"
+#include "Throttle.hh"
 //#include "SSEntry.hh"
 //#include "UnderFile.hh"
 //#include "Util/hdfs.h"
@@ -20,6 +25,9 @@
 
 using namespace std;
 
+// stripes of a batch job that an agent runs at a time
+#define BATCH_WINDOW 4
+
 class Coordinator {
   private:
     Config* _conf;
@@ -27,6 +35,36 @@ class Coordinator {
     StripeStore* _stripeStore;
     UnderFS* _underfs;
 
+    // latest throttle usage reported by each agent
+    mutex _throttleLock;
+    unordered_map<unsigned int, string> _throttleUsage;
+
+    // link bandwidth observed by agents (dst -> src -> bytes/s), for opt 4
+    mutex _linkBwLock;
+    unordered_map<unsigned int, unordered_map<unsigned int, double>> _linkBw;
+    struct timeval _linkBwTime = {0, 0};
+
+
+    // delta coefs of updating a data obj, by policy and data idx
+    mutex _updatePlanLock;
+    unordered_map<string, ETUpdate*> _updatePlans;
+
+    // stripes move among the w of their code by temperature, every tiering
+    // period; shared through the stripestore, one instance runs the worker
+    ETTiering* _tiering;
+    void tieringWorker();
+
+    // commands planned for a stripe, rebound for the stripes of a batch with
+    // the same placement pattern
+    struct PlanTemplate {
+      unordered_map<int, pair<string, unsigned int>> objlist;
+      vector<AGCommand*> cmds;
+      vector<string> persisted;
+    };
+
+    bool isPlanning(int type);
+    void dispatch(CoorCommand* coorCmd);
+
   public:
     Coordinator(Config* conf, StripeStore* ss);
     ~Coordinator();
@@ -37,14 +75,51 @@ class Coordinator {
     void getLocation(CoorCommand* coorCmd);
     void finalizeFile(CoorCommand* coorCmd);
     void offlineEnc(CoorCommand* coorCmd);
+    // encode of many stripes, one command per agent. A stripe is planned once
+    // per placement pattern of the batch, the other stripes of the pattern
+    // only rebind names and locations of its commands
+    void offlineEncBatch(CoorCommand* coorCmd);
+    vector<AGCommand*> planOfflineEnc(string ecpoolid, string stripename, unordered_map<string, PlanTemplate*>* templates = NULL);
+    // which stripe idxs share a location and which share a rack
+    string placePattern(unordered_map<int, unsigned int> sid2ip, int n);
+    void distribute(vector<AGCommand*> agCmds);
+    // in-place conversion of the parity of encoded stripes to another policy,
+    // the stripes are scheduled by the stripestore and converted one by one
+    void convertPool(CoorCommand* coorCmd);
+    void convertStripe(CoorCommand* coorCmd);
+    vector<AGCommand*> planConvert(string ecpoolid, string stripename, ECPolicy* ecpolicy, ETConvert* conv);
+    // commands of an ecdag that should be sent, at prio, the others are freed
+    vector<AGCommand*> toSend(unordered_map<int, AGCommand*> agCmds, vector<AGCommand*> persistCmds, int prio);
+    // name of the next version of the parity obj idx of a stripe, as conversion and update write it
+    string nextParityName(string ecpoolid, string stripename, int idx, string curobj);
+    // delete objs that are no longer in any stripe from the underlying fs
+    void removeObjs(vector<string> objnames);
     void setECStatus(CoorCommand* coorCmd);
     void getFileMeta(CoorCommand* coorCmd);
     void reportLost(CoorCommand* coorCmd);
     void offlineDegradedInst(CoorCommand* coorCmd);
     void onlineDegradedInst(CoorCommand* coorCmd);
     void repairReqFromSS(CoorCommand* coorCmd);
+    // repair of many lost objs, one command per agent. Each repair is planned
+    // on its own, as the helpers depend on the load of the nodes
+    void repairBatch(CoorCommand* coorCmd);
     void reportRepaired(CoorCommand* coorCmd);
+    void writeBackDegraded(CoorCommand* coorCmd);
+    // drop the decoded copy of an obj the client agent keeps for write-back
+    void dropWriteBack(unsigned int clientIp, string keybase);
+    // overwrite a data obj of an encoded stripe, the parity is updated by delta
+    void updateObj(CoorCommand* coorCmd);
+    // copy the staged new data over a data obj whose stripe switched, the
+    // client at clientIp gets the report, none if the update is resumed
+    void writeUpdate(string objname, string stagedname, unsigned int clientIp, string filename, string report);
     void coorBenchmark(CoorCommand* coorCmd);
+    void setThrottle(CoorCommand* coorCmd);
+    void getThrottleUsage(CoorCommand* coorCmd);
+    void nodeRecovery(CoorCommand* coorCmd);
+    void getRecoveryProgress(CoorCommand* coorCmd);
+    void getMetaUsage(CoorCommand* coorCmd);
+    void getPlanStats(CoorCommand* coorCmd);
+    void getTieringReport(CoorCommand* coorCmd);
 
     // for ET
     void getHDFSMeta(CoorCommand* coorCmd);
@@ -53,17 +128,26 @@ class Coordinator {
     void registerOnlineEC(unsigned int clientIp, string filename, string ecid, int filesizeMB);
     void registerOfflineEC(unsigned int clientIp, string filename, string ecpoolid, int filesizeMB);
     vector<unsigned int> getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith);
+    unordered_map<unsigned int, unordered_map<unsigned int, double>> getLinkBw();
+    // new location of a lost obj of a stripe, by the repair placement
+    unsigned int repairLoc(ECBase* ec, vector<string> stripeobjs, int lostidx);
     unsigned int chooseFromCandidates(vector<unsigned int> candidates, string policy, string type); // policy:random/balance; type:control/data/other
+    // cost of reading each object of a stripe for ECBase::Decode
+    void setNodeCost(ECBase* ec, vector<string> stripeobjs, vector<int> integrity);
+    vector<double> getNodeCost(vector<string> stripeobjs, vector<int> integrity);
 //    void onlineECInst(string filename, SSEntry* ssentry, unsigned int ip);
 //    void offlineECInst(string filename, SSEntry* ssentry, unsigned int ip);
     void nonOptOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy);
-    void optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy);
+    // plans the repair of packets [startpkt, startpkt+pktnum) of lostobj, all packets if pktnum < 0
+    void optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy, int startpkt = 0, int pktnum = -1);
+    void etOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy);
     void recoveryOnline(string filename);
     void recoveryOffline(string filename);
 
     // hard-code ip
     void recoveryOnlineHCIP(string filename);
     void recoveryOfflineHCIP(string filename);
+    vector<AGCommand*> planRecoveryOffline(string lostobj);
 };
 
 #endif
@@ -0,0 +1,78 @@
+#include "ECDAGExecutor.hh"
+
+ECDAGExecutor::ECDAGExecutor(ECDAG* ecdag, int nw, int len) {
+  _nw = nw;
+  _len = len;
+  _zeros = (char*)calloc(len, sizeof(char));
+  for (auto cidx: ecdag->toposort()) {
+    ECNode* node = ecdag->getNode(cidx);
+    if (node->getChildNum() == 0) {
+      _leaves.push_back(cidx);
+      continue;
+    }
+    // a header of a bind node is computed by the bind node
+    if (node->getChildNum() == 1 && node->getChildren()[0]->getCoefmap().size() > 1) continue;
+
+    vector<int> children;
+    for (auto child: node->getChildren()) children.push_back(child->getNodeId());
+    vector<int> targets;
+    vector<int> matrix;
+    unordered_map<int, vector<int>> coefmap = node->getCoefmap();
+    if (coefmap.size() > 1) {
+      for (auto item: coefmap) {
+        targets.push_back(item.first);
+        matrix.insert(matrix.end(), item.second.begin(), item.second.end());
+      }
+    } else {
+      targets.push_back(cidx);
+      matrix = coefmap[cidx];
+    }
+    _targets.push_back(targets);
+    _children.push_back(children);
+    _matrix.push_back(matrix);
+  }
+}
+
+ECDAGExecutor::~ECDAGExecutor() {
+  for (auto item: _buffers) free(item.second);
+  free(_zeros);
+}
+
+bool ECDAGExecutor::run(unordered_map<int, char*>& known, ExecStats& stats) {
+  unordered_map<int, char*> value;
+  for (auto cidx: _leaves) {
+    if (known.find(cidx) != known.end()) value[cidx] = known[cidx];
+    else if (cidx >= _nw) value[cidx] = _zeros;
+    else {
+      cout << "ECDAGExecutor::run leaf " << cidx << " is not available" << endl;
+      return false;
+    }
+  }
+
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  for (int op=0; op<_targets.size(); op++) {
+    vector<int>& targets = _targets[op];
+    vector<int>& children = _children[op];
+    vector<char*> code;
+    for (auto cidx: targets) {
+      if (_buffers.find(cidx) == _buffers.end()) {
+        _buffers[cidx] = (char*)calloc(_len, sizeof(char));
+        stats._buffers++;
+      }
+      code.push_back(_buffers[cidx]);
+      value[cidx] = _buffers[cidx];
+    }
+    vector<char*> data;
+    for (auto child: children) data.push_back(value[child]);
+    Computation::Multi(code.data(), data.data(), _matrix[op].data(), targets.size(), children.size(), _len, "Isal");
+    stats._touchedBytes += (long)(children.size() + targets.size()) * _len;
+  }
+  gettimeofday(&time2, NULL);
+  stats._ms += RedisUtil::duration(time1, time2);
+  return true;
+}
+
+char* ECDAGExecutor::get(int cidx) {
+  return _buffers.find(cidx) == _buffers.end() ? NULL : _buffers[cidx];
+}
@@ -0,0 +1,49 @@
+#ifndef _ECDAGEXECUTOR_HH_
+#define _ECDAGEXECUTOR_HH_
+
+#include "../ec/Computation.hh"
+#include "../ec/ECDAG.hh"
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+class ExecStats {
+  public:
+    long _outBytes = 0;  // bytes of the symbols asked for
+    long _touchedBytes = 0;  // bytes read and written by the computation
+    long _planAllocs = 0;  // heap allocations of building the ecdag
+    int _buffers = 0;  // sub-packet buffers of computed symbols
+    double _ms = 0;
+};
+
+/**
+ * Runs an ecdag on sub-packets in memory, as the agents of a stripe would
+ * together, in topological order. Leaves are given, or read as zeros if
+ * they are shortened; every other symbol is computed from its children by
+ * the same Computation::Multi as the agents, into a buffer of its own that
+ * is kept across runs. A bind node of BindX computes all its headers in one
+ * multi-row op, as in ECNode::parseForClient, and the headers are not
+ * computed again.
+ */
+class ECDAGExecutor {
+  private:
+    int _len;
+    int _nw;
+    char* _zeros;
+    vector<int> _leaves;
+    vector<vector<int>> _targets;  // symbols of each op, in topological order
+    vector<vector<int>> _children;
+    vector<vector<int>> _matrix;  // targets x children, row by row
+    unordered_map<int, char*> _buffers;
+
+  public:
+    ECDAGExecutor(ECDAG* ecdag, int nw, int len);
+    ~ECDAGExecutor();
+
+    // false if a leaf is neither given nor shortened
+    bool run(unordered_map<int, char*>& known, ExecStats& stats);
+    char* get(int cidx);
+};
+
+#endif
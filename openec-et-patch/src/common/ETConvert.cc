@@ -0,0 +1,228 @@
+#include "ETConvert.hh"
+
+ETConvert::ETConvert(ECPolicy* from, ECPolicy* to, int pktsize) {
+  _from = from;
+  _to = to;
+  _pktsize = pktsize;
+  _n = to->getN();
+  _k = to->getK();
+  int w1 = from->getW();
+  int w2 = to->getW();
+  int a = w1, b = w2;
+  while (b) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  _w = w1 / a * w2;
+
+  if (from->getN() != _n || from->getK() != _k) {
+    cout << "ETConvert::ETConvert " << from->getPolicyId() << " and " << to->getPolicyId() << " differ in (n,k)" << endl;
+    return;
+  }
+  unordered_map<int, vector<int>> oldParity;
+  unordered_map<int, vector<int>> newParity;
+  if (!evaluate(from, _w, oldParity) || !evaluate(to, _w, newParity)) return;
+  _valid = true;
+  solve(oldParity, newParity);
+}
+
+bool ETConvert::evaluate(ECPolicy* ecpolicy, int fineW, unordered_map<int, vector<int>>& parity) {
+  ECBase* ec = ecpolicy->getECClass();
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  int r = fineW / w;
+
+  // 0. stripe idx and sub-packet of each symbol
+  unordered_map<int, pair<int, int>> cid2off;
+  vector<vector<int>> layout = ec->GetLayout();
+  for (int sp=0; sp<layout.size(); sp++) {
+    for (int i=0; i<layout[sp].size(); i++) cid2off[layout[sp][i]] = make_pair(i, sp);
+  }
+  for (int cidx=0; cidx<n*w; cidx++) {
+    if (cid2off.find(cidx) == cid2off.end()) cid2off[cidx] = make_pair(cidx/w, cidx%w);
+  }
+
+  // 1. coefs of each symbol over the k*w data sub-packets, in topological order
+  ECDAG* ecdag = ec->Encode();
+  unordered_map<int, vector<int>> value;
+  bool toret = true;
+  for (auto cidx: ecdag->toposort()) {
+    ECNode* node = ecdag->getNode(cidx);
+    // a bind node of BindX computes its headers, which are evaluated through it
+    if (node->getCoefmap().size() > 1) continue;
+    vector<int> cur(k*w, 0);
+    if (node->getChildNum() == 0) {
+      // symbols beyond the stripe are shortened and read as zeros
+      if (cidx < n*w) {
+        pair<int, int> off = cid2off[cidx];
+        if (off.first >= k) {
+          toret = false;
+          break;
+        }
+        cur[off.first*w + off.second] = 1;
+      }
+    } else {
+      vector<ECNode*> children = node->getChildren();
+      vector<int> coefs = node->getCoefmap()[cidx];
+      for (int i=0; i<children.size(); i++) {
+        // terms of the child, a bind node contributes its children by the coefs of cidx
+        vector<ECNode*> terms = {children[i]};
+        vector<int> termCoefs = {coefs[i]};
+        if (children[i]->getCoefmap().size() > 1) {
+          terms = children[i]->getChildren();
+          termCoefs = children[i]->getCoefmap()[cidx];
+          for (int t=0; t<termCoefs.size(); t++) termCoefs[t] = galois_single_multiply(termCoefs[t], coefs[i], 8);
+        }
+        for (int t=0; t<terms.size(); t++) {
+          vector<int>& child = value[terms[t]->getNodeId()];
+          for (int j=0; j<cur.size(); j++) {
+            if (child[j]) cur[j] ^= galois_single_multiply(child[j], termCoefs[t], 8);
+          }
+        }
+      }
+    }
+    value.insert(make_pair(cidx, cur));
+  }
+
+  // 2. parity sub-packets at the fine sub-packetization
+  for (int cidx=0; cidx<n*w && toret; cidx++) {
+    pair<int, int> off = cid2off[cidx];
+    if (off.first < k) continue;
+    if (value.find(cidx) == value.end()) {
+      toret = false;
+      break;
+    }
+    vector<int>& coarse = value[cidx];
+    for (int t=0; t<r; t++) {
+      vector<int> fine(k*fineW, 0);
+      for (int d=0; d<k; d++) {
+        for (int j=0; j<w; j++) fine[d*fineW + j*r + t] = coarse[d*w + j];
+      }
+      parity.insert(make_pair(off.first*fineW + off.second*r + t, fine));
+    }
+  }
+  if (!toret) cout << "ETConvert::evaluate " << ecpolicy->getPolicyId() << " is not linear over data" << endl;
+
+  delete ecdag;
+  return toret;
+}
+
+void ETConvert::solve(unordered_map<int, vector<int>>& oldParity, unordered_map<int, vector<int>>& newParity) {
+  int cols = _k*_w;
+
+  // 1. echelon form of the old parity, each row keeps its combination of old parity sub-packets
+  vector<int> oldids;
+  for (int p=_k; p<_n; p++) {
+    for (int j=0; j<_w; j++) oldids.push_back(p*_w + j);
+  }
+  vector<vector<int>> rows;
+  vector<vector<int>> combos;
+  vector<int> pivots;
+  for (int i=0; i<oldids.size(); i++) {
+    vector<int> row = oldParity[oldids[i]];
+    vector<int> combo(oldids.size(), 0);
+    combo[i] = 1;
+    for (int l=0; l<rows.size(); l++) {
+      int f = row[pivots[l]];
+      if (!f) continue;
+      for (int c=0; c<cols; c++) row[c] ^= galois_single_multiply(f, rows[l][c], 8);
+      for (int c=0; c<combo.size(); c++) combo[c] ^= galois_single_multiply(f, combos[l][c], 8);
+    }
+    int pivot = find_if(row.begin(), row.end(), [](int v) { return v != 0; }) - row.begin();
+    if (pivot == cols) continue;
+    int inv = galois_single_divide(1, row[pivot], 8);
+    for (int c=0; c<cols; c++) row[c] = galois_single_multiply(inv, row[c], 8);
+    for (int c=0; c<combo.size(); c++) combo[c] = galois_single_multiply(inv, combo[c], 8);
+    rows.push_back(row);
+    combos.push_back(combo);
+    pivots.push_back(pivot);
+  }
+
+  // 2. reduce each new parity sub-packet, what remains is read from data
+  set<int> read;
+  for (int p=_k; p<_n; p++) {
+    for (int j=0; j<_w; j++) {
+      vector<int> target = newParity[p*_w + j];
+      vector<int> combo(oldids.size(), 0);
+      for (int l=0; l<rows.size(); l++) {
+        int f = target[pivots[l]];
+        if (!f) continue;
+        for (int c=0; c<cols; c++) target[c] ^= galois_single_multiply(f, rows[l][c], 8);
+        for (int c=0; c<combo.size(); c++) combo[c] ^= galois_single_multiply(f, combos[l][c], 8);
+      }
+      vector<pair<int, int>> parityTerms;
+      vector<pair<int, int>> dataTerms;
+      for (int c=0; c<combo.size(); c++) {
+        if (!combo[c]) continue;
+        parityTerms.push_back(make_pair(oldids[c], combo[c]));
+        read.insert(oldids[c]);
+      }
+      for (int c=0; c<cols; c++) {
+        if (!target[c]) continue;
+        dataTerms.push_back(make_pair(c, target[c]));
+        read.insert(c);
+      }
+      _parityTerms.push_back(parityTerms);
+      _dataTerms.push_back(dataTerms);
+    }
+  }
+  _readSymbols = read.size();
+  _reencode = _readSymbols >= _k*_w || _pktsize % _w != 0;
+  cout << "ETConvert::solve " << _from->getPolicyId() << " -> " << _to->getPolicyId()
+       << " reads " << _readSymbols << " of " << _n*_w << " sub-packets, re-encode reads " << _k*_w << endl;
+}
+
+bool ETConvert::valid() {
+  return _valid;
+}
+
+bool ETConvert::reencode() {
+  return _reencode;
+}
+
+int ETConvert::getW() {
+  return _reencode ? _to->getW() : _w;
+}
+
+int ETConvert::getParityBase() {
+  return _reencode ? 0 : _n;
+}
+
+double ETConvert::getReadObjs() {
+  return _reencode ? _k : (double)_readSymbols / _w;
+}
+
+int ETConvert::getReencodeObjs() {
+  return _k;
+}
+
+ECDAG* ETConvert::plan() {
+  if (!_valid) return NULL;
+  if (_reencode) {
+    ECBase* ec = _to->getECClass();
+    ECDAG* ecdag = ec->Encode();
+    return ecdag;
+  }
+
+  ECDAG* ecdag = new ECDAG();
+  int idx = 0;
+  for (int p=_k; p<_n; p++) {
+    for (int j=0; j<_w; j++, idx++) {
+      vector<int> children;
+      vector<int> coefs;
+      for (auto item: _parityTerms[idx]) {
+        children.push_back(item.first);
+        coefs.push_back(item.second);
+      }
+      for (auto item: _dataTerms[idx]) {
+        children.push_back(item.first);
+        coefs.push_back(item.second);
+      }
+      assert(children.size() > 0);
+      ecdag->Join((_n+p)*_w + j, children, coefs);
+    }
+  }
+  return ecdag;
+}
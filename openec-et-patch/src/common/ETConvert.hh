@@ -0,0 +1,69 @@
+#ifndef _ETCONVERT_HH_
+#define _ETCONVERT_HH_
+
+#include "../ec/ECDAG.hh"
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+
+using namespace std;
+
+/**
+ * Plan of converting the parity of a stripe in place between two codes of
+ * the same (n,k), e.g., ETRSConv_14_10_4 and ETRSConv_14_10_16. Both codes
+ * are viewed at the fine sub-packetization W = lcm(w1, w2), where
+ * sub-packet j of a code of w sub-packets is fine sub-packets
+ * j*W/w..(j+1)*W/w-1.
+ *
+ * Each parity sub-packet of both codes is evaluated from the encode ecdag
+ * as a combination of data sub-packets. Every new parity sub-packet is
+ * then expressed as a combination of old parity sub-packets, plus the
+ * data sub-packets the old parity cannot cancel, as data groups of ET
+ * codes are decoupled before the base code encodes them. Data objects are
+ * only read and never written.
+ *
+ * Symbols of the conversion ecdag are node*W+j for data and old parity
+ * sub-packets, and (n+node)*W+j for new parity sub-packets, so the new
+ * parity of node is persisted as stripe idx n+node. If re-encoding reads
+ * less, or W does not divide the packet size, the plan is the encode
+ * ecdag of the new code instead.
+ */
+class ETConvert {
+  private:
+    ECPolicy* _from;
+    ECPolicy* _to;
+    int _n, _k, _w;
+    bool _valid = false;
+    bool _reencode = true;
+    int _pktsize;
+
+    // new parity sub-packet -> (old parity sub-packets, coefs) and (data sub-packets, coefs)
+    vector<vector<pair<int, int>>> _parityTerms;
+    vector<vector<pair<int, int>>> _dataTerms;
+    int _readSymbols = 0;  // sub-packets of W read by the conversion
+
+    void solve(unordered_map<int, vector<int>>& oldParity, unordered_map<int, vector<int>>& newParity);
+
+  public:
+    // parity sub-packet (node*fineW+j) -> coefs over the k*fineW fine data
+    // sub-packets, fineW is a multiple of the w of ecpolicy
+    static bool evaluate(ECPolicy* ecpolicy, int fineW, unordered_map<int, vector<int>>& parity);
+
+    // agents slice each packet into W sub-packets
+    ETConvert(ECPolicy* from, ECPolicy* to, int pktsize);
+
+    // the codes share (n,k) and their encode ecdags are linear over data
+    bool valid();
+    // re-encoding from data reads no more than the conversion
+    bool reencode();
+    // sub-packetization of the plan, W for a conversion, w2 for a re-encode
+    int getW();
+    // offset of the stripe idx of new parity objs, n for a conversion, 0 for a re-encode
+    int getParityBase();
+    // objs read by the plan and by a re-encode
+    double getReadObjs();
+    int getReencodeObjs();
+
+    ECDAG* plan();
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "ETSearch.hh"
+
+#include <unistd.h>
+
+// the code prints its layouts and repairs, keep them out of the report
+static int muteStdout() {
+  fflush(stdout);
+  cout.flush();
+  int saved = dup(1);
+  int devnull = open("/dev/null", O_WRONLY);
+  dup2(devnull, 1);
+  close(devnull);
+  return saved;
+}
+
+static void unmuteStdout(int saved) {
+  fflush(stdout);
+  cout.flush();
+  dup2(saved, 1);
+  close(saved);
+}
+
+static string groupsStr(vector<int>& sizes, vector<int>& base, vector<int>& insts) {
+  string toret;
+  for (int i=0; i<sizes.size(); i++) {
+    if (i > 0) toret += ";";
+    toret += to_string(sizes[i]) + ":" + to_string(base[i]) + "x" + to_string(insts[i]);
+  }
+  return toret;
+}
+
+string ETCandidate::param() {
+  return "dg=" + groupsStr(_dataSizes, _dataBase, _dataInst) + ",pg=" + groupsStr(_paritySizes, _parityBase, _parityInst);
+}
+
+bool ETCandidate::better(ETCandidate& other) {
+  if (_avgRead < 0) return false;
+  if (other._avgRead < 0) return true;
+  if (_avgRead < other._avgRead - 1e-9) return true;
+  if (_avgRead > other._avgRead + 1e-9) return false;
+  return _avgRuns < other._avgRuns - 1e-9;
+}
+
+ETSearch::ETSearch(int n, int k, int w) {
+  _n = n;
+  _k = k;
+  _w = w;
+}
+
+vector<int> ETSearch::divisors(int value) {
+  vector<int> toret;
+  for (int i=1; i<=value; i++) {
+    if (value % i == 0) toret.push_back(i);
+  }
+  return toret;
+}
+
+void ETSearch::regroup(int num, int inst, vector<int>& sizes, vector<int>& base, vector<int>& insts, bool parity) {
+  sizes.clear();
+  base.clear();
+  insts.clear();
+  int groups = num / inst;
+  int b = 1;
+  for (int i=0; i<groups; i++) {
+    sizes.push_back(i < groups - 1 ? inst : num - inst * i);
+    insts.push_back(inst);
+    if (parity) {
+      // parity groups end at the target sub-packetization
+      base.push_back(_w / inst);
+    } else {
+      // data groups raise the base sub-packetization group by group
+      if (i > 0 && _w % (b * inst * inst) == 0) b *= inst;
+      else if (i > 0) b = _w / inst;
+      base.push_back(b);
+    }
+  }
+}
+
+void ETSearch::evaluate(ETCandidate& cand) {
+  _evaluated++;
+  vector<string> param = {to_string(_w)};
+  string spec = cand.param();
+  param.push_back(spec.substr(0, spec.find(",")));
+  param.push_back(spec.substr(spec.find(",") + 1));
+
+  // 1. build and validate the construction
+  int saved = muteStdout();
+  ETRSConv* ec = NULL;
+  try {
+    ec = new ETRSConv(_n, _k, _w, -1, param);
+  } catch (invalid_argument& e) {
+    cand._reason = e.what();
+  }
+  if (ec != NULL && ec->GetConstruction() != spec) {
+    cand._reason = "error: the code builds " + ec->GetConstruction() + ".";
+  }
+  if (ec != NULL && cand._reason.empty()) cand._reason = ec->Validate();
+
+  // 2. average the single-node repairs
+  double nread = 0;
+  double runs = 0;
+  for (int f=0; cand._reason.empty() && f<_n; f++) {
+    vector<int> from, to;
+    for (int i=0; i<_n; i++) {
+      for (int j=0; j<_w; j++) {
+        if (i == f) to.push_back(i*_w+j);
+        else from.push_back(i*_w+j);
+      }
+    }
+    ECDAG* ecdag = ec->Decode(from, to);
+    // symbol i*w+j is sub-packet j of node i, beyond n*w symbols are virtual
+    map<int, vector<int>> offsets;
+    for (auto cidx: ecdag->getLeaves()) {
+      if (cidx >= _n*_w) continue;
+      offsets[cidx/_w].push_back(cidx%_w);
+      nread++;
+    }
+    for (auto item: offsets) {
+      vector<int>& off = item.second;
+      sort(off.begin(), off.end());
+      for (int i=0; i<off.size(); i++) {
+        if (i == 0 || off[i] != off[i-1] + 1) runs++;
+      }
+    }
+    delete ecdag;
+  }
+  if (ec != NULL) delete ec;
+  unmuteStdout(saved);
+
+  if (cand._reason.empty()) {
+    cand._avgRead = nread / _n;
+    cand._avgRuns = runs / _n;
+  } else {
+    cand._avgRead = -1;
+    cand._avgRuns = -1;
+    _rejected.push_back(make_pair(spec, cand._reason));
+  }
+}
+
+ETCandidate ETSearch::defaultConstruction() {
+  int saved = muteStdout();
+  ETRSConv* ec = new ETRSConv(_n, _k, _w, -1, {to_string(_w)});
+  string spec = ec->GetConstruction();
+  delete ec;
+  unmuteStdout(saved);
+
+  // dg=...,pg=..., the groups of each side follow the "="
+  string dataspec = spec.substr(0, spec.find(","));
+  string parityspec = spec.substr(spec.find(",") + 1);
+  ETCandidate toret;
+  ETRSConv::ParseGroups(dataspec.substr(dataspec.find("=") + 1), _k, _w, toret._dataSizes, toret._dataBase, toret._dataInst);
+  ETRSConv::ParseGroups(parityspec.substr(parityspec.find("=") + 1), _n - _k, _w, toret._paritySizes, toret._parityBase, toret._parityInst);
+  evaluate(toret);
+  return toret;
+}
+
+ETCandidate ETSearch::search() {
+  int m = _n - _k;
+  ETCandidate best = defaultConstruction();
+  vector<int> wdiv = divisors(_w);
+
+  for (int round=0; round<ETSEARCH_MAX_ROUNDS; round++) {
+    bool improved = false;
+
+    // 1. group sizes of each side
+    for (auto inst: wdiv) {
+      if (inst < 2 || inst > m) continue;
+      if (inst <= _k) {
+        ETCandidate cand = best;
+        regroup(_k, inst, cand._dataSizes, cand._dataBase, cand._dataInst, false);
+        if (cand.param() != best.param()) {
+          evaluate(cand);
+          if (cand.better(best)) { best = cand; improved = true; }
+        }
+      }
+      ETCandidate cand = best;
+      regroup(m, inst, cand._paritySizes, cand._parityBase, cand._parityInst, true);
+      if (cand.param() != best.param()) {
+        evaluate(cand);
+        if (cand.better(best)) { best = cand; improved = true; }
+      }
+    }
+
+    // 2. base sub-packetization of each group
+    for (int i=0; i<best._dataSizes.size(); i++) {
+      for (auto b: divisors(_w / best._dataInst[i])) {
+        if (b == best._dataBase[i]) continue;
+        ETCandidate cand = best;
+        cand._dataBase[i] = b;
+        evaluate(cand);
+        if (cand.better(best)) { best = cand; improved = true; }
+      }
+    }
+    for (int i=0; i<best._paritySizes.size(); i++) {
+      for (auto b: divisors(_w / best._parityInst[i])) {
+        if (b == best._parityBase[i]) continue;
+        ETCandidate cand = best;
+        cand._parityBase[i] = b;
+        evaluate(cand);
+        if (cand.better(best)) { best = cand; improved = true; }
+      }
+    }
+
+    if (!improved) break;
+  }
+  return best;
+}
+
+int ETSearch::getEvaluated() {
+  return _evaluated;
+}
+
+vector<pair<string, string>> ETSearch::getRejected() {
+  return _rejected;
+}
@@ -0,0 +1,56 @@
+#ifndef _ETSEARCH_HH_
+#define _ETSEARCH_HH_
+
+#include "../ec/ETRSConv.hh"
+#include "../inc/include.hh"
+
+using namespace std;
+
+// rounds of coordinate descent over the groups of a construction
+#define ETSEARCH_MAX_ROUNDS 8
+
+/**
+ * Repair cost of an ET construction, averaged over single-node repairs, in
+ * sub-packets read and discontiguous runs read from disk.
+ */
+class ETCandidate {
+  public:
+    vector<int> _dataSizes, _dataBase, _dataInst;
+    vector<int> _paritySizes, _parityBase, _parityInst;
+    double _avgRead = -1;  // -1 if not evaluated or not a valid construction
+    double _avgRuns = -1;
+    string _reason;        // why the construction is rejected, empty if valid
+
+    // param string of ETRSConv for this construction, without w
+    string param();
+    bool better(ETCandidate& other);
+};
+
+/**
+ * Offline search of an ETRSConv(n,k,w) construction with the least average
+ * single-node repair bandwidth, then the least discontiguous reads. It
+ * starts from the default construction and, group by group, tries every
+ * base sub-packetization, and for each side every group size, keeping the
+ * changes that lower the repair cost.
+ */
+class ETSearch {
+  private:
+    int _n, _k, _w;
+    int _evaluated = 0;
+    vector<pair<string, string>> _rejected;  // param -> reason
+
+    void evaluate(ETCandidate& cand);
+    vector<int> divisors(int value);
+    // groups of inst nodes over num nodes, the last takes the remaining ones
+    void regroup(int num, int inst, vector<int>& sizes, vector<int>& base, vector<int>& insts, bool parity);
+
+  public:
+    ETSearch(int n, int k, int w);
+
+    ETCandidate defaultConstruction();
+    ETCandidate search();
+    int getEvaluated();
+    vector<pair<string, string>> getRejected();
+};
+
+#endif
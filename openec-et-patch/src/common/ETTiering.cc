@@ -0,0 +1,161 @@
+#include "ETTiering.hh"
+
+#include "PlanAnalyzer.hh"
+
+ETTiering::ETTiering(Config* conf, StripeStore* ss) {
+  _conf = conf;
+  _stripeStore = ss;
+}
+
+ETTiering::~ETTiering() {
+  for (auto item: _convs) delete item.second;
+}
+
+void ETTiering::recordRead(string objname) {
+  lock_guard<mutex> lk(_heatLock);
+  _heat[objname]._reads++;
+}
+
+void ETTiering::recordDegraded(string objname) {
+  lock_guard<mutex> lk(_heatLock);
+  _heat[objname]._degraded++;
+}
+
+void ETTiering::recordRepair(string objname) {
+  lock_guard<mutex> lk(_heatLock);
+  _heat[objname]._repairs++;
+}
+
+vector<ECPolicy*> ETTiering::family(ECPolicy* ecpolicy) {
+  vector<ECPolicy*> toret;
+  for (auto item: _conf->_ecPolicyMap) {
+    ECPolicy* cur = item.second;
+    if (cur->getClassName() == ecpolicy->getClassName() && cur->getN() == ecpolicy->getN() && cur->getK() == ecpolicy->getK()) {
+      toret.push_back(cur);
+    }
+  }
+  sort(toret.begin(), toret.end(), [](ECPolicy* a, ECPolicy* b) { return a->getW() < b->getW(); });
+  return toret;
+}
+
+ECPolicy* ETTiering::choose(ECPolicy* cur, double reads, double repairs, int sizeMB) {
+  vector<ECPolicy*> tiers = family(cur);
+  int last = tiers.size() - 1;
+  int tier;
+  if (reads >= _conf->_tieringHotReads || sizeMB <= _conf->_tieringSmallMB) tier = 0;
+  else if (reads <= _conf->_tieringColdReads) tier = last;
+  else tier = last / 2;
+  if (repairs >= _conf->_tieringRepairs) tier = min(tier + 1, last);
+  return tiers[tier];
+}
+
+vector<TierMove> ETTiering::plan() {
+  // 1. counts of this round, then halve them for the next one
+  _heatLock.lock();
+  unordered_map<string, ObjHeat> heat = _heat;
+  for (auto it = _heat.begin(); it != _heat.end();) {
+    ObjHeat& cur = it->second;
+    cur._reads /= 2;
+    cur._degraded /= 2;
+    cur._repairs /= 2;
+    if (cur._reads + cur._degraded + cur._repairs < 0.01) it = _heat.erase(it);
+    else it++;
+  }
+  _heatLock.unlock();
+
+  // 2. tier of each encoded stripe of the offline pools
+  vector<TierMove> toret;
+  for (auto item: _conf->_offlineECMap) {
+    string ecpoolid = item.first;
+    OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid, _conf->_ecPolicyMap[item.second], _conf->_offlineECBase[ecpoolid]);
+    for (auto stripename: _stripeStore->getEncodedStripes(ecpoolid)) {
+      ecpool->lock();
+      ECPolicy* cur = _stripeStore->getStripePolicy(ecpool, stripename);
+      vector<string> stripeobjs = _stripeStore->getStripeObjs(ecpool, stripename);
+      ecpool->unlock();
+
+      // a stripe in conversion keeps its tier until it switches
+      _lock.lock();
+      auto pit = _pending.find(stripename);
+      bool pending = pit != _pending.end() && pit->second != cur->getPolicyId();
+      if (pit != _pending.end() && !pending) _pending.erase(pit);
+      _lock.unlock();
+      if (pending) continue;
+
+      double reads = 0, repairs = 0;
+      int sizeMB = 0;
+      for (int i=0; i<stripeobjs.size(); i++) {
+        auto hit = heat.find(stripeobjs[i]);
+        if (hit != heat.end()) {
+          if (i < cur->getK()) reads += hit->second._reads + hit->second._degraded;
+          repairs += hit->second._repairs + hit->second._degraded;
+        }
+        // objs of a file are as large as the file
+        if (i < cur->getK()) sizeMB = max(sizeMB, _stripeStore->getEntryFromObj(stripeobjs[i])->getFilesizeMB());
+      }
+
+      ECPolicy* to = choose(cur, reads, repairs, sizeMB);
+      if (to == cur) continue;
+      TierMove move;
+      move._ecpoolid = ecpoolid;
+      move._stripename = stripename;
+      move._from = cur;
+      move._to = to;
+      move._reads = reads;
+      move._repairs = repairs;
+      toret.push_back(move);
+    }
+  }
+
+  // 3. hot stripes first, as reads suffer most from a large w
+  stable_sort(toret.begin(), toret.end(), [](const TierMove& a, const TierMove& b) {
+    return a._reads + a._repairs > b._reads + b._repairs;
+  });
+  return toret;
+}
+
+void ETTiering::setPending(string stripename, string ecid) {
+  lock_guard<mutex> lk(_lock);
+  _pending[stripename] = ecid;
+}
+
+ETConvert* ETTiering::getConvert(ECPolicy* from, ECPolicy* to) {
+  string key = from->getPolicyId() + ":" + to->getPolicyId();
+  lock_guard<mutex> lk(_lock);
+  if (_convs.find(key) == _convs.end()) _convs.insert(make_pair(key, new ETConvert(from, to, _conf->_pktSize)));
+  return _convs[key];
+}
+
+double ETTiering::getRepairMB(ECPolicy* ecpolicy, int sizeMB) {
+  string key = ecpolicy->getPolicyId() + ":" + to_string(sizeMB);
+  _lock.lock();
+  if (_repairMB.find(key) != _repairMB.end()) {
+    double toret = _repairMB[key];
+    _lock.unlock();
+    return toret;
+  }
+  _lock.unlock();
+
+  PlanAnalyzer* analyzer = new PlanAnalyzer(_conf, ecpolicy, sizeMB, _stripeStore);
+  double total = 0;
+  for (int i=0; i<ecpolicy->getN(); i++) {
+    total += (double)analyzer->repair({i}).totalRead() / 1048576;
+  }
+  delete analyzer;
+  double toret = total / ecpolicy->getN();
+
+  _lock.lock();
+  _repairMB[key] = toret;
+  _lock.unlock();
+  return toret;
+}
+
+void ETTiering::setReport(string report) {
+  lock_guard<mutex> lk(_lock);
+  _report = report;
+}
+
+string ETTiering::getReport() {
+  lock_guard<mutex> lk(_lock);
+  return _report;
+}
@@ -0,0 +1,85 @@
+#ifndef _ETTIERING_HH_
+#define _ETTIERING_HH_
+
+#include "Config.hh"
+#include "ETConvert.hh"
+#include "StripeStore.hh"
+
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+
+using namespace std;
+
+// accesses of an obj, halved every tiering period
+class ObjHeat {
+  public:
+    double _reads = 0;
+    double _degraded = 0;
+    double _repairs = 0;
+};
+
+// an encoded stripe that moves to another tier
+class TierMove {
+  public:
+    string _ecpoolid;
+    string _stripename;
+    ECPolicy* _from;
+    ECPolicy* _to;
+    double _reads;  // reads and degraded reads of the data objs
+    double _repairs;  // repairs and degraded reads of all objs
+};
+
+/**
+ * Sub-packetization tiering of encoded stripes. ET codes of the same class
+ * and (n,k) trade repair bandwidth against the number of sub-packets an
+ * obj is read in, so a stripe moves among the policies configured for them
+ * by its temperature:
+ *
+ * 1. hot stripes, or stripes of small files, take the smallest w;
+ * 2. cold stripes take the largest w;
+ * 3. the others take the median w;
+ * 4. stripes that are often repaired move one tier up in w.
+ *
+ * The accesses recorded in a period are added to counts that halve every
+ * period, and the thresholds of oec.tiering.* apply to these counts. A
+ * stripe is converted by ETConvert and is not moved again until it
+ * switches to its new policy.
+ */
+class ETTiering {
+  private:
+    Config* _conf;
+    StripeStore* _stripeStore;
+
+    mutex _heatLock;
+    unordered_map<string, ObjHeat> _heat;
+
+    mutex _lock;
+    unordered_map<string, string> _pending;  // stripename -> ecid it converts to
+    unordered_map<string, ETConvert*> _convs;  // from:to -> conversion plan
+    unordered_map<string, double> _repairMB;  // ecid:sizeMB -> avg read of a single-node repair
+    string _report = "no tiering round yet\n";
+
+    // policies of the class and (n,k) of ecpolicy, by w
+    vector<ECPolicy*> family(ECPolicy* ecpolicy);
+    ECPolicy* choose(ECPolicy* cur, double reads, double repairs, int sizeMB);
+
+  public:
+    ETTiering(Config* conf, StripeStore* ss);
+    ~ETTiering();
+
+    void recordRead(string objname);
+    void recordDegraded(string objname);
+    void recordRepair(string objname);
+
+    // encoded stripes whose tier changes, hottest first, then the counts halve
+    vector<TierMove> plan();
+    void setPending(string stripename, string ecid);
+
+    ETConvert* getConvert(ECPolicy* from, ECPolicy* to);
+    double getRepairMB(ECPolicy* ecpolicy, int sizeMB);
+
+    void setReport(string report);
+    string getReport();
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "ETUpdate.hh"
+
+#include "ETConvert.hh"
+
+ETUpdate::ETUpdate(ECPolicy* ecpolicy, int dataidx) {
+  _ecpolicy = ecpolicy;
+  _dataIdx = dataidx;
+  _n = ecpolicy->getN();
+  _k = ecpolicy->getK();
+  _w = ecpolicy->getW();
+
+  if (dataidx < 0 || dataidx >= _k) {
+    cout << "ETUpdate::ETUpdate " << dataidx << " is not a data obj of " << ecpolicy->getPolicyId() << endl;
+    return;
+  }
+  unordered_map<int, vector<int>> parity;
+  if (!ETConvert::evaluate(ecpolicy, _w, parity)) return;
+  _valid = true;
+
+  // the coefs of each parity sub-packet over the sub-packets of the updated obj
+  for (int p=_k; p<_n; p++) {
+    set<int> shipped;
+    for (int j=0; j<_w; j++) {
+      vector<int>& coefs = parity[p*_w + j];
+      vector<pair<int, int>> terms;
+      for (int c=0; c<_w; c++) {
+        int coef = coefs[dataidx*_w + c];
+        if (!coef) continue;
+        terms.push_back(make_pair(c, coef));
+        shipped.insert(c);
+        _deltas.insert(c);
+      }
+      _deltaTerms.insert(make_pair(p*_w + j, terms));
+    }
+    _shippedSymbols += shipped.size();
+  }
+  cout << "ETUpdate::ETUpdate " << ecpolicy->getPolicyId() << " obj " << dataidx
+       << " ships " << _shippedSymbols << " delta sub-packets, re-encode reads " << _k*_w << endl;
+}
+
+bool ETUpdate::valid() {
+  return _valid;
+}
+
+int ETUpdate::getStagedIdx() {
+  return 2*_n;
+}
+
+int ETUpdate::getDeltaIdx() {
+  return 2*_n+1;
+}
+
+int ETUpdate::getParityBase() {
+  return _n;
+}
+
+double ETUpdate::getDeltaObjs() {
+  return (double)_shippedSymbols / _w;
+}
+
+int ETUpdate::getReencodeObjs() {
+  return _k;
+}
+
+ECDAG* ETUpdate::plan() {
+  if (!_valid) return NULL;
+  ECDAG* ecdag = new ECDAG();
+  int staged = getStagedIdx();
+  int delta = getDeltaIdx();
+
+  // 1. delta of the updated obj, next to its old and new data
+  for (auto c: _deltas) {
+    ecdag->Join(delta*_w + c, {_dataIdx*_w + c, staged*_w + c}, {1, 1});
+  }
+
+  // 2. new parity from the old parity and the delta
+  for (int p=_k; p<_n; p++) {
+    for (int j=0; j<_w; j++) {
+      vector<int> children = {p*_w + j};
+      vector<int> coefs = {1};
+      for (auto item: _deltaTerms[p*_w + j]) {
+        children.push_back(delta*_w + item.first);
+        coefs.push_back(item.second);
+      }
+      ecdag->Join((_n+p)*_w + j, children, coefs);
+    }
+  }
+  return ecdag;
+}
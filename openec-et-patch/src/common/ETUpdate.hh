@@ -0,0 +1,57 @@
+#ifndef _ETUPDATE_HH_
+#define _ETUPDATE_HH_
+
+#include "../ec/ECDAG.hh"
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+
+using namespace std;
+
+/**
+ * Plan of updating the parity of an encoded stripe by delta when one data
+ * obj is overwritten. Each parity sub-packet is evaluated from the encode
+ * ecdag as a combination of data sub-packets, as ETConvert does, so the
+ * decouple, base encode and couple steps of ET codes fold into fixed
+ * coefficients of the updated obj. Only the delta (new + old) of the
+ * sub-packets a parity node depends on is shipped to it, and the parity
+ * node adds it to its old parity.
+ *
+ * Symbols of the update ecdag are node*w+j for data and old parity
+ * sub-packets, 2n*w+c for the new data staged next to the old one,
+ * (2n+1)*w+c for the delta computed there, and (n+node)*w+j for new parity
+ * sub-packets, so the new parity of node is persisted as stripe idx
+ * n+node. Parity sub-packets the obj does not contribute to are copied, as
+ * every parity obj is persisted whole. The new parity goes to a new version
+ * of each parity obj, and the obj is overwritten from the staged copy only
+ * after the stripe switches to it.
+ */
+class ETUpdate {
+  private:
+    ECPolicy* _ecpolicy;
+    int _n, _k, _w;
+    int _dataIdx;
+    bool _valid = false;
+
+    // parity sub-packet (node*w+j) -> (sub-packets of the updated obj, coefs)
+    unordered_map<int, vector<pair<int, int>>> _deltaTerms;
+    set<int> _deltas;  // sub-packets of the updated obj whose delta is computed
+    int _shippedSymbols = 0;  // delta sub-packets sent to parity nodes
+
+  public:
+    ETUpdate(ECPolicy* ecpolicy, int dataidx);
+
+    // dataidx is a data obj and the encode ecdag is linear over data
+    bool valid();
+    // stripe idx of the staged new data and of the delta
+    int getStagedIdx();
+    int getDeltaIdx();
+    // offset of the stripe idx of new parity objs
+    int getParityBase();
+    // objs of delta shipped to parity nodes, and objs read by a re-encode
+    double getDeltaObjs();
+    int getReencodeObjs();
+
+    ECDAG* plan();
+};
+
+#endif
@@ -7,6 +7,7 @@ FSObjInputStream::FSObjInputStream(Config* conf, string objname, UnderFS* fs) {
   _objname = objname;
   _queue = new BlockingQueue<OECDataPacket*>();
   _dataPktNum = 0;
+  _priority = AG_PRIO_FOREGROUND;
 
   _underfs = fs;
   _underfile = _underfs->openFile(objname, "read");
@@ -45,6 +46,8 @@ void FSObjInputStream::readObj(int slicesize) {
       hasread += len;
     }
 
+    Throttle::consume(_priority, THROTTLE_DISK, hasread);
+
     // set hasread in the first 4 bytes of buf
     int tmplen = htonl(hasread);
     memcpy(buf, (char*)&tmplen, 4);
@@ -84,6 +87,8 @@ void FSObjInputStream::readObj() {
       hasread += len;
     }
 
+    Throttle::consume(_priority, THROTTLE_DISK, hasread);
+
     // set hasread in the first 4 bytes of buf
     int tmplen = htonl(hasread);
     memcpy(buf, (char*)&tmplen, 4);
@@ -139,7 +144,9 @@ void FSObjInputStream::readObj(int w, vector<int> list, int slicesize) {
         hasread += len;
       }
 
-      // set hasread in the first 4 bytes of buf
+      Throttle::consume(_priority, THROTTLE_DISK, hasread);
+
+    // set hasread in the first 4 bytes of buf
       int tmplen = htonl(hasread);
       memcpy(buf, (char*)&tmplen, 4);
 
@@ -162,10 +169,13 @@ void FSObjInputStream::readObj(int w, vector<int> list, int slicesize) {
   cout << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", totally " << slicenum << "slices" << endl;
 }
 
-void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize) {
-  if (w == 1) {
+void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize, int startpkt, int pktnum) {
+  if (w == 1 && pktnum < 0) {
     readObj();
     return;
+  } else if (w == 1) {
+    readObjRange(startpkt, pktnum);
+    return;
   }
 
   struct timeval time1, time2;
@@ -211,9 +221,10 @@ void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize)
   }
 
   // for each w slices, we put those slice whose index is in offsetlist
-  int stripeid=0;
+  int stripeid=startpkt;
   int pktsize = _conf->_pktSize;
   int stripenum = _objbytes / pktsize;
+  if (pktnum >= 0) stripenum = min(stripenum, startpkt + pktnum);
   cout << "FSObjInputStream::readObj.stripenum:  " << stripenum << endl;
   int slicenum = 0;
   // for each stripe, read packets consecutively for each cons_list
@@ -230,7 +241,7 @@ void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize)
       int bytes_read = 0;
       while (bytes_read < read_size) {
         int len = 0;
-        if (num_cons_read_packets == w) {
+        if (num_cons_read_packets == w && startpkt == 0) {
           // if read the whole packet, resort to sequential instead
           len = _underfs->readFile(_underfile, read_cons_buf + bytes_read, read_size - bytes_read);
         } else {
@@ -242,6 +253,8 @@ void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize)
         bytes_read += len;
       }
 
+      Throttle::consume(_priority, THROTTLE_DISK, bytes_read);
+
       if (bytes_read % num_cons_read_packets != 0) {
         printf("error: undevisible sub-packets read, bytes_read: %d, num_cons_read_packets: %d\n", bytes_read, num_cons_read_packets);
       }
@@ -281,6 +294,42 @@ void FSObjInputStream::readObjOptimized(int w, vector<int> list, int slicesize)
   cout << "FSObjInputStream.readObjOptimized.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", totally " << slicenum << "slices" << endl;
 }
 
+void FSObjInputStream::readObjRange(int startpkt, int pktnum) {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  for (int pktid=startpkt; pktid<startpkt+pktnum; pktid++) {
+    long objoffset = (long)pktid * _conf->_pktSize;
+    char* buf = (char*)calloc(_conf->_pktSize+4, sizeof(char));
+    if (!buf) {
+      cout << "FSObjInputStream::readObjRange.malloc buffer fail" << endl;
+      return;
+    }
+    int hasread = 0;
+    while(hasread < _conf->_pktSize) {
+      int len = _underfs->pReadFile(_underfile, objoffset + hasread, buf+4 + hasread, _conf->_pktSize - hasread);
+      if (len == 0) break;
+      hasread += len;
+    }
+
+    Throttle::consume(_priority, THROTTLE_DISK, hasread);
+
+    // set hasread in the first 4 bytes of buf
+    int tmplen = htonl(hasread);
+    memcpy(buf, (char*)&tmplen, 4);
+
+    if (hasread) {
+      OECDataPacket* curPkt = new OECDataPacket();
+      curPkt->setRaw(buf);
+      _queue->push(curPkt); _dataPktNum++;
+    } else {
+      free(buf);
+      break;
+    }
+  }
+  gettimeofday(&time2, NULL);
+  cout << "FSObjInputStream.readObjRange.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", packets " << startpkt << "+" << _dataPktNum << endl;
+}
+
 void FSObjInputStream::readObj(int slicesize, int unitIdx) {
 
   if (slicesize == _conf->_pktSize) {
@@ -307,6 +356,8 @@ void FSObjInputStream::readObj(int slicesize, int unitIdx) {
       hasread += len;
     }
 
+    Throttle::consume(_priority, THROTTLE_DISK, hasread);
+
     // set hasread in the first 4 bytes of buf
     int tmplen = htonl(hasread);
     memcpy(buf, (char*)&tmplen, 4);
@@ -352,9 +403,14 @@ int FSObjInputStream::pread(long objoffset, char* buffer, int buflen) {
     int len = _underfs->pReadFile(_underfile, objoffset + hasread, buffer+hasread, buflen - hasread);
     hasread += len;
   }
+  Throttle::consume(_priority, THROTTLE_DISK, hasread);
   return hasread;
 }
 
 BlockingQueue<OECDataPacket*>* FSObjInputStream::getQueue() {
   return _queue;
 }
+
+void FSObjInputStream::setPriority(int priority) {
+  _priority = priority;
+}
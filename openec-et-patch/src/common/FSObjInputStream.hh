@@ -4,6 +4,7 @@
 #include <iomanip>
 #include "BlockingQueue.hh"
 #include "OECDataPacket.hh"
+#include "Throttle.hh"
 
 #include "../fs/UnderFS.hh"
 
@@ -22,6 +23,8 @@ class FSObjInputStream {
     UnderFS* _underfs;
     UnderFile* _underfile;
 
+    int _priority; // class charged for disk reads
+
   public:
     FSObjInputStream(Config* conf, string objname, UnderFS* fs);
     ~FSObjInputStream();
@@ -29,12 +32,16 @@ class FSObjInputStream {
     void readObj(int slicesize, int unitIdx);
     void readObj(int slicesize);
     void readObj(int w, vector<int> list, int slicesize);
-    void readObjOptimized(int w, vector<int> list, int slicesize); // optimized for reading consecutive sub-packets
+    // optimized for reading consecutive sub-packets, of pktnum packets from startpkt if pktnum >= 0
+    void readObjOptimized(int w, vector<int> list, int slicesize, int startpkt = 0, int pktnum = -1);
+    // packets [startpkt, startpkt+pktnum) of the obj
+    void readObjRange(int startpkt, int pktnum);
     OECDataPacket* dequeue();
     bool exist();
     bool hasNext();
     int pread(long objoffset, char* buffer, int buflen);
     BlockingQueue<OECDataPacket*>* getQueue();
+    void setPriority(int priority);
 };
 
 #endif
@@ -0,0 +1,262 @@
+#include "MetaLog.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MetaLog::MetaLog(string walPath, string snapPath) {
+  _walPath = walPath;
+  _snapPath = snapPath;
+}
+
+unsigned int MetaLog::checksum(const char* data, int len) {
+  // fnv-1a
+  unsigned int toret = 2166136261u;
+  for (int i=0; i<len; i++) {
+    toret ^= (unsigned char)data[i];
+    toret *= 16777619u;
+  }
+  return toret;
+}
+
+void MetaLog::frame(string& buf, int type, string payload) {
+  char head[9];
+  head[0] = (char)type;
+  int len = htonl(payload.length());
+  unsigned int sum = htonl(checksum(payload.c_str(), payload.length()));
+  memcpy(head+1, (char*)&len, 4);
+  memcpy(head+5, (char*)&sum, 4);
+  buf.append(head, 9);
+  buf.append(payload);
+}
+
+vector<pair<int, string>> MetaLog::split(int type, string payload) {
+  // objname;stagedname;stripe record
+  int pos = payload.find(';');
+  int pos2 = pos == -1 ? -1 : payload.find(';', pos+1);
+  if (type != METALOG_UPDATE || pos2 == -1 || pos2 + 1 == payload.length()) return {make_pair(type, payload)};
+  return {make_pair(METALOG_POOL, payload.substr(pos2+1)), make_pair(type, payload.substr(0, pos2+1))};
+}
+
+string MetaLog::recordKey(int type, string& payload) {
+  if (type == METALOG_POOL) {
+    // ecpoolid;stripename;...
+    int pos = payload.find(';');
+    pos = payload.find(';', pos+1);
+    return "pool;" + payload.substr(0, pos);
+  } else if (type == METALOG_UPDATE) {
+    // objname;...
+    return "update;" + payload.substr(0, payload.find(';'));
+  }
+  return "";
+}
+
+long MetaLog::replayFile(string path, function<void(int, string)> apply, bool truncate) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return 0;
+  struct stat st;
+  fstat(fd, &st);
+  long size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    return 0;
+  }
+  char* data = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    cerr << "MetaLog::replayFile fail to map " << path << endl;
+    return 0;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  long offset = 0;
+  long records = 0;
+  while (offset + 9 <= size) {
+    int type = data[offset];
+    int len;
+    unsigned int sum;
+    memcpy((char*)&len, data+offset+1, 4);
+    memcpy((char*)&sum, data+offset+5, 4);
+    len = ntohl(len);
+    sum = ntohl(sum);
+    if (len < 0 || offset + 9 + len > size) break;
+    if (checksum(data+offset+9, len) != sum) break;
+    apply(type, string(data+offset+9, len));
+    offset += 9 + len;
+    records++;
+  }
+  munmap(data, size);
+
+  if (offset < size) {
+    cout << "MetaLog::replayFile " << path << " has " << size - offset << " bytes of torn records" << endl;
+    if (truncate) ::truncate(path.c_str(), offset);
+  }
+  return records;
+}
+
+long MetaLog::load(function<void(int, string)> apply) {
+  string oldPath = _walPath + ".old";
+
+  // 1. the position of the last record of each key, torn tails are cut off
+  unordered_map<string, long> lastOf;
+  long seq = 0;
+  auto locate = [&](int type, string payload) {
+    for (auto item: split(type, payload)) {
+      string key = recordKey(item.first, item.second);
+      if (!key.empty()) lastOf[key] = seq;
+      seq++;
+    }
+  };
+  long toret = replayFile(_snapPath, locate, false);
+  // a wal rotated before the last compaction finished
+  long oldRecords = replayFile(oldPath, locate, true);
+  _walRecords = replayFile(_walPath, locate, true);
+  toret += oldRecords + _walRecords;
+
+  // 2. apply the records in log order, superseded ones are skipped
+  seq = 0;
+  auto replay = [&](int type, string payload) {
+    for (auto item: split(type, payload)) {
+      string key = recordKey(item.first, item.second);
+      if (key.empty() || lastOf[key] == seq) apply(item.first, item.second);
+      seq++;
+    }
+  };
+  replayFile(_snapPath, replay, false);
+  replayFile(oldPath, replay, false);
+  replayFile(_walPath, replay, false);
+
+  _walFd = open(_walPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (access(oldPath.c_str(), F_OK) == 0) {
+    _compacting = true;
+    thread([=]{compact();}).detach();
+  }
+  thread([=]{flushLoop();}).detach();
+  return toret;
+}
+
+bool MetaLog::append(int type, string payload) {
+  unique_lock<mutex> lk(_lock);
+  if (_failed) return false;
+  frame(_buffer, type, payload);
+  long seq = ++_appendSeq;
+  _walRecords++;
+  _flushCv.notify_one();
+  _durableCv.wait(lk, [&]{ return _durableSeq >= seq || _failed; });
+  return _durableSeq >= seq;
+}
+
+void MetaLog::flushLoop() {
+  while (true) {
+    unique_lock<mutex> lk(_lock);
+    _flushCv.wait(lk, [&]{ return _buffer.size() > 0; });
+    // 1. take all the queued records, later appenders queue for the next sync
+    string towrite;
+    towrite.swap(_buffer);
+    long seq = _appendSeq;
+    int fd = _walFd;
+    lk.unlock();
+
+    // 2. one write and one sync for the whole group
+    off_t start = fd < 0 ? -1 : lseek(fd, 0, SEEK_END);
+    long offset = 0;
+    while (start >= 0 && offset < towrite.size()) {
+      long ret = write(fd, towrite.c_str() + offset, towrite.size() - offset);
+      if (ret < 0 && errno == EINTR) continue;
+      if (ret <= 0) break;
+      offset += ret;
+    }
+    bool synced = start >= 0 && offset == towrite.size() && fdatasync(fd) == 0;
+
+    // 3. after a failed write or sync the state of the wal on disk is unknown,
+    // cut off a partial group and fail this and every later append
+    if (!synced) {
+      cerr << "MetaLog::flushLoop fail to " << (offset == towrite.size() ? "sync " : "write ") << _walPath
+           << ": " << strerror(errno) << ", metadata is no longer logged" << endl;
+      if (start >= 0) ftruncate(fd, start);
+      lk.lock();
+      _failed = true;
+      _buffer.clear();
+      lk.unlock();
+      _durableCv.notify_all();
+      return;
+    }
+
+    // 4. rotate the wal for compaction, only this thread writes the wal
+    lk.lock();
+    _durableSeq = seq;
+    _syncs++;
+    if (_walRecords >= METALOG_SNAPSHOT_RECORDS && !_compacting) {
+      close(_walFd);
+      rename(_walPath.c_str(), (_walPath + ".old").c_str());
+      _walFd = open(_walPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+      _walRecords = 0;
+      _compacting = true;
+      thread([=]{compact();}).detach();
+    }
+    lk.unlock();
+    _durableCv.notify_all();
+  }
+}
+
+void MetaLog::compact() {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  string oldPath = _walPath + ".old";
+  string tmpPath = _snapPath + ".tmp";
+
+  // 1. collect records of the snapshot and the rotated wal, a superseded
+  // record is dropped and the others keep their order
+  vector<pair<int, string>> records;
+  unordered_map<string, int> key2record;
+  long kept = 0;
+  auto collect = [&](int type, string payload) {
+    for (auto item: split(type, payload)) {
+      string key = recordKey(item.first, item.second);
+      if (!key.empty()) {
+        if (key2record.find(key) != key2record.end()) {
+          records[key2record[key]].first = -1;
+          kept--;
+        }
+        key2record[key] = records.size();
+      }
+      records.push_back(item);
+      kept++;
+    }
+  };
+  long before = replayFile(_snapPath, collect, false) + replayFile(oldPath, collect, false);
+
+  // 2. write the new snapshot and replace the old one
+  string buf;
+  for (auto& item: records) {
+    if (item.first >= 0) frame(buf, item.first, item.second);
+  }
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  long offset = 0;
+  while (offset < buf.size()) {
+    long ret = write(fd, buf.c_str() + offset, buf.size() - offset);
+    if (ret < 0) break;
+    offset += ret;
+  }
+  fsync(fd);
+  close(fd);
+  if (offset != buf.size()) {
+    // keep the rotated wal, no more rotation until restart
+    cerr << "MetaLog::compact fail to write " << tmpPath << endl;
+    return;
+  }
+  rename(tmpPath.c_str(), _snapPath.c_str());
+  unlink(oldPath.c_str());
+
+  gettimeofday(&time2, NULL);
+  cout << "MetaLog::compact " << before << " records into " << kept
+       << " in " << RedisUtil::duration(time1, time2) << " ms" << endl;
+  _lock.lock();
+  _compacting = false;
+  _lock.unlock();
+}
+
+long MetaLog::getSyncs() {
+  lock_guard<mutex> lk(_lock);
+  return _syncs;
+}
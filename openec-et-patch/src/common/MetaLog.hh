@@ -0,0 +1,73 @@
+#ifndef _METALOG_HH_
+#define _METALOG_HH_
+
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+// record types
+#define METALOG_ENTRY 0   // SSEntry::toString
+#define METALOG_POOL 1    // StripeStore::stripeRecord
+#define METALOG_UPDATE 2  // objname;stagedname;stripe record, or objname;; once written
+
+// the wal is compacted into the snapshot after this many records
+#define METALOG_SNAPSHOT_RECORDS 1000000
+
+/**
+ * Write-ahead log of the stripestore metadata. A record is framed as
+ * | type (1B) | length (4B) | checksum (4B) | payload |. Appenders queue
+ * their records and wait; a single flusher writes everything queued with
+ * one write and one fdatasync, so concurrent appenders share a sync. A
+ * failed write or sync fails the group and every later append, as the wal
+ * on disk cannot be trusted until restart.
+ *
+ * A pool record of a stripe, or an update record of an obj, supersedes the
+ * earlier ones of the same stripe or obj; the stripe record an update
+ * commits counts as a pool record of its stripe. Replay applies only the
+ * last record of each, in log order. When the wal grows large it is rotated
+ * and compacted together with the previous snapshot in the background:
+ * superseded records are dropped and the others keep their order. Startup
+ * maps the snapshot and replays only the wal tail.
+ */
+class MetaLog {
+  private:
+    string _walPath;
+    string _snapPath;
+    int _walFd = -1;
+
+    mutex _lock;
+    condition_variable _flushCv;    // records are queued
+    condition_variable _durableCv;  // queued records are synced
+    string _buffer;
+    long _appendSeq = 0;
+    long _durableSeq = 0;
+    long _walRecords = 0;
+    long _syncs = 0;
+    bool _compacting = false;
+    bool _failed = false;  // a write or sync of the wal failed
+
+    static void frame(string& buf, int type, string payload);
+    // the records a record applies as, an update that commits a stripe
+    // record is split into the pool record and the update itself
+    static vector<pair<int, string>> split(int type, string payload);
+    // key of the records that supersede each other, empty for entries
+    static string recordKey(int type, string& payload);
+    static unsigned int checksum(const char* data, int len);
+    // replay the valid records of a file, a torn tail is cut off if truncate is set
+    static long replayFile(string path, function<void(int, string)> apply, bool truncate);
+
+    void flushLoop();
+    void compact();
+
+  public:
+    MetaLog(string walPath, string snapPath);
+
+    // replay snapshot and wal, then accept appends
+    long load(function<void(int, string)> apply);
+    // return once the record is durable, false if the wal fails to take it
+    bool append(int type, string payload);
+    long getSyncs();
+};
+
+#endif
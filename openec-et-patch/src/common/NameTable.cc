@@ -0,0 +1,72 @@
+#include "NameTable.hh"
+
+NameTable::NameTable() {
+  for (int i=0; i<NAMETABLE_SHARDS; i++) pthread_rwlock_init(&_shards[i].lock, NULL);
+}
+
+NameTable::~NameTable() {
+  for (int i=0; i<NAMETABLE_SHARDS; i++) pthread_rwlock_destroy(&_shards[i].lock);
+}
+
+unsigned int NameTable::intern(string name) {
+  int sidx = hash<string>()(name) % NAMETABLE_SHARDS;
+  Shard& shard = _shards[sidx];
+  unsigned int id;
+  pthread_rwlock_wrlock(&shard.lock);
+  unordered_map<string, unsigned int>::iterator it = shard.ids.find(name);
+  if (it != shard.ids.end()) id = it->second;
+  else {
+    id = shard.names.size() * NAMETABLE_SHARDS + sidx;
+    it = shard.ids.insert(make_pair(name, id)).first;
+    // keys of unordered_map are not moved on rehash
+    shard.names.push_back(&it->first);
+    shard.nameBytes += name.capacity() > 15 ? name.capacity() + 1 : 0;
+  }
+  pthread_rwlock_unlock(&shard.lock);
+  return id;
+}
+
+bool NameTable::lookup(string name, unsigned int& id) {
+  Shard& shard = _shards[hash<string>()(name) % NAMETABLE_SHARDS];
+  bool toret = false;
+  pthread_rwlock_rdlock(&shard.lock);
+  unordered_map<string, unsigned int>::iterator it = shard.ids.find(name);
+  if (it != shard.ids.end()) {
+    id = it->second;
+    toret = true;
+  }
+  pthread_rwlock_unlock(&shard.lock);
+  return toret;
+}
+
+string NameTable::name(unsigned int id) {
+  Shard& shard = _shards[id % NAMETABLE_SHARDS];
+  pthread_rwlock_rdlock(&shard.lock);
+  string toret = *shard.names[id / NAMETABLE_SHARDS];
+  pthread_rwlock_unlock(&shard.lock);
+  return toret;
+}
+
+long NameTable::size() {
+  long toret = 0;
+  for (int i=0; i<NAMETABLE_SHARDS; i++) {
+    pthread_rwlock_rdlock(&_shards[i].lock);
+    toret += _shards[i].names.size();
+    pthread_rwlock_unlock(&_shards[i].lock);
+  }
+  return toret;
+}
+
+long NameTable::memoryBytes() {
+  long toret = 0;
+  for (int i=0; i<NAMETABLE_SHARDS; i++) {
+    Shard& shard = _shards[i];
+    pthread_rwlock_rdlock(&shard.lock);
+    // hash node: next pointer, key, id and cached hash
+    long node = sizeof(void*) + sizeof(pair<const string, unsigned int>) + sizeof(size_t);
+    toret += shard.ids.size() * node + shard.ids.bucket_count() * sizeof(void*);
+    toret += shard.names.capacity() * sizeof(const string*) + shard.nameBytes;
+    pthread_rwlock_unlock(&shard.lock);
+  }
+  return toret;
+}
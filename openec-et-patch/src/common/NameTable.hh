@@ -0,0 +1,43 @@
+#ifndef _NAMETABLE_HH_
+#define _NAMETABLE_HH_
+
+#include "../inc/include.hh"
+
+#include <pthread.h>
+
+using namespace std;
+
+#define NAMETABLE_SHARDS 64
+
+/**
+ * Interned file, object and stripe names. Each name is stored once and
+ * identified by an integer id, which the metadata indexes use as their
+ * key. The low bits of an id are the shard of the name, so an index that
+ * is sharded the same way finds the shard without hashing the name again.
+ */
+class NameTable {
+  private:
+    struct Shard {
+      unordered_map<string, unsigned int> ids;
+      vector<const string*> names;  // local id -> key in ids
+      long nameBytes = 0;
+      pthread_rwlock_t lock;
+    };
+    Shard _shards[NAMETABLE_SHARDS];
+
+  public:
+    NameTable();
+    ~NameTable();
+
+    // id of name, a new id is assigned to an unknown name
+    unsigned int intern(string name);
+    // id of name without assigning, false if name is unknown
+    bool lookup(string name, unsigned int& id);
+    string name(unsigned int id);
+
+    long size();
+    // estimated heap bytes of the names and the table itself
+    long memoryBytes();
+};
+
+#endif
@@ -20,55 +20,192 @@ OECWorker::OECWorker(Config* conf) : _conf(conf) {
   delete tuneobjin;
 }
 
+OECWorker::OECWorker(Config* conf, UnderFS* underfs) : _conf(conf) {
+  // a runner shares the fs of the worker that starts it and has no process loop
+  try {
+    _processCtx = NULL;
+    _localCtx = RedisUtil::createContext(_conf -> _localIp);
+    _coorCtx = RedisUtil::createContext(_conf -> _coorIp);
+  } catch (int e) {
+    cerr << "initializing redis context error" << endl;
+  }
+  _underfs = underfs;
+  _ownFS = false;
+}
+
 OECWorker::~OECWorker() {
   redisFree(_localCtx);
-  redisFree(_processCtx);
+  if (_processCtx) redisFree(_processCtx);
   redisFree(_coorCtx);
-  delete _underfs;
+  if (_ownFS) delete _underfs;
+}
+
+mutex OECWorker::_laneLock;
+int OECWorker::_laneInflight[AG_PRIO_NUM] = {0};
+int OECWorker::_laneCredit[AG_PRIO_NUM] = {0};
+mutex OECWorker::_runnerLock;
+vector<OECWorker*> OECWorker::_idleRunners;
+mutex OECWorker::_linkBwLock;
+unordered_map<unsigned int, double> OECWorker::_linkBw;
+set<unsigned int> OECWorker::_linkBwDirty;
+
+vector<string> OECWorker::laneOrder() {
+  // ingress queue first, then lanes by descending credit. The wait queue of a
+  // lane is always served, its disk reads only below the limit of the lane
+  vector<string> keys;
+  keys.push_back("ag_request");
+  vector<int> lanes;
+  for (int i=0; i<AG_PRIO_NUM; i++) lanes.push_back(i);
+  _laneLock.lock();
+  sort(lanes.begin(), lanes.end(), [](int a, int b) {
+    if (_laneCredit[a] != _laneCredit[b]) return _laneCredit[a] > _laneCredit[b];
+    return a < b;
+  });
+  for (auto lane: lanes) {
+    keys.push_back(AGCommand::laneKey(lane, true));
+    if (_laneInflight[lane] < _conf->_agLaneLimit[lane]) keys.push_back(AGCommand::laneKey(lane));
+  }
+  _laneLock.unlock();
+  return keys;
+}
+
+bool OECWorker::waitsOnAgents(int type) {
+  // client requests wait on the commands the coordinator sends for them, and
+  // fetchCompute, persist, readFetchCompute and batches wait on what other
+  // agents produce. Disk reads and throttle commands only use local resources
+  return type == 0 || type == 1 || type == 3 || type == 5 || type == 7 || type == 15 || type == 16;
+}
+
+bool OECWorker::acquireLane(AGCommand* agCmd) {
+  int prio = agCmd->getPriority();
+  bool counted = !waitsOnAgents(agCmd->getType());
+  lock_guard<mutex> lk(_laneLock);
+  if (counted && _laneInflight[prio] >= _conf->_agLaneLimit[prio]) return false;
+  if (counted) _laneInflight[prio]++;
+  // smooth weighted round robin over the lanes that were eligible
+  int total = 0;
+  for (int i=0; i<AG_PRIO_NUM; i++) {
+    _laneCredit[i] += _conf->_agLaneWeight[i];
+    total += _conf->_agLaneWeight[i];
+  }
+  _laneCredit[prio] -= total;
+  return true;
+}
+
+void OECWorker::releaseLane(AGCommand* agCmd) {
+  if (waitsOnAgents(agCmd->getType())) return;
+  lock_guard<mutex> lk(_laneLock);
+  _laneInflight[agCmd->getPriority()]--;
+}
+
+void OECWorker::startRunner(AGCommand* agCmd) {
+  OECWorker* runner = NULL;
+  _runnerLock.lock();
+  if (_idleRunners.size()) {
+    runner = _idleRunners.back();
+    _idleRunners.pop_back();
+  }
+  _runnerLock.unlock();
+  if (runner == NULL) runner = new OECWorker(_conf, _underfs);
+
+  thread([=]{
+    runner->_curPrio = agCmd->getPriority();
+    runner->runCommand(agCmd);
+    runner->_curPrio = AG_PRIO_FOREGROUND;
+    runner->reportLinkBw();
+    delete agCmd;
+    _runnerLock.lock();
+    _idleRunners.push_back(runner);
+    _runnerLock.unlock();
+  }).detach();
 }
 
 void OECWorker::doProcess() {
   redisReply* rReply;
   while (true) {
-    cout << "OECWorker::doProcess" << endl;  
     // will never stop looping
-    rReply = (redisReply*)redisCommand(_processCtx, "blpop ag_request 0");
+    // 1. wait on the ingress queue and the lanes, re-evaluate limits every second
+    vector<string> keys = laneOrder();
+    vector<const char*> argv;
+    argv.push_back("blpop");
+    for (int i=0; i<keys.size(); i++) argv.push_back(keys[i].c_str());
+    argv.push_back("1");
+    rReply = (redisReply*)redisCommandArgv(_processCtx, argv.size(), argv.data(), NULL);
     if (rReply -> type == REDIS_REPLY_NIL) {
-      cerr << "OECWorker::doProcess() get feed back empty queue " << endl;
-      //freeReplyObject(rReply);
+      // timeout
     } else if (rReply -> type == REDIS_REPLY_ERROR) {
       cerr << "OECWorker::doProcess() get feed back ERROR happens " << endl;
     } else {
       struct timeval time1, time2;
       gettimeofday(&time1, NULL);
+      string key = rReply -> element[0] -> str;
       char* reqStr = rReply -> element[1] -> str;
-      AGCommand* agCmd = new AGCommand(reqStr);
+      int reqLen = rReply -> element[1] -> len;
+      AGCommand* agCmd = new AGCommand(reqStr, reqLen);
       int type = agCmd->getType();
-      cout << "OECWorker::doProcess() receive a request of type " << type << endl;
-      //agCmd->dump();
-      switch (type) {
-        case 0: clientWrite(agCmd); break;
-        case 1: clientRead(agCmd); break;
-        case 2: readDisk(agCmd); break;
-        case 3: fetchCompute(agCmd); break;
-        case 5: persist(agCmd); break;
-//        case 6: readDiskList(agCmd); break;
-        case 7: readFetchCompute(agCmd); break;
-
-        // for Shortening
-        case 12: readDiskForShortening(agCmd); break;
-        default:break;
+      int prio = agCmd->getPriority();
+      bool waits = waitsOnAgents(type);
+      cout << "OECWorker::doProcess" << endl;
+      if (key == "ag_request" && type != 13 && type != 14) {
+        // 2. route commands into the lane of their class, so the sub-commands
+        // of background work queue behind foreground ones
+        redisReply* lReply = (redisReply*)redisCommand(_processCtx, "rpush %s %b", AGCommand::laneKey(prio, waits).c_str(), reqStr, (size_t)reqLen);
+        freeReplyObject(lReply);
+        delete agCmd;
+      } else if (waits) {
+        // 3. a command that waits on other agents starts on a runner of its
+        // own. It never holds a worker that a disk read it waits for needs, on
+        // this agent or another, so the lanes cannot deadlock across agents
+        cout << "OECWorker::doProcess() start a request of type " << type << " from " << key << endl;
+        acquireLane(agCmd);
+        startRunner(agCmd);
+      } else if (!acquireLane(agCmd)) {
+        // 4. another worker filled the lane in between, put it back to the head
+        redisReply* lReply = (redisReply*)redisCommand(_processCtx, "lpush %s %b", key.c_str(), reqStr, (size_t)reqLen);
+        freeReplyObject(lReply);
+        delete agCmd;
+      } else {
+        // 5. disk reads hold a worker, at most the limit of their lane
+        cout << "OECWorker::doProcess() receive a request of type " << type << " from " << key << endl;
+        _curPrio = prio;
+        //agCmd->dump();
+        runCommand(agCmd);
+        _curPrio = AG_PRIO_FOREGROUND;
+        releaseLane(agCmd);
+        reportLinkBw();
+//        gettimeofday(&time2, NULL);
+//        cout << "OECWorker::doProcess().duration = " << RedisUtil::duration(time1, time2) << endl;
+        delete agCmd;
       }
-//      gettimeofday(&time2, NULL);
-//      cout << "OECWorker::doProcess().duration = " << RedisUtil::duration(time1, time2) << endl;
-      // delete agCmd
-      delete agCmd;
     }
     // free reply object
     freeReplyObject(rReply); 
   }
 }
 
+void OECWorker::runCommand(AGCommand* agCmd) {
+  switch (agCmd->getType()) {
+    case 0: clientWrite(agCmd); break;
+    case 1: clientRead(agCmd); break;
+    case 16: clientRead(agCmd); break;
+    case 2: readDisk(agCmd); break;
+    case 3: fetchCompute(agCmd); break;
+    case 5: persist(agCmd); break;
+//    case 6: readDiskList(agCmd); break;
+    case 7: readFetchCompute(agCmd); break;
+
+    // for Shortening
+    case 12: readDiskForShortening(agCmd); break;
+
+    // for throttling
+    case 13: setThrottle(agCmd); break;
+    case 14: reportThrottle(agCmd); break;
+
+    case 15: batch(agCmd); break;
+    default:break;
+  }
+}
+
 void OECWorker::clientWrite(AGCommand* agcmd) {
   cout << "OECWorker::clientWrite" << endl;
   string filename = agcmd->getFilename();
@@ -488,6 +625,7 @@ void OECWorker::computeWorkerDegradedOffline(FSObjInputStream** readStreams,
           codeBufIdx++;
         }
         // perform compute operation
+        Throttle::consume(_curPrio, THROTTLE_COMPUTE, (long)splitsize * col);
         Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
         free(matrix);
         free(code);
@@ -636,6 +774,7 @@ void OECWorker::computeWorker(FSObjInputStream** readStreams,
           codeBufIdx++;
         }
         // perform compute operation
+        Throttle::consume(_curPrio, THROTTLE_COMPUTE, (long)splitsize * col);
         Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
       }
       // check whether there is a need to discuss about row*col = 1
@@ -674,177 +813,199 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
                        int ecn,
                        int eck,
                        int ecw) {
-  struct timeval time1, time2, time3;
+  struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  cout << "OECWorker::computeWorker.stripenum: " << stripenum;
-  // In this method, we fetch eck pkts from readQueue and cache into runtime memory
-  // If there is need, we need to divide pkt into splits for sub-packetization
-  // Then we perform calculations inside ECTask list one by one, results are cached in runtime memory
-  // Finally we put data from ecn into output streams
+  // In this method, we fetch eck pkts from readQueue as a stripe and hand it to an encode worker
+  // Sub-packets of a pkt are slices of its buffer, so parity is computed in place of the parity pkts
+  // Stripes are encoded in parallel and put into output streams in stripe order
 
-  OECDataPacket** curStripe = (OECDataPacket**)calloc(ecn, sizeof(OECDataPacket*));
   int pktsize = _conf->_pktSize;
   int splitsize = pktsize / ecw;
-  cout << ", pktsize: " << pktsize
+  int threadnum = max(1, min(_conf->_agEncodeThreadNum, stripenum));
+  cout << "OECWorker::computeWorker.stripenum: " << stripenum
+       << ", pktsize: " << pktsize
        << ", splitsize: " << splitsize
        << ", ecn: " << ecn
        << ", eck: " << eck
-       << ", ecw: " << ecw << endl;
+       << ", ecw: " << ecw
+       << ", threads: " << threadnum << endl;
+
+  // 1. compile compute tasks into region ops once for all stripes
+  vector<EncodeOp> ops = compileEncode(computeTasks);
+  vector<EncodeOp>* opsptr = &ops;
+
+  // 2. stripe s is encoded by worker s % threadnum. A worker holds at most
+  //    ENCODE_QUEUE_DEPTH stripes, its slot is returned when the stripe is
+  //    handed to the output streams, so a slow worker holds back the reads
+  BlockingQueue<OECDataPacket**>** inQueue = (BlockingQueue<OECDataPacket**>**)calloc(threadnum, sizeof(BlockingQueue<OECDataPacket**>*));
+  BlockingQueue<OECDataPacket**>** outQueue = (BlockingQueue<OECDataPacket**>**)calloc(threadnum, sizeof(BlockingQueue<OECDataPacket**>*));
+  BlockingQueue<int>** slots = (BlockingQueue<int>**)calloc(threadnum, sizeof(BlockingQueue<int>*));
+  double* computeMs = (double*)calloc(threadnum, sizeof(double));
+  vector<thread> encodeThreads = vector<thread>(threadnum);
+  for (int i=0; i<threadnum; i++) {
+    inQueue[i] = new BlockingQueue<OECDataPacket**>();
+    outQueue[i] = new BlockingQueue<OECDataPacket**>();
+    slots[i] = new BlockingQueue<int>();
+    for (int j=0; j<ENCODE_QUEUE_DEPTH; j++) slots[i]->push(j);
+    int curnum = stripenum / threadnum;
+    if (i < stripenum % threadnum) curnum = curnum + 1;
+    encodeThreads[i] = thread([=]{encodeWorker(opsptr, inQueue[i], outQueue[i], curnum, ecn, ecw, computeMs+i);});
+  }
+
+  // 3. encoded stripes are put into output streams in stripe order
+  thread collectThread = thread([=]{
+    for (int stripeid=0; stripeid<stripenum; stripeid++) {
+      OECDataPacket** curStripe = outQueue[stripeid % threadnum]->pop();
+      for (int pktidx=0; pktidx<ecn; pktidx++) {
+        objstreams[pktidx]->enqueue(curStripe[pktidx]);
+      }
+      free(curStripe);
+      slots[stripeid % threadnum]->push(stripeid);
+    }
+  });
 
   for (int stripeid=0; stripeid<stripenum; stripeid++) {
+    slots[stripeid % threadnum]->pop();
+    OECDataPacket** curStripe = (OECDataPacket**)calloc(ecn, sizeof(OECDataPacket*));
     for (int pktidx=0; pktidx < eck; pktidx++) {
-      OECDataPacket* curPkt = readQueue[pktidx]->pop();
-      curStripe[pktidx] = curPkt;
+      curStripe[pktidx] = readQueue[pktidx]->pop();
     }
-    // now we have k pkt in a stripe, prepare pkt for parity pkt 
+    // now we have k pkt in a stripe, prepare pkt for parity pkt
     for (int i=0; i<(ecn-eck); i++) {
-      OECDataPacket* paritypkt = new OECDataPacket(pktsize);
-      curStripe[eck+i] = paritypkt;
+      curStripe[eck+i] = new OECDataPacket(pktsize);
     }
+    inQueue[stripeid % threadnum]->push(curStripe);
+  }
 
-    unordered_map<int, char*> bufMap;
-    // add pkt into bufMap
-    for (int i=0; i<ecn; i++) {
-      char* pktbuf = curStripe[i]->getData();
-      for (int j=0; j<ecw; j++) {
-        int ecidx = i*ecw + j;
-        char* bufaddr = pktbuf+j*splitsize;
-        bufMap.insert(make_pair(ecidx, bufaddr));
-      }
-    }
-
-    vector<int> shortening_free_list; // free list for shortening
-
-    // now perform computation in compute task one by one
-    for (int taskid=0; taskid<computeTasks.size(); taskid++) {
-      ECTask* compute = computeTasks[taskid];
-      vector<int> children = compute->getChildren();
-
-      if (stripeid == 0) {
-        cout << "children: ";
-        for (int childid=0; childid<children.size(); childid++) {
-          cout << children[childid] << " ";
-        }
-        cout << endl;
-      }
-
-      unordered_map<int, vector<int>> coefMap = compute->getCoefMap();
-
-      if (stripeid == 0) {
-        cout << "coef: "<< endl;
-        for (auto item: coefMap) {
-          int target = item.first;
-          vector<int> coefs = item.second;
-          cout << "    " << target << ": " << "( ";
-          for (int coefidx=0; coefidx<coefs.size(); coefidx++) cout << coefs[coefidx] << " ";
-          cout << ")" << endl;
-        }
-      }
-
-      int col = children.size();
-      int row = coefMap.size();
-      vector<int> targets;
-      // here modify > to >=
-      if (col*row >= 1) {
-        int* matrix = (int*)calloc(row*col, sizeof(int));
-        char** data = (char**)calloc(col, sizeof(char*));
-        char** code = (char**)calloc(row, sizeof(char*));
-
-        // prepare the data buf
-        // actually, data buf should always exist
-        for (int bufIdx = 0; bufIdx < children.size(); bufIdx++) {
-          int child = children[bufIdx];
+  // join
+  for (int i=0; i<threadnum; i++) encodeThreads[i].join();
+  collectThread.join();
 
-          // support shortening
-          if (child >= ecn * ecw && bufMap.find(child) == bufMap.end()) {
-            shortening_free_list.push_back(child);
-            char* slicebuf = (char *) calloc(splitsize, sizeof(char));
-            bufMap[child] = slicebuf;
-          }
+  // 4. encode throughput, parity bytes over the compute time of the workers
+  double totalMs = 0;
+  for (int i=0; i<threadnum; i++) totalMs += computeMs[i];
+  double mbps = totalMs > 0 ? (double)stripenum * (ecn-eck) * pktsize / 1048576 / (totalMs / 1000) : 0;
+  cout << "OECWorker::computeWorker.encode = " << mbps << " MB/s per thread, " << totalMs << " ms over " << threadnum << " threads" << endl;
 
-          // check whether there is buf in databuf
-          assert (bufMap.find(child) != bufMap.end());
-          data[bufIdx] = bufMap[child];
-          if (stripeid == 0) {
-            cout << "data["<<bufIdx<<"] = bufMap[" <<child<<"]"<< endl;
-          }
-        }
-        // prepare the code buf
-        int codeBufIdx = 0;
-        for (auto it: coefMap) {
-          int target = it.first;
-          char* codebuf;
-          if (bufMap.find(target) == bufMap.end()) {
-            codebuf = (char*)calloc(splitsize, sizeof(char));
-            bufMap.insert(make_pair(target, codebuf)); 
-            if (stripeid == 0) cout << "code["<<codeBufIdx<<"] = new" << endl;
-          } else {
-            codebuf = bufMap[target];
-            if (stripeid == 0) cout << "code["<<codeBufIdx<<"] = bufMap[" << target << "]" << endl;
-          }
-          code[codeBufIdx] = codebuf;
+  // free
+  for (int i=0; i<threadnum; i++) {
+    delete inQueue[i];
+    delete outQueue[i];
+    delete slots[i];
+  }
+  free(inQueue);
+  free(outQueue);
+  free(slots);
+  free(computeMs);
+  gettimeofday(&time2, NULL);
+  cout << "OECWorker::computeWorker.duration = " << RedisUtil::duration(time1, time2) << endl;
+}
 
-          targets.push_back(target);
-          vector<int> curcoef = it.second;
-          for (int j=0; j<col; j++) {
-            matrix[codeBufIdx * col + j] = curcoef[j];
-          }
-          codeBufIdx++;
-        }
-        if (stripeid == 0) {
-          cout << "matrix: " << endl;
-          for (int ii=0; ii<row; ii++) {
-            for (int jj=0; jj<col; jj++) {
-              cout << matrix[ii*col+jj] << " ";
-            }
-            cout << endl;
-          }
-        }
-        // perform compute operation
-        Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
-        free(code);
-        free(data);
-        free(matrix);
+vector<OECWorker::EncodeOp> OECWorker::compileEncode(vector<ECTask*> computeTasks) {
+  vector<EncodeOp> ops;
+  set<int> produced;
+  int sealed = 0; // ops before sealed are not merged into
+  for (auto compute: computeTasks) {
+    vector<int> children = compute->getChildren();
+    unordered_map<int, vector<int>> coefMap = compute->getCoefMap();
+    int col = children.size();
+    int row = coefMap.size();
+    if (col*row < 1) continue;
+
+    // 1. a task with the same children as an earlier op adds rows to it, such
+    //    that its children are read once, e.g., parity of a base code instance.
+    //    a task rewriting a symbol keeps its place
+    bool rewrite = false;
+    for (auto it: coefMap) {
+      if (produced.find(it.first) != produced.end()) rewrite = true;
+    }
+    int opidx = -1;
+    for (int i=ops.size()-1; i>=sealed && !rewrite; i--) {
+      if (ops[i].children == children) {
+        opidx = i;
+        break;
       }
-      // check whether there is a need to discuss about row*col = 1
     }
-
-    printf("shortening_free_list: ");
-    for (auto pkt_idx : shortening_free_list) {
-      printf("%d ", pkt_idx);
+    if (opidx < 0) {
+      EncodeOp op;
+      op.children = children;
+      ops.push_back(op);
+      opidx = ops.size()-1;
     }
-    printf("\n");
 
-    // now computation is finished, we take out pkt from stripe and put into outputstream
-    for (int pktidx=0; pktidx<ecn; pktidx++) {
-      objstreams[pktidx]->enqueue(curStripe[pktidx]);
-      curStripe[pktidx] = NULL;
+    // 2. one matrix row for each target
+    for (auto it: coefMap) {
+      ops[opidx].targets.push_back(it.first);
+      for (int j=0; j<col; j++) ops[opidx].matrix.push_back(it.second[j]);
+      produced.insert(it.first);
     }
+    if (rewrite) sealed = ops.size();
+  }
 
-    // free buffers and remove the items in shortening free list
-    for (auto pkt_idx : shortening_free_list) {
-      free(bufMap[pkt_idx]);
-      bufMap.erase(bufMap.find(pkt_idx));
+  cout << "OECWorker::compileEncode " << computeTasks.size() << " tasks into " << ops.size() << " ops" << endl;
+  for (auto& op: ops) {
+    cout << "    children: ( ";
+    for (auto child: op.children) cout << child << " ";
+    cout << "), targets: ( ";
+    for (auto target: op.targets) cout << target << " ";
+    cout << ")" << endl;
+  }
+  return ops;
+}
+
+void OECWorker::encodeWorker(vector<EncodeOp>* ops,
+                             BlockingQueue<OECDataPacket**>* inQueue,
+                             BlockingQueue<OECDataPacket**>* outQueue,
+                             int stripenum,
+                             int ecn,
+                             int ecw,
+                             double* computeMs) {
+  int splitsize = _conf->_pktSize / ecw;
+  struct timeval time1, time2;
+
+  // 0. symbols beyond the stripe get buffers reused by every stripe;
+  //    shortened symbols are never written and stay zero
+  unordered_map<int, char*> scratch;
+  vector<vector<char*>> data = vector<vector<char*>>(ops->size());
+  vector<vector<char*>> code = vector<vector<char*>>(ops->size());
+  for (int i=0; i<ops->size(); i++) {
+    EncodeOp& op = (*ops)[i];
+    data[i] = vector<char*>(op.children.size());
+    code[i] = vector<char*>(op.targets.size());
+    vector<int> symbols = op.children;
+    symbols.insert(symbols.end(), op.targets.begin(), op.targets.end());
+    for (auto cidx: symbols) {
+      if (cidx >= ecn*ecw && scratch.find(cidx) == scratch.end()) {
+        scratch.insert(make_pair(cidx, (char*)calloc(splitsize, sizeof(char))));
+      }
     }
+  }
 
-    // clear data in bufMap
-    unordered_map<int, char*>::iterator it = bufMap.begin();
-    while (it != bufMap.end()) {
-      int sidx = it->first/ecw;
-      if (sidx < ecn) {
-        curStripe[sidx] = NULL;
-      } else {
-        if (it->second) free(it->second);
+  for (int stripeid=0; stripeid<stripenum; stripeid++) {
+    OECDataPacket** curStripe = inQueue->pop();
+    gettimeofday(&time1, NULL);
+    for (int i=0; i<ops->size(); i++) {
+      EncodeOp& op = (*ops)[i];
+      int col = op.children.size();
+      int row = op.targets.size();
+      // symbol i*ecw+j is sub-packet j of pkt i
+      for (int j=0; j<col; j++) {
+        int cidx = op.children[j];
+        data[i][j] = cidx < ecn*ecw ? curStripe[cidx/ecw]->getData() + (cidx%ecw)*splitsize : scratch[cidx];
       }
-      it++;
+      for (int j=0; j<row; j++) {
+        int cidx = op.targets[j];
+        code[i][j] = cidx < ecn*ecw ? curStripe[cidx/ecw]->getData() + (cidx%ecw)*splitsize : scratch[cidx];
+      }
+      Throttle::consume(_curPrio, THROTTLE_COMPUTE, (long)splitsize * col);
+      Computation::Multi(code[i].data(), data[i].data(), op.matrix.data(), row, col, splitsize, "Isal");
     }
-    bufMap.clear();
+    gettimeofday(&time2, NULL);
+    *computeMs += RedisUtil::duration(time1, time2);
+    outQueue->push(curStripe);
   }
 
-  // free
-  free(curStripe);
-  gettimeofday(&time2, NULL);
-  cout << "OECWorker::computeWorker.duration = " << RedisUtil::duration(time1, time2) << endl;
+  for (auto it: scratch) free(it.second);
 }
 
 void OECWorker::readDisk(AGCommand* agcmd) {
@@ -855,6 +1016,7 @@ void OECWorker::readDisk(AGCommand* agcmd) {
   vector<int> cidlist = agcmd->getReadCidList();
   sort(cidlist.begin(), cidlist.end());
   unordered_map<int, int> refs = agcmd->getCacheRefs();
+  int readstart = agcmd->getReadStart();
 
   int pktsize = _conf->_pktSize;
   int slicesize = pktsize/w;
@@ -862,12 +1024,24 @@ void OECWorker::readDisk(AGCommand* agcmd) {
   int numThreads = cidlist.size();
 
   FSObjInputStream* objstream = new FSObjInputStream(_conf, objname, _underfs);
+
+  objstream->setPriority(_curPrio);
   if (!objstream->exist()) {
     cout << "OECWorker::readWorker." << objname << " does not exist!" << endl;
     return;
   }
 
-  if (w == 1 || w == cidlist.size()) {
+  if (readstart > 0) {
+    // a packet range of the obj, read from its first packet
+    thread readThread = thread([=]{objstream->readObjOptimized(w, cidlist, slicesize, readstart, num);});
+    BlockingQueue<OECDataPacket*>* readQueue = objstream->getQueue();
+    // cacheThread
+    thread cacheThread = thread([=]{partialCacheWorker(readQueue, num, stripename, w, cidlist, refs);});
+
+    // join
+    readThread.join();
+    cacheThread.join();
+  } else if (w == 1 || w == cidlist.size()) {
     // serail read
     // read data in serial from disk
     thread readThread = thread([=]{objstream->readObj(slicesize);});
@@ -904,6 +1078,7 @@ void OECWorker::readDiskForShortening(AGCommand* agcmd) {
   vector<int> cidlist = agcmd->getReadCidList();
   sort(cidlist.begin(), cidlist.end());
   unordered_map<int, int> refs = agcmd->getCacheRefs();
+  int readstart = agcmd->getReadStart();
 
   int pktsize = _conf->_pktSize;
   int slicesize = pktsize/w;
@@ -924,12 +1099,24 @@ void OECWorker::readDiskForShortening(AGCommand* agcmd) {
   int numThreads = cidlist.size();
 
   FSObjInputStream* objstream = new FSObjInputStream(_conf, objname, _underfs);
+
+  objstream->setPriority(_curPrio);
   if (!objstream->exist()) {
     cout << "OECWorker::readWorker." << objname << " does not exist!" << endl;
     return;
   }
 
-  if (w == 1 || w == cidlist.size()) {
+  if (readstart > 0) {
+    // a packet range of the obj, read from its first packet
+    thread readThread = thread([=]{objstream->readObjOptimized(w, cidlist, slicesize, readstart, num);});
+    BlockingQueue<OECDataPacket*>* readQueue = objstream->getQueue();
+    // cacheThread
+    thread cacheThread = thread([=]{partialCacheWorker(readQueue, num, stripename, w, cidlist, refs);});
+
+    // join
+    readThread.join();
+    cacheThread.join();
+  } else if (w == 1 || w == cidlist.size()) {
     // serail read
     // read data in serial from disk
     thread readThread = thread([=]{objstream->readObj(slicesize);});
@@ -957,6 +1144,50 @@ void OECWorker::readDiskForShortening(AGCommand* agcmd) {
   cout << "OECWorker::readDiskForShortening finishes!" << endl;
 }
 
+void OECWorker::setThrottle(AGCommand* agcmd) {
+  int prio = agcmd->getThrottlePrio();
+  int res = agcmd->getThrottleRes();
+  long rate = (long)agcmd->getThrottleRateKB() * 1024;
+  Throttle::setRate(prio, res, rate);
+}
+
+void OECWorker::observeLinkBw(unsigned int src, double bw) {
+  // smooth the samples, a single fetch may be slowed down by its producer
+  _linkBwLock.lock();
+  if (_linkBw.find(src) == _linkBw.end()) _linkBw[src] = bw;
+  else _linkBw[src] = 0.7 * _linkBw[src] + 0.3 * bw;
+  _linkBwDirty.insert(src);
+  _linkBwLock.unlock();
+}
+
+void OECWorker::reportLinkBw() {
+  unordered_map<unsigned int, double> toreport;
+  _linkBwLock.lock();
+  for (auto src: _linkBwDirty) toreport.insert(make_pair(src, _linkBw[src]));
+  _linkBwDirty.clear();
+  _linkBwLock.unlock();
+  if (toreport.empty()) return;
+
+  // linkbw:<dst> is a hash of src -> bytes per second on the coordinator
+  string key = "linkbw:" + RedisUtil::ip2Str(_conf->_localIp);
+  for (auto item: toreport) {
+    string src = RedisUtil::ip2Str(item.first);
+    string bw = to_string((long long)item.second);
+    redisReply* rReply = (redisReply*)redisCommand(_coorCtx, "hset %s %s %s", key.c_str(), src.c_str(), bw.c_str());
+    freeReplyObject(rReply);
+  }
+}
+
+void OECWorker::reportThrottle(AGCommand* agcmd) {
+  // ip usage, to the key of the request, which expires if the coordinator stopped waiting
+  string report = RedisUtil::ip2Str(_conf->_localIp) + " " + Throttle::usage();
+  string key = "throttleusage:" + to_string(agcmd->getReportId());
+  redisReply* rReply = (redisReply*)redisCommand(_coorCtx, "rpush %s %b", key.c_str(), report.c_str(), report.length());
+  freeReplyObject(rReply);
+  rReply = (redisReply*)redisCommand(_coorCtx, "expire %s 60", key.c_str());
+  freeReplyObject(rReply);
+}
+
 void OECWorker::selectCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
                                   int pktnum,
                                   string keybase,
@@ -996,6 +1227,7 @@ void OECWorker::selectCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
       //cout << "len = "  << len << ", key = " << key << endl;
       char* raw = curslice->getRaw();
       int rawlen = len + 4;
+      Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
       for (int k=0; k<refnum; k++) {
         redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
       }
@@ -1043,6 +1275,7 @@ void OECWorker::partialCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
       //cout << "len = "  << len << ", key = " << key << endl;
       char* raw = curslice->getRaw();
       int rawlen = len + 4;
+      Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
       for (int k=0; k<refnum; k++) {
         redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
       }
@@ -1090,6 +1323,7 @@ void OECWorker::pushShorteningPktsToRedis(int pktnum,
       //cout << "len = "  << len << ", key = " << key << endl;
       char* raw = curslice->getRaw();
       int rawlen = len + 4;
+      Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
       for (int k=0; k<refnum; k++) {
         redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
       }
@@ -1195,12 +1429,18 @@ void OECWorker::fetchWorker(BlockingQueue<OECDataPacket*>* fetchQueue,
 
   struct timeval t1, t2;
   double t;
+  struct timeval firstpkt;
+  long bytes = 0;
   for (int i=replyid; i<num; i++) {
     string key = keybase+":"+to_string(i);
     gettimeofday(&t1, NULL);
     redisGetReply(fetchCtx, (void**)&rReply);
     gettimeofday(&t2, NULL);
     //if (i == 0) cout << "OECWorker::fetchWorker.fetch first t = " << RedisUtil::duration(t1, t2) << endl;
+    if (loc != _conf->_localIp) Throttle::consume(_curPrio, THROTTLE_NETIN, rReply->element[1]->len);
+    // the first packet waits for the producer to start, only count the following ones
+    if (i == replyid) firstpkt = t2;
+    else bytes += rReply->element[1]->len;
     char* content = rReply->element[1]->str;
     OECDataPacket* pkt = new OECDataPacket(content);
     int curDataLen = pkt->getDatalen();
@@ -1209,6 +1449,8 @@ void OECWorker::fetchWorker(BlockingQueue<OECDataPacket*>* fetchQueue,
   }
   gettimeofday(&time2, NULL);
   cout << "OECWorker::fetchWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase << endl;
+  double streamms = RedisUtil::duration(firstpkt, time2);
+  if (loc != _conf->_localIp && bytes > 0 && streamms > 0) observeLinkBw(loc, bytes * 1000.0 / streamms);
   redisFree(fetchCtx);
 }
 
@@ -1255,6 +1497,7 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       code[i] = curstripe[col+i]->getData();
     }
     // compute
+    Throttle::consume(_curPrio, THROTTLE_COMPUTE, (long)slicesize * col);
     Computation::Multi(code, data, matrix, row, col, slicesize, "Isal");
 
     // now we free data
@@ -1320,6 +1563,7 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       code[i] = curstripe[col+i]->getData();
     }
     // compute
+    Throttle::consume(_curPrio, THROTTLE_COMPUTE, (long)slicesize * col);
     Computation::Multi(code, data, matrix, row, col, slicesize, "Isal");
 
     // put needed data into writeQueue
@@ -1374,6 +1618,7 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
     OECDataPacket* curpkt = writeQueue->pop();
     char* raw = curpkt->getRaw();
     int rawlen = curpkt->getDatalen() + 4;
+    Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
     for (int k=0; k<ref; k++) {
       redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
     }
@@ -1395,6 +1640,27 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
   redisFree(writeCtx);
 }
 
+void OECWorker::rangeCacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
+                                 string keybase,
+                                 int num,
+                                 int firstpkt,
+                                 int lastpkt) {
+  if (firstpkt == 0 && lastpkt == num-1) {
+    cacheWorker(writeQueue, keybase, num, 1);
+    return;
+  }
+  // packets out of the range are dropped, the others go to a cache worker
+  BlockingQueue<OECDataPacket*>* cacheQueue = new BlockingQueue<OECDataPacket*>();
+  thread cacheThread = thread([=]{cacheWorker(cacheQueue, keybase, firstpkt, lastpkt - firstpkt + 1, 1);});
+  for (int i=0; i<num; i++) {
+    OECDataPacket* curpkt = writeQueue->pop();
+    if (i >= firstpkt && i <= lastpkt) cacheQueue->push(curpkt);
+    else delete curpkt;
+  }
+  cacheThread.join();
+  delete cacheQueue;
+}
+
 void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
                             string keybase,
                             int num,
@@ -1415,6 +1681,7 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
     OECDataPacket* curpkt = writeQueue->pop();
     char* raw = curpkt->getRaw();
     int rawlen = curpkt->getDatalen() + 4;
+    Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
     for (int k=0; k<ref; k++) {
       redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
     }
@@ -1459,6 +1726,7 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
     OECDataPacket* curpkt = writeQueue->pop();
     char* raw = curpkt->getRaw();
     int rawlen = curpkt->getDatalen() + 4;
+    Throttle::consume(_curPrio, THROTTLE_NETOUT, rawlen);
     for (int k=0; k<ref; k++) {
       redisAppendCommand(writeCtx, "RPUSH %s %b", key.c_str(), raw, rawlen); count++;
     }
@@ -1487,7 +1755,9 @@ void OECWorker::persist(AGCommand* agcmd) {
   int nprevs = agcmd->getNprevs();
   vector<int> prevcids = agcmd->getPrevCids();
   vector<unsigned int> prevlocs = agcmd->getPrevLocs();
-  string objname = agcmd->getWriteObjName();
+  // a tagged obj is reported under its tag
+  string completionkey = agcmd->getWriteObjName();
+  string objname = completionkey.substr(0, completionkey.find(COMPLETION_TAG));
 
   for (int i=0; i<nprevs; i++) {
     string keybase = stripename+":"+to_string(prevcids[i]);
@@ -1534,17 +1804,93 @@ void OECWorker::persist(AGCommand* agcmd) {
   free(fetchQueue);
   if (objstream) delete objstream;
 
-  // write a finish flag to local?
-  // writefinish:objname
-  redisReply* rReply;
-  redisContext* writeCtx = RedisUtil::createContext(_conf->_localIp);
+  // report the persisted object to the completion channel of coordinator
+  if (_inBatch) {
+    _batchLock.lock();
+    _batchCompleted.push_back(completionkey);
+    _batchLock.unlock();
+  } else {
+    redisReply* rReply = (redisReply*)redisCommand(_coorCtx, "rpush oec_completion %b", completionkey.c_str(), completionkey.length());
+    freeReplyObject(rReply);
+  }
+  cout << "OECWorker::persist finishes!" << endl;
+}
+
+void OECWorker::batch(AGCommand* agcmd) {
+  vector<vector<string>> stripeCmds = agcmd->getBatchCmds();
+  int window = max(agcmd->getBatchWindow(), 1);
+  cout << "OECWorker::batch " << stripeCmds.size() << " stripes, window " << window << endl;
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+
+  // stripes start in order. Disk reads of a stripe queue in the lane of the
+  // batch like any other read, so the batch holds no lane and other commands
+  // of the class share it with the batch. Commands that wait on other agents
+  // run on threads of the batch, at most window stripes of them at a time.
+  // Every agent runs the stripes in the same order and each batch runs on a
+  // runner of its own, so the oldest stripe that is not finished always gets
+  // its reads and waiting commands on all its agents
+  _inBatch = true;
+  deque<vector<thread>*> running;
+  for (int i=0; i<stripeCmds.size(); i++) {
+    while (running.size() >= window) {
+      vector<thread>* oldest = running.front();
+      running.pop_front();
+      for (int j=0; j<oldest->size(); j++) (*oldest)[j].join();
+      delete oldest;
+      reportCompletion();
+    }
+    vector<thread>* threads = new vector<thread>();
+    for (auto cmdstr: stripeCmds[i]) {
+      string curstr = cmdstr;
+      AGCommand* subCmd = new AGCommand(&curstr[0], curstr.length());
+      if (!waitsOnAgents(subCmd->getType())) {
+        redisReply* rReply = (redisReply*)redisCommand(_localCtx, "rpush %s %b", AGCommand::laneKey(subCmd->getPriority()).c_str(), cmdstr.c_str(), cmdstr.length());
+        freeReplyObject(rReply);
+        delete subCmd;
+        continue;
+      }
+      threads->push_back(thread([=]{
+        runCommand(subCmd);
+        delete subCmd;
+      }));
+    }
+    if (threads->size()) running.push_back(threads);
+    else delete threads;
+  }
+  while (running.size()) {
+    vector<thread>* oldest = running.front();
+    running.pop_front();
+    for (int j=0; j<oldest->size(); j++) (*oldest)[j].join();
+    delete oldest;
+  }
+  _inBatch = false;
+  reportCompletion();
 
-  string wkey = "writefinish:" + objname;
-  int tmpval = htonl(1);
-  rReply = (redisReply*)redisCommand(writeCtx, "rpush %s %b", wkey.c_str(), (char*)&tmpval, sizeof(tmpval));
+  gettimeofday(&time2, NULL);
+  cout << "OECWorker::batch finishes " << stripeCmds.size() << " stripes in " << RedisUtil::duration(time1, time2) << " ms" << endl;
+}
+
+void OECWorker::reportCompletion() {
+  // one rpush for all the objects persisted since the last report
+  _batchLock.lock();
+  vector<string> objnames;
+  objnames.swap(_batchCompleted);
+  _batchLock.unlock();
+  if (objnames.size() == 0) return;
+
+  vector<const char*> argv;
+  vector<size_t> argvlen;
+  argv.push_back("rpush");
+  argvlen.push_back(5);
+  argv.push_back("oec_completion");
+  argvlen.push_back(14);
+  for (int i=0; i<objnames.size(); i++) {
+    argv.push_back(objnames[i].c_str());
+    argvlen.push_back(objnames[i].length());
+  }
+  redisReply* rReply = (redisReply*)redisCommandArgv(_coorCtx, argv.size(), argv.data(), argvlen.data());
   freeReplyObject(rReply);
-  redisFree(writeCtx);
-  cout << "OECWorker::persist finishes!" << endl;
 }
 
 void OECWorker::clientRead(AGCommand* agcmd) {
@@ -1601,7 +1947,8 @@ void OECWorker::clientRead(AGCommand* agcmd) {
     memcpy((char*)&ecw, metastr, 4); metastr += 4;
     ecw = ntohl(ecw);
 
-    readOnline(filename, filesizeMB, ecn, eck, ecw);
+    if (agcmd->getType() == 16) readOnline(filename, filesizeMB, ecn, eck, ecw, agcmd->getRangeOffset(), agcmd->getRangeLength());
+    else readOnline(filename, filesizeMB, ecn, eck, ecw);
   } else {
     // objnum
     int objnum;
@@ -1624,7 +1971,8 @@ void OECWorker::clientRead(AGCommand* agcmd) {
     }
 
     // modify to read offline with objlist
-    readOffline(filename, filesizeMB, objlist);
+    if (agcmd->getType() == 16) readOffline(filename, filesizeMB, objlist, agcmd->getRangeOffset(), agcmd->getRangeLength());
+    else readOffline(filename, filesizeMB, objlist);
     // readOffline(filename, filesizeMB, objnum);
     
   }
@@ -1662,33 +2010,46 @@ void OECWorker::readOffline(string filename, int filesizeMB, int objnum) {
   free(objstreams);
 }
 
-void OECWorker::readOffline(string filename, int filesizeMB, vector<string> objlist) {
+void OECWorker::readOffline(string filename, int filesizeMB, vector<string> objlist, long offset, long length) {
   int objnum = objlist.size();
 
   cout << "OECWorker::readOffline.filename: " << filename << ", filesizeMB: " << filesizeMB << ", objnum: " << objnum << endl;
 
-  // create inputstream
+  // packets of the file that cover the range
+  int objsizeMB = filesizeMB/objnum;
+  int pktnum = objsizeMB * 1048576/_conf->_pktSize;
+  int firstpkt = 0;
+  int lastpkt = pktnum * objnum - 1;
+  if (length >= 0) {
+    firstpkt = min((long)lastpkt + 1, offset / _conf->_pktSize);
+    lastpkt = min((long)lastpkt, (offset + length - 1) / _conf->_pktSize);
+    cout << "OECWorker::readOffline.range: " << offset << "+" << length << ", packets " << firstpkt << "-" << lastpkt << endl;
+  }
+
+  // create inputstream for objs in the range
   vector<thread> createThreads = vector<thread>(objnum);
   FSObjInputStream** objstreams = (FSObjInputStream**)calloc(objnum, sizeof(FSObjInputStream*));
   for (int i=0; i<objnum; i++) {
+    if ((i+1) * pktnum <= firstpkt || i * pktnum > lastpkt) continue;
     string objname = objlist[i];
     createThreads[i] = thread([=]{objstreams[i] = new FSObjInputStream(_conf, objname, _underfs);});
   }
   for (int i=0; i<objnum; i++) {
-    createThreads[i].join();
+    if (createThreads[i].joinable()) createThreads[i].join();
   }
 
   // read object one by one
-  int objsizeMB = filesizeMB/objnum;
-  int pktnum = objsizeMB * 1048576/_conf->_pktSize;
   for (int i=0; i<objnum; i++) {
+    if (objstreams[i] == NULL) continue;
     string objname = objlist[i];
-    readOfflineObj(filename, objname, objsizeMB, objstreams[i], pktnum, i);
+    int startpkt = max(firstpkt - i * pktnum, 0);
+    int endpkt = min(lastpkt - i * pktnum, pktnum - 1);
+    readOfflineObj(filename, objname, objsizeMB, objstreams[i], pktnum, i, startpkt, endpkt - startpkt + 1);
   }
 
   // free
   for (int i=0; i<objnum; i++) {
-    delete objstreams[i];
+    if (objstreams[i]) delete objstreams[i];
   }
   free(objstreams);
 }
@@ -1720,17 +2081,22 @@ void OECWorker::readOffline(string filename, int filesizeMB, vector<string> objl
 //  }
 //}
 
-void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx) {
+void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx, int startpkt, int rangenum) {
   cout << "OECWorker::readOfflineObj" << endl;
+  // packets are cached as filename:(pktnum*idx + pkt) for pkt in [startpkt, startpkt+rangenum)
+  if (rangenum < 0) rangenum = pktnum - startpkt;
+  bool whole = (startpkt == 0 && rangenum == pktnum);
   bool objexist = objstream->exist();
   if (objexist) {
     cout << "OECWorker::readOfflineObj. "  << objname << " exists!" << endl;
     // this obj is in good health
     // 1. create read thread
-    thread readThread = thread([=]{objstream->readObj();});
+    thread readThread;
+    if (whole) readThread = thread([=]{objstream->readObj();});
+    else readThread = thread([=]{objstream->readObjRange(startpkt, rangenum);});
     BlockingQueue<OECDataPacket*>* writeQueue = objstream->getQueue();
     // 2. cache thread
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx + startpkt, rangenum, 1);});
     // join
     readThread.join();
     cacheThread.join();
@@ -1743,7 +2109,8 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
     // we need to repair this lost obj
     // issue degraded read for this obj
     CoorCommand* coorCmd = new CoorCommand();
-    coorCmd->buildType5(5, _conf->_localIp, objname); 
+    // only the packets in the range are repaired
+    coorCmd->buildType5(5, _conf->_localIp, objname, startpkt, whole ? -1 : rangenum);
     coorCmd->sendTo(_coorCtx);
     delete coorCmd;
     
@@ -1854,37 +2221,6 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       cout << "OECWorker::readOfflineObj issue degraded inst = " << RedisUtil::duration(time1, time2) << endl;
 
 
-      // // 1.0 create input stream
-      // FSObjInputStream** readStreams = (FSObjInputStream**)calloc(loadn, sizeof(FSObjInputStream*));
-      // vector<thread> createThreads = vector<thread>(loadn);
-      // for (int loadi=0; loadi<loadn; loadi++) {
-      //   string loadobjname = loadobj[loadi];
-      //   createThreads[loadi] = thread([=]{readStreams[loadi] = new FSObjInputStream(_conf, loadobjname, _underfs);});
-      // }
-      // for (int loadi=0; loadi<loadn; loadi++) createThreads[loadi].join();
-
-      // vector<thread> readThreads = vector<thread>(loadn);
-      // for (int loadi=0; loadi<loadn; loadi++) {
-      //   int sid = loadidx[loadi];
-      //   vector<int> curlist = sid2Cids[sid];
-      //   readThreads[loadi] = thread([=]{readStreams[loadi]->readObj(ecw, curlist, _conf->_pktSize / ecw);});
-      // }
-
-      // // 2. create cache queue and cache thread
-      // BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
-      // thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
-
-      // // 3. computeThread
-      // thread computeThread = thread([=]{computeWorkerDegradedOffline(readStreams, loadidx, sid2Cids, writeQueue, lostidx, computeTasks, pktnum, ecn, eck, ecw);});
-
-
-      // // join
-      // for (int loadi=0; loadi<loadn; loadi++) readThreads[loadi].join();
-      // computeThread.join();
-      // cacheThread.join();
-
-
-
       // 1.0 create input stream
       FSObjInputStream** readStreams = (FSObjInputStream**)calloc(loadn, sizeof(FSObjInputStream*));
       vector<thread> createThreads = vector<thread>(loadn);
@@ -1894,40 +2230,68 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       }
       for (int loadi=0; loadi<loadn; loadi++) createThreads[loadi].join();
 
+      // 1.1 read only the sub-packets in the plan from each helper
       vector<thread> readThreads = vector<thread>(loadn);
       for (int loadi=0; loadi<loadn; loadi++) {
         int sid = loadidx[loadi];
         vector<int> curlist = sid2Cids[sid];
-        // readThreads[loadi] = thread([=]{readStreams[loadi]->readObj(ecw, curlist, _conf->_pktSize / ecw);});
-        readThreads[loadi] = thread([=]{readStreams[loadi]->readObjOptimized(ecw, curlist, _conf->_pktSize / ecw);});
+        readThreads[loadi] = thread([=]{readStreams[loadi]->readObjOptimized(ecw, curlist, _conf->_pktSize / ecw, startpkt, rangenum);});
       }
 
-      for (int loadi=0; loadi<loadn; loadi++) readThreads[loadi].join();
-
-      gettimeofday(&time3, NULL);
-      cout << "OECWorker::readOfflineObj loadObj = " << RedisUtil::duration(time2, time3) << endl;
+      // 2. computeThread decodes each stripe of the range as soon as its sub-packets are read
+      BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
+      BlockingQueue<OECDataPacket*>* computeQueue = writeQueue;
+      thread computeThread;
+
+      // 2.1 with repair on read, a whole obj is also kept as writeback:<obj>:0:<pktidx>
+      // for its new location to persist
+      bool writeback = _conf->_repairOnRead && whole;
+      BlockingQueue<OECDataPacket*>* backQueue = NULL;
+      thread teeThread, backThread;
+      if (writeback) {
+        computeQueue = new BlockingQueue<OECDataPacket*>();
+        backQueue = new BlockingQueue<OECDataPacket*>();
+        teeThread = thread([=]{
+          for (int i=0; i<rangenum; i++) {
+            OECDataPacket* curpkt = computeQueue->pop();
+            backQueue->push(new OECDataPacket(curpkt->getRaw()));
+            writeQueue->push(curpkt);
+          }
+        });
+        backThread = thread([=]{cacheWorker(backQueue, "writeback:"+objname+":0", rangenum, 1);});
+      }
+      computeThread = thread([=]{computeWorkerDegradedOffline(readStreams, loadidx, sid2Cids, computeQueue, lostidx, computeTasks, rangenum, ecn, eck, ecw);});
 
+      // 3. cacheThread
+      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx + startpkt, rangenum, 1);});
 
-      // 2. computeThread
-      BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
-      thread computeThread = thread([=]{computeWorkerDegradedOffline(readStreams, loadidx, sid2Cids, writeQueue, lostidx, computeTasks, pktnum, ecn, eck, ecw);});
+      // reads, compute and cache overlap, each is timed from the start of the
+      // reads until it finishes
+      for (int loadi=0; loadi<loadn; loadi++) readThreads[loadi].join();
+      gettimeofday(&time3, NULL);
+      cout << "OECWorker::readOfflineObj reads done after " << RedisUtil::duration(time2, time3) << endl;
 
       computeThread.join();
-
       gettimeofday(&time4, NULL);
-      cout << "OECWorker::readOfflineObj compute = " << RedisUtil::duration(time3, time4) << endl;
-
-
-      // 3. cacheThread
-      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+      cout << "OECWorker::readOfflineObj compute done after " << RedisUtil::duration(time2, time4) << endl;
 
       cacheThread.join();
-
       gettimeofday(&time5, NULL);
-      cout << "OECWorker::readOfflineObj write to redis = " << RedisUtil::duration(time4, time5) << endl;
-
+      cout << "OECWorker::readOfflineObj cache done after " << RedisUtil::duration(time2, time5) << endl;
+      cout << "OECWorker::readOfflineObj degraded read = " << RedisUtil::duration(time1, time5) << endl;
+
+      // 4. the coordinator moves the obj to its new location
+      if (writeback) {
+        teeThread.join();
+        backThread.join();
+        delete computeQueue;
+        delete backQueue;
+        CoorCommand* wbCmd = new CoorCommand();
+        wbCmd->buildType23(23, _conf->_localIp, objname);
+        wbCmd->sendTo(_coorCtx);
+        delete wbCmd;
+      }
 
-      
       // free
       for (int loadi=0; loadi<loadn; loadi++) delete readStreams[loadi];
       free(readStreams);
@@ -1977,13 +2341,14 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       for (int i=0; i<num; i++) {
         int cid = cidxlist[i];
         string keybase = stripename+":"+to_string(cid);
-        fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, iplist[i], pktnum);});
+        fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, iplist[i], rangenum);});
       } 
 
-      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx + startpkt, rangenum, 1);});
 
       //fetch pkt from fetchQueue to writeQueue
-      for (int i=0; i<pktnum; i++) {
+      // agents repair the packets of the range only, cached as 0..rangenum-1
+      for (int i=0; i<rangenum; i++) {
         if (num == 1) {
           OECDataPacket* curpkt = fetchQueue[0]->pop();
           writeQueue->push(curpkt);
@@ -2019,11 +2384,21 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
   }
 }
 
-void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw) {
+void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw, long offset, long length) {
   struct timeval time1, time2, time3, time4;
   gettimeofday(&time1, NULL);
   cout << "OECWorker::readOnline.filename: " << filename << ", filesizeMB: " << filesizeMB << ", ecn: " << ecn << ", eck: " << eck << ", ecw: " << ecw << endl;
 
+  // packets of the file that cover the range, the others are read and dropped
+  int pktnum = filesizeMB * 1048576/_conf->_pktSize;
+  int firstpkt = 0;
+  int lastpkt = pktnum - 1;
+  if (length >= 0) {
+    firstpkt = min((long)lastpkt + 1, offset / _conf->_pktSize);
+    lastpkt = min((long)lastpkt, (offset + length - 1) / _conf->_pktSize);
+    cout << "OECWorker::readOnline.range: " << offset << "+" << length << ", packets " << firstpkt << "-" << lastpkt << endl;
+  }
+
   // 1. create ecn input stream and check integrity
   vector<int> integrity;
   vector<int> corruptIdx;
@@ -2056,10 +2431,9 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
     }
 
     // version 1 start: single caching thread
-    int pktnum = filesizeMB * 1048576/_conf->_pktSize; 
     BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
     // 1.1 cacheThread
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum, 1);});
+    thread cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, pktnum, firstpkt, lastpkt);});
 
     // 1.3 get pkt from readThread to writeThread
     struct timeval push1, push2;
@@ -2159,8 +2533,7 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
 
     BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
     // 1.1 cacheThread
-    int pktnum = filesizeMB * 1048576/_conf->_pktSize; 
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum, 1);});
+    thread cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, pktnum, firstpkt, lastpkt);});
 
     // 2.1 computeThread
     int stripenum = pktnum/eck;
@@ -2201,12 +2574,14 @@ void OECWorker::readFetchCompute(AGCommand* agCmd) {
   vector<unsigned int> prevLocs = agCmd->getPrevLocs();
   unordered_map<int, vector<int>> coefs = agCmd->getCoefs();
   unordered_map<int, int> cacheRefs = agCmd->getCacheRefs();
+  int readstart = agCmd->getReadStart();
 
   vector<int> computefor;
   for (auto item: coefs) computefor.push_back(item.first);
 
   // create objstream to read data from disk
   FSObjInputStream* objstream = new FSObjInputStream(_conf, readObjName, _underfs);
+  objstream->setPriority(_curPrio);
   if (!objstream->exist()) {
     cout << "OECWorker::readWorker." << readObjName << " does not exist!" << endl;
     return;
@@ -2237,7 +2612,8 @@ void OECWorker::readFetchCompute(AGCommand* agCmd) {
   int slicesize = pktsize/ecw;
   for (int i=0; i<nprevs; i++) {
     if (prevCids[i] == cid) {
-      fetchThreads[i] = thread([=]{objstream->readObj(pktsize);});
+      if (readstart > 0) fetchThreads[i] = thread([=]{objstream->readObjRange(readstart, pktnum);});
+      else fetchThreads[i] = thread([=]{objstream->readObj(pktsize);});
     } else {
       string keybase = stripename+":"+to_string(prevCids[i]);
       fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, prevLocs[i], pktnum);});
@@ -3,10 +3,12 @@
 
 #include <iomanip>
 #include "BlockingQueue.hh"
+#include "CompletionChannel.hh"
 #include "Config.hh"
 #include "FSObjInputStream.hh"
 #include "FSObjOutputStream.hh"
 #include "OECDataPacket.hh"
+#include "Throttle.hh"
 //#include "ECBase.hh"
 //#include "RSCONV.hh"
 //#include "Util/hdfs.h"
@@ -20,6 +22,9 @@
 #include "../protocol/CoorCommand.hh"
 #include "../util/RedisUtil.hh"
 
+// stripes of an online write an encode worker holds at a time
+#define ENCODE_QUEUE_DEPTH 4
+
 class OECWorker {
   private: 
     Config* _conf;
@@ -29,6 +34,40 @@ class OECWorker {
     redisContext* _coorCtx;
 
     UnderFS* _underfs;
+    bool _ownFS = true;
+
+    int _curPrio = AG_PRIO_FOREGROUND; // class of the command in progress, charged by throttles
+
+    // objects persisted by the commands of a batch, reported together
+    bool _inBatch = false;
+    mutex _batchLock;
+    vector<string> _batchCompleted;
+    void runCommand(AGCommand* agCmd);
+    void reportCompletion();
+
+    // priority lanes, shared by all workers of an agent
+    static mutex _laneLock;
+    static int _laneInflight[AG_PRIO_NUM];
+    static int _laneCredit[AG_PRIO_NUM];
+
+    // bandwidth observed when fetching from each remote agent, in bytes per second
+    static mutex _linkBwLock;
+    static unordered_map<unsigned int, double> _linkBw;
+    static set<unsigned int> _linkBwDirty;
+
+    // runners of commands that wait on other agents, idle ones are reused
+    static mutex _runnerLock;
+    static vector<OECWorker*> _idleRunners;
+    OECWorker(Config* conf, UnderFS* underfs);
+    // run agCmd on a runner thread, which deletes agCmd
+    void startRunner(AGCommand* agCmd);
+
+    vector<string> laneOrder();
+    static bool waitsOnAgents(int type);
+    // only commands that do not wait on other agents count against the limit
+    // of a lane
+    bool acquireLane(AGCommand* agCmd);
+    void releaseLane(AGCommand* agCmd);
   public:
     OECWorker(Config* conf);
     ~OECWorker();
@@ -38,10 +77,14 @@ class OECWorker {
     void clientRead(AGCommand* agCmd);
     void onlineWrite(string filename, string ecid, int filesizeMB);
     void offlineWrite(string filename, string ecpoolid, int filesizeMB);
-    void readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw);
+    // stripes of online encoding span all objs, so the whole file is read
+    // and only the packets covering [offset, offset+length) are cached if length >= 0
+    void readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw, long offset = 0, long length = -1);
     void readOffline(string filename, int filesizeMB, int objnum);
-    void readOffline(string filename, int filesizeMB, vector<string> objlist); // read offline with objlist
-    void readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx);
+    // read offline with objlist, only the packets covering [offset, offset+length) if length >= 0
+    void readOffline(string filename, int filesizeMB, vector<string> objlist, long offset = 0, long length = -1);
+    // packets [startpkt, startpkt+rangenum) of the obj, all packets if rangenum < 0
+    void readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx, int startpkt = 0, int rangenum = -1);
 
     // load data from redis
     void loadWorker(BlockingQueue<OECDataPacket*>* readQueue,
@@ -58,6 +101,22 @@ class OECWorker {
                        int ecn,
                        int eck,
                        int ecw);
+    // one region op of an encode plan, tasks sharing children are merged into more rows
+    struct EncodeOp {
+      vector<int> children;
+      vector<int> targets;
+      vector<int> matrix;  // targets.size() x children.size(), row-major
+    };
+    vector<EncodeOp> compileEncode(vector<ECTask*> computeTasks);
+    // encode stripes of an online write with a compiled plan, the time spent
+    // in computation is added to computeMs
+    void encodeWorker(vector<EncodeOp>* ops,
+                      BlockingQueue<OECDataPacket**>* inQueue,
+                      BlockingQueue<OECDataPacket**>* outQueue,
+                      int stripenum,
+                      int ecn,
+                      int ecw,
+                      double* computeMs);
     void computeWorker(FSObjInputStream** readStreams,
                               vector<int> idlist,
                               BlockingQueue<OECDataPacket*>* writeQueue,
@@ -82,10 +141,19 @@ class OECWorker {
     void fetchCompute(AGCommand* agCmd);
     void persist(AGCommand* agCmd);
     void readFetchCompute(AGCommand* agCmd);
+    void batch(AGCommand* agCmd);
 
     // for Shortening
     void readDiskForShortening(AGCommand* agCmd);
 
+    // for throttling
+    void setThrottle(AGCommand* agCmd);
+    void reportThrottle(AGCommand* agCmd);
+
+    // for aggregation planning on the coordinator
+    void observeLinkBw(unsigned int src, double bw);
+    void reportLinkBw();
+
     void selectCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
                            int pktnum,
                            string keybase,
@@ -138,6 +206,12 @@ class OECWorker {
                      int step,
                      int num,
                      int refs);
+    // num packets of writeQueue, only those in [firstpkt, lastpkt] are cached as keybase:pktidx
+    void rangeCacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
+                          string keybase,
+                          int num,
+                          int firstpkt,
+                          int lastpkt);
 
 //    void offlineWrite(AGCommand* agCmd);
 //    void clientRead(AGCommand* agCmd);
@@ -0,0 +1,302 @@
+#include "PlanAnalyzer.hh"
+
+static string toMB(long bytes) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.2f", bytes / 1048576.0);
+  return string(buf);
+}
+
+long PlanCost::totalRead() {
+  long toret = 0;
+  for (auto item: _readBytes) toret += item.second;
+  return toret;
+}
+
+long PlanCost::totalNetwork() {
+  long toret = 0;
+  for (auto item: _linkBytes) toret += item.second;
+  return toret;
+}
+
+string PlanCost::dump() {
+  if (!_decodable) return _name + ": not decodable\n";
+  int runs = 0;
+  for (auto item: _readRuns) runs += item.second;
+  char ratio[32] = "";
+  if (_dataBytes > 0) snprintf(ratio, sizeof(ratio), " (%.3f of data)", (double)totalRead() / _dataBytes);
+  string toret = _name + ": read " + toMB(totalRead()) + " MB" + ratio + " in " + to_string(runs) + " runs, "
+               + "network " + toMB(totalNetwork()) + " MB, "
+               + "compute " + toMB(_computeBytes) + " MB, "
+               + "peak memory " + toMB(_peakMemory) + " MB\n";
+
+  map<int, long> readBytes(_readBytes.begin(), _readBytes.end());
+  toret += "  read MB(runs) per obj:";
+  for (auto item: readBytes) toret += " " + to_string(item.first) + ":" + toMB(item.second) + "(" + to_string(_readRuns[item.first]) + ")";
+  toret += "\n";
+  toret += "  network MB per link:";
+  for (auto item: _linkBytes) {
+    toret += " " + RedisUtil::ip2Str(item.first.first) + "->" + RedisUtil::ip2Str(item.first.second) + ":" + toMB(item.second);
+  }
+  toret += "\n";
+  return toret;
+}
+
+PlanAnalyzer::PlanAnalyzer(Config* conf, ECPolicy* ecpolicy, int objsizeMB, StripeStore* ss) {
+  _conf = conf;
+  _ecpolicy = ecpolicy;
+  _stripeStore = ss;
+  _n = ecpolicy->getN();
+  _k = ecpolicy->getK();
+  _w = ecpolicy->getW();
+  _objBytes = (long)objsizeMB * 1048576;
+
+  // objs of the stripe are placed in order with their groups, as the
+  // coordinator places the objs of a file and the parity objs of a stripe
+  vector<vector<int>> group;
+  _ecpolicy->getECClass()->Place(group);
+  unordered_map<int, vector<int>> idx2group;
+  for (auto item: group) {
+    for (auto idx: item) idx2group.insert(make_pair(idx, item));
+  }
+  vector<unsigned int> placedIps;
+  vector<int> placedIdx;
+  for (int i=0; i<_n; i++) {
+    vector<int> colocWith;
+    if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
+    vector<unsigned int> candidates = PlanBuilder::candidates(_conf, placedIps, placedIdx, colocWith);
+    // fewer agents than objs, the obj shares an agent
+    if (candidates.size() == 0) candidates.push_back(_conf->_agentsIPs[i % _conf->_agentsIPs.size()]);
+    unsigned int loc = choose(candidates, "data");
+    placedIps.push_back(loc);
+    placedIdx.push_back(i);
+    _sid2ip.insert(make_pair(i, loc));
+  }
+}
+
+unsigned int PlanAnalyzer::choose(vector<unsigned int> candidates, string type) {
+  // balance policy of the coordinator, on the load of the stripestore and
+  // the load planned so far
+  assert(candidates.size() > 0);
+  unsigned int toret = 0;
+  int minload = 0;
+  for (auto ip: candidates) {
+    int load = _load[type][ip];
+    if (_stripeStore && type == "data") load += _stripeStore->getDataLoad(ip);
+    else if (_stripeStore && type == "encode") load += _stripeStore->getEncodeLoad(ip);
+    else if (_stripeStore && type == "repair") load += _stripeStore->getRepairLoad(ip);
+    if (toret == 0 || load < minload) {
+      toret = ip;
+      minload = load;
+    }
+  }
+  _load[type][toret]++;
+  return toret;
+}
+
+PlanCost PlanAnalyzer::encode() {
+  ECBase* ec = _ecpolicy->getECClass();
+  int pktnum = _objBytes / _conf->_pktSize;
+  unordered_map<int, unsigned int> cid2ip;
+  auto choosefn = [&](vector<unsigned int> candidates) { return choose(candidates, "encode"); };
+  ECDAG* ecdag = PlanBuilder::build(_conf, _ecpolicy, {}, {}, _sid2ip, pktnum, {}, choosefn, cid2ip);
+
+  PlanCost toret = analyze("encode", ec, ecdag, cid2ip, _sid2ip);
+  delete ecdag;
+  return toret;
+}
+
+PlanCost PlanAnalyzer::repair(vector<int> lostidx) {
+  ECBase* ec = _ecpolicy->getECClass();
+
+  // 1. lost objs move as recoveryOffline relocates them: with their group,
+  // away from the other objs of the stripe
+  vector<vector<int>> group;
+  ec->Place(group);
+  unordered_map<int, vector<int>> idx2group;
+  for (auto item: group) {
+    for (auto idx: item) idx2group.insert(make_pair(idx, item));
+  }
+  unordered_map<int, unsigned int> sid2ip = _sid2ip;
+  vector<unsigned int> placedIps;
+  vector<int> placedIdx;
+  vector<double> nodecost;
+  for (int i=0; i<_n; i++) {
+    if (find(lostidx.begin(), lostidx.end(), i) == lostidx.end()) {
+      placedIps.push_back(_sid2ip[i]);
+      placedIdx.push_back(i);
+      nodecost.push_back(_stripeStore ? _stripeStore->getNodeCost(_sid2ip[i]) : 0);
+      continue;
+    }
+    nodecost.push_back(0);
+    vector<int> colocWith;
+    if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
+    vector<unsigned int> candidates = PlanBuilder::candidates(_conf, placedIps, placedIdx, colocWith);
+    for (int j=i+1; j<_n; j++) {
+      if (find(lostidx.begin(), lostidx.end(), j) != lostidx.end()) continue;
+      vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), _sid2ip[j]);
+      if (position != candidates.end()) candidates.erase(position);
+    }
+    // no spare agent, the obj is repaired in place
+    unsigned int loc = candidates.size() ? choose(candidates, "repair") : _sid2ip[i];
+    placedIps.push_back(loc);
+    placedIdx.push_back(i);
+    sid2ip[i] = loc;
+  }
+  if (!_stripeStore) nodecost.clear();
+
+  // 2. the plan of the coordinator
+  int pktnum = _objBytes / _conf->_pktSize;
+  unordered_map<int, unsigned int> cid2ip;
+  auto choosefn = [&](vector<unsigned int> candidates) { return choose(candidates, "repair"); };
+  ECDAG* ecdag = PlanBuilder::build(_conf, _ecpolicy, lostidx, nodecost, sid2ip, pktnum, {}, choosefn, cid2ip);
+
+  string name = "repair";
+  for (int i=0; i<lostidx.size(); i++) name += (i ? "," : " ") + to_string(lostidx[i]);
+  if (ecdag == NULL) {
+    PlanCost toret;
+    toret._name = name;
+    toret._decodable = false;
+    return toret;
+  }
+  PlanCost toret = analyze(name, ec, ecdag, cid2ip, sid2ip);
+  delete ecdag;
+  return toret;
+}
+
+PlanCost PlanAnalyzer::analyze(string name,
+                               ECBase* ec,
+                               ECDAG* ecdag,
+                               unordered_map<int, unsigned int> cid2ip,
+                               unordered_map<int, unsigned int> sid2ip) {
+  PlanCost toret;
+  toret._name = name;
+  toret._dataBytes = _k * _objBytes;
+  long symBytes = _objBytes / _w;
+  long pktBytes = _conf->_pktSize / _w;
+
+  // 0. stripe idx and offset in the object of each symbol
+  unordered_map<int, pair<int, int>> cid2off;
+  vector<vector<int>> layout = ec->GetLayout();
+  for (int sp=0; sp<layout.size(); sp++) {
+    for (int i=0; i<layout[sp].size(); i++) cid2off[layout[sp][i]] = make_pair(i, sp);
+  }
+  for (int cidx=0; cidx<_n*_w; cidx++) {
+    if (cid2off.find(cidx) == cid2off.end()) cid2off[cidx] = make_pair(cidx/_w, cidx%_w);
+  }
+
+  // 1. disk reads, symbols beyond the stripe are virtual and never read
+  unordered_map<int, vector<int>> offsets;
+  for (auto cidx: ecdag->getLeaves()) {
+    if (cidx >= _n*_w) continue;
+    int sid = cid2off[cidx].first;
+    toret._readBytes[sid] += symBytes;
+    offsets[sid].push_back(cid2off[cidx].second);
+  }
+  for (auto item: offsets) {
+    vector<int> off = item.second;
+    sort(off.begin(), off.end());
+    int runs = 0;
+    for (int i=0; i<off.size(); i++) {
+      if (i == 0 || off[i] != off[i-1] + 1) runs++;
+    }
+    toret._readRuns[item.first] = runs;
+  }
+
+  // 2. transfers and computation, each value is fetched once by an agent
+  vector<int> toposeq = ecdag->toposort();
+  auto ipOf = [&](int cidx, unsigned int consumer) -> unsigned int {
+    if (cid2ip.find(cidx) != cid2ip.end()) return cid2ip[cidx];
+    if (cidx < _n*_w) return sid2ip[cid2off[cidx].first];
+    return consumer;
+  };
+  // a value is held by its agent until its consumers there and the agents
+  // fetching it are done, a fetched copy until its consumers there are done
+  map<pair<int, unsigned int>, int> uses;
+  set<pair<int, unsigned int>> fetched;
+  for (auto cidx: toposeq) {
+    ECNode* node = ecdag->getNode(cidx);
+    if (node->getChildNum() == 0) continue;
+    unsigned int ip = ipOf(cidx, 0);
+    for (auto child: node->getChildren()) {
+      int childid = child->getNodeId();
+      unsigned int childip = ipOf(childid, ip);
+      uses[make_pair(childid, ip)]++;
+      if (childip == ip || fetched.count(make_pair(childid, ip))) continue;
+      fetched.insert(make_pair(childid, ip));
+      uses[make_pair(childid, childip)]++;
+    }
+  }
+
+  unordered_map<unsigned int, long> live;
+  set<pair<int, unsigned int>> held;
+  auto hold = [&](int cidx, unsigned int ip) {
+    if (held.count(make_pair(cidx, ip))) return;
+    held.insert(make_pair(cidx, ip));
+    live[ip] += pktBytes;
+    toret._peakMemory = max(toret._peakMemory, live[ip]);
+  };
+  auto release = [&](int cidx, unsigned int ip) {
+    if (--uses[make_pair(cidx, ip)] == 0 && held.count(make_pair(cidx, ip))) live[ip] -= pktBytes;
+  };
+  fetched.clear();
+  for (auto cidx: toposeq) {
+    ECNode* node = ecdag->getNode(cidx);
+    unsigned int ip = ipOf(cidx, 0);
+    if (node->getChildNum() == 0) {
+      // read from disk, or a zero symbol beyond the stripe
+      hold(cidx, ip);
+      continue;
+    }
+    for (auto child: node->getChildren()) {
+      int childid = child->getNodeId();
+      unsigned int childip = ipOf(childid, ip);
+      if (childip == ip || fetched.count(make_pair(childid, ip))) continue;
+      fetched.insert(make_pair(childid, ip));
+      toret._linkBytes[make_pair(childip, ip)] += symBytes;
+      hold(childid, ip);
+      release(childid, childip);
+    }
+    // a single coefficient 1 only forwards a bound value
+    for (auto item: node->getCoefmap()) {
+      vector<int> coefs = item.second;
+      if (coefs.size() == 1 && coefs[0] == 1) continue;
+      toret._computeBytes += coefs.size() * symBytes;
+    }
+    hold(cidx, ip);
+    for (auto child: node->getChildren()) release(child->getNodeId(), ip);
+  }
+
+  // 3. outputs are persisted on the agent of their object
+  for (auto cidx: ecdag->getHeaders()) {
+    if (cidx >= _n*_w || cid2ip.find(cidx) == cid2ip.end()) continue;
+    unsigned int dst = sid2ip[cid2off[cidx].first];
+    if (cid2ip[cidx] != dst) toret._linkBytes[make_pair(cid2ip[cidx], dst)] += symBytes;
+  }
+
+  return toret;
+}
+
+vector<PlanCost> PlanAnalyzer::analyzeAll(vector<vector<int>> multilost) {
+  vector<PlanCost> toret;
+  toret.push_back(encode());
+  for (int i=0; i<_n; i++) toret.push_back(repair({i}));
+  for (auto lostidx: multilost) toret.push_back(repair(lostidx));
+  return toret;
+}
+
+vector<vector<int>> PlanAnalyzer::lostPatterns(int num) {
+  vector<vector<int>> toret;
+  if (num < 1 || num > _n) return toret;
+  vector<int> lostidx;
+  for (int i=0; i<num; i++) lostidx.push_back(i);
+  while (true) {
+    toret.push_back(lostidx);
+    // next combination, the rightmost idx that can still move
+    int i = num - 1;
+    while (i >= 0 && lostidx[i] == _n - num + i) i--;
+    if (i < 0) break;
+    lostidx[i]++;
+    for (int j=i+1; j<num; j++) lostidx[j] = lostidx[j-1] + 1;
+  }
+  return toret;
+}
@@ -0,0 +1,73 @@
+#ifndef _PLANANALYZER_HH_
+#define _PLANANALYZER_HH_
+
+#include "Config.hh"
+#include "PlanBuilder.hh"
+#include "StripeStore.hh"
+
+#include "../ec/ECBase.hh"
+#include "../ec/ECDAG.hh"
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+/**
+ * Cost of one encode or repair plan of a stripe, per stripe of objects of
+ * the given size.
+ */
+class PlanCost {
+  public:
+    string _name;
+    unordered_map<int, long> _readBytes;  // stripe idx -> bytes read from disk
+    unordered_map<int, int> _readRuns;  // stripe idx -> discontiguous runs read
+    map<pair<unsigned int, unsigned int>, long> _linkBytes;  // src, dst -> bytes sent
+    long _computeBytes = 0;  // bytes multiplied and added by all agents
+    long _peakMemory = 0;  // max bytes an agent holds at once per packet, in topological order
+    long _dataBytes = 0;  // bytes of the k data objs, the read of a conventional repair
+    bool _decodable = true;  // false if the code does not decode the lost objs
+
+    long totalRead();
+    long totalNetwork();
+    string dump();
+};
+
+/**
+ * Builds the plans of an ec policy with the PlanBuilder of the coordinator,
+ * without touching any data. The objs of the stripe and the new locations
+ * of lost objs are placed among the agents of the config as the
+ * coordinator places them, by the balance policy on the load planned so
+ * far. With a stripestore its loads are added, and repairs weigh helpers
+ * by their node cost.
+ */
+class PlanAnalyzer {
+  private:
+    Config* _conf;
+    ECPolicy* _ecpolicy;
+    StripeStore* _stripeStore;
+    int _n, _k, _w;
+    long _objBytes;
+
+    unordered_map<int, unsigned int> _sid2ip;  // placement of the stripe
+    unordered_map<string, unordered_map<unsigned int, int>> _load;  // data/encode/repair -> ip -> planned
+
+    unsigned int choose(vector<unsigned int> candidates, string type);
+    PlanCost analyze(string name,
+                     ECBase* ec,
+                     ECDAG* ecdag,
+                     unordered_map<int, unsigned int> cid2ip,
+                     unordered_map<int, unsigned int> sid2ip);
+
+  public:
+    PlanAnalyzer(Config* conf, ECPolicy* ecpolicy, int objsizeMB, StripeStore* ss = NULL);
+
+    PlanCost encode();
+    PlanCost repair(vector<int> lostidx);
+    // encode, every single-node repair and the given multi-node repairs
+    vector<PlanCost> analyzeAll(vector<vector<int>> multilost);
+    // every pattern of num lost objs of the stripe, in lexicographic order
+    vector<vector<int>> lostPatterns(int num);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "PlanBuilder.hh"
+
+ECDAG* PlanBuilder::build(Config* conf,
+                          ECPolicy* ecpolicy,
+                          vector<int> lostidx,
+                          vector<double> nodecost,
+                          unordered_map<int, unsigned int> sid2ip,
+                          int pktnum,
+                          unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw,
+                          function<unsigned int(vector<unsigned int>)> choose,
+                          unordered_map<int, unsigned int>& cid2ip) {
+  ECBase* ec = ecpolicy->getECClass();
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  bool locality = ecpolicy->getLocality();
+  int opt = ecpolicy->getOpt();
+
+  // 1. encode or decode ecdag
+  ECDAG* ecdag;
+  vector<int> availcidx;
+  vector<int> toreccidx;
+  if (lostidx.size() == 0) {
+    ecdag = ec->Encode();
+  } else {
+    for (int i=0; i<n; i++) {
+      bool lost = find(lostidx.begin(), lostidx.end(), i) != lostidx.end();
+      for (int j=0; j<w; j++) {
+        if (lost) toreccidx.push_back(i*w+j);
+        else availcidx.push_back(i*w+j);
+      }
+    }
+    ec->SetNodeCost(nodecost);
+    ecdag = ec->Decode(availcidx, toreccidx);
+    if (ecdag == NULL) return NULL;
+  }
+  ecdag->reconstruct(opt);
+
+  // 2. place computation in topological order
+  vector<int> toposeq = ecdag->toposort();
+  for (auto cidx: toposeq) {
+    ECNode* node = ecdag->getNode(cidx);
+    vector<unsigned int> candidates;
+    if (lostidx.size() == 1) candidates = node->candidateIps(sid2ip, cid2ip, conf->_agentsIPs, n, k, w, locality, lostidx[0]);
+    else candidates = node->candidateIps(sid2ip, cid2ip, conf->_agentsIPs, n, k, w, locality);
+    unsigned int curip = choose(candidates);
+    // it's not a symbol of the stripe, fix the ip to the new location of the lost obj
+    if (lostidx.size() == 1 &&
+        find(toreccidx.begin(), toreccidx.end(), cidx) == toreccidx.end() &&
+        find(availcidx.begin(), availcidx.end(), cidx) == availcidx.end()) {
+      curip = sid2ip[lostidx[0]];
+    }
+    cid2ip.insert(make_pair(cidx, curip));
+  }
+
+  // 3. optimize
+  if (opt == 4) ecdag->setLinkBw(linkBw, conf->_linkBwInner*1048576, conf->_linkBwCross*1048576, conf->_pktSize, pktnum);
+  ecdag->optimize2(opt, cid2ip, conf->_ip2Rack, n, k, w, sid2ip, conf->_agentsIPs, locality);
+  return ecdag;
+}
+
+vector<unsigned int> PlanBuilder::candidates(Config* conf,
+                                             vector<unsigned int> placedIp,
+                                             vector<int> placedIdx,
+                                             vector<int> colocWith) {
+  vector<unsigned int> toret;
+  // 0. check colocWith
+  // candidate should be within the same rack
+  for (int i=0; i<colocWith.size(); i++) {
+    int curIdx = colocWith[i];
+    // check whether this idx has been placed
+    // if this idx has been placed
+    if (placedIp.size() > curIdx) {
+      // then figure out
+      unsigned int curIp = placedIp[curIdx];
+      // find corresponding rack for this ip
+      string rack = conf->_ip2Rack[curIp];
+      // for all the ip in this rack, if :
+      // 1> this ip is not in toret
+      // 2> this ip is not in placedId
+      for (auto item:conf->_rack2Ips[rack]) {
+        if (find(toret.begin(), toret.end(), item) == toret.end() &&
+            find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
+      }
+    }
+  }
+  // if there is no constraints in colocWith, we add all ips into toret except for placedIp
+  if (toret.size() == 0) {
+    for (auto item:conf->_agentsIPs) {
+      if (find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
+    }
+  }
+  return toret;
+}
@@ -0,0 +1,49 @@
+#ifndef _PLANBUILDER_HH_
+#define _PLANBUILDER_HH_
+
+#include "Config.hh"
+
+#include "../ec/ECBase.hh"
+#include "../ec/ECDAG.hh"
+#include "../ec/ECPolicy.hh"
+#include "../inc/include.hh"
+
+using namespace std;
+
+/**
+ * Plans of encoding and repairing a stripe, shared by the coordinator and
+ * the plan analyzer so that an analyzed plan is the one the coordinator
+ * sends:
+ *
+ * 1. Encode, or Decode of the lost objs with the node cost of the
+ *    helpers, then reconstruct(opt);
+ * 2. computation is placed in topological order among the candidateIps of
+ *    each node, the nodes a single repair adds stay on the new location of
+ *    the lost obj;
+ * 3. optimize2, for opt 4 on the given link bandwidth.
+ *
+ * choose picks one of the candidates of a node and accounts its load.
+ */
+class PlanBuilder {
+  public:
+    // lostidx is empty for encoding, sid2ip holds the new locations of lost
+    // objs. NULL if the code does not decode the lost objs
+    static ECDAG* build(Config* conf,
+                        ECPolicy* ecpolicy,
+                        vector<int> lostidx,
+                        vector<double> nodecost,
+                        unordered_map<int, unsigned int> sid2ip,
+                        int pktnum,
+                        unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw,
+                        function<unsigned int(vector<unsigned int>)> choose,
+                        unordered_map<int, unsigned int>& cid2ip);
+
+    // agents for a new obj of a stripe: in the racks of the placed objs of
+    // its group, otherwise any agent without a placed obj
+    static vector<unsigned int> candidates(Config* conf,
+                                           vector<unsigned int> placedIp,
+                                           vector<int> placedIdx,
+                                           vector<int> colocWith);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "PlanPool.hh"
+
+void PlanPool::push(CoorCommand* coorCmd) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  _lock.lock();
+  _queue.push_back(make_pair(coorCmd, now));
+  _lock.unlock();
+  _cv.notify_one();
+}
+
+void PlanPool::work(function<void(CoorCommand*)> plan) {
+  unique_lock<mutex> lk(_lock);
+  _threads++;
+  while (true) {
+    _cv.wait(lk, [&]{ return _queue.size() > 0; });
+    pair<CoorCommand*, struct timeval> item = _queue.front();
+    _queue.pop_front();
+    _running++;
+    lk.unlock();
+
+    struct timeval time1, time2;
+    gettimeofday(&time1, NULL);
+    plan(item.first);
+    delete item.first;
+    gettimeofday(&time2, NULL);
+
+    double waitMs = RedisUtil::duration(item.second, time1);
+    double runMs = RedisUtil::duration(time1, time2);
+    lk.lock();
+    _running--;
+    _done++;
+    _waitMs += waitMs;
+    _runMs += runMs;
+    _maxWaitMs = max(_maxWaitMs, waitMs);
+    _maxRunMs = max(_maxRunMs, runMs);
+    if (_done % 100 == 0) {
+      cout << "PlanPool::work queue = " << _queue.size() << ", running = " << _running
+           << ", avg wait = " << _waitMs / _done << " ms, avg plan = " << _runMs / _done << " ms" << endl;
+    }
+  }
+}
+
+string PlanPool::getStats() {
+  lock_guard<mutex> lk(_lock);
+  string stats = "planning threads " + to_string(_threads)
+               + ", queue " + to_string(_queue.size()) + ", running " + to_string(_running)
+               + ", done " + to_string(_done) + "\n";
+  if (_done) {
+    stats += "wait avg " + to_string(_waitMs / _done) + " ms, max " + to_string(_maxWaitMs) + " ms\n";
+    stats += "plan avg " + to_string(_runMs / _done) + " ms, max " + to_string(_maxRunMs) + " ms\n";
+  }
+  return stats;
+}
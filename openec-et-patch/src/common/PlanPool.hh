@@ -0,0 +1,36 @@
+#ifndef _PLANPOOL_HH_
+#define _PLANPOOL_HH_
+
+#include "../inc/include.hh"
+#include "../protocol/CoorCommand.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+/**
+ * Requests that build ecdags and placements, queued by all the coordinator
+ * instances that share a stripestore. The workers are started once, so
+ * the planning threads and their statistics cover all the instances.
+ */
+class PlanPool {
+  private:
+    mutex _lock;
+    condition_variable _cv;
+    deque<pair<CoorCommand*, struct timeval>> _queue;
+    int _threads = 0;
+    int _running = 0;
+    long _done = 0;
+    double _waitMs = 0;
+    double _maxWaitMs = 0;
+    double _runMs = 0;
+    double _maxRunMs = 0;
+
+  public:
+    // the pool deletes coorCmd once it is planned
+    void push(CoorCommand* coorCmd);
+    // plan the queued requests on the calling thread, never returns
+    void work(function<void(CoorCommand*)> plan);
+    string getStats();
+};
+
+#endif
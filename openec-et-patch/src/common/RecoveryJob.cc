@@ -0,0 +1,175 @@
+#include "RecoveryJob.hh"
+
+RecoveryJob::RecoveryJob(unsigned int failedIp, vector<unsigned int> agents) {
+  _failedIp = failedIp;
+  for (auto ip: agents) {
+    if (ip != failedIp) _agents.push_back(ip);
+  }
+  gettimeofday(&_start, NULL);
+}
+
+void RecoveryJob::addStripe(string lostobj,
+                            vector<unsigned int> stripeIps,
+                            unordered_map<unsigned int, long> helperBytes) {
+  lock_guard<mutex> lk(_lock);
+  if (_helperBytes.find(lostobj) != _helperBytes.end()) return;
+  _pending.push_back(lostobj);
+  _helperBytes.insert(make_pair(lostobj, helperBytes));
+  _stripeIps.insert(make_pair(lostobj, stripeIps));
+  _total++;
+  _totalBytes += repairBytes(lostobj);
+}
+
+long RecoveryJob::repairBytes(string lostobj) {
+  long toret = 0;
+  for (auto item: _helperBytes[lostobj]) toret += item.second;
+  return toret;
+}
+
+unsigned int RecoveryJob::chooseDest(string lostobj, long& destload) {
+  // the destination must not hold another object of the stripe
+  vector<unsigned int>& stripeIps = _stripeIps[lostobj];
+  unsigned int toret = 0;
+  destload = -1;
+  for (auto ip: _agents) {
+    if (find(stripeIps.begin(), stripeIps.end(), ip) != stripeIps.end()) continue;
+    long load = _readLoad[ip] + _recvLoad[ip];
+    if (destload < 0 || load < destload) {
+      destload = load;
+      toret = ip;
+    }
+  }
+  return toret;
+}
+
+string RecoveryJob::next() {
+  lock_guard<mutex> lk(_lock);
+
+  // 1. among the first stripes in the queue, find the one whose busiest
+  //    agent (a helper or the destination) ends up with the least load
+  int bestidx = -1;
+  long bestcost = -1;
+  unsigned int bestdest = 0;
+  int failed = 0;
+  for (int i=0; i<min((int)_pending.size(), RECOVERY_WINDOW); i++) {
+    string lostobj = _pending[i];
+    long destload;
+    unsigned int dest = chooseDest(lostobj, destload);
+    if (dest == 0) {
+      // every surviving agent holds an obj of the stripe, finished repairs
+      // do not change that, so the stripe fails
+      cout << "RecoveryJob::next no destination for " << lostobj << ", it fails" << endl;
+      _pending.erase(_pending.begin() + i);
+      _failed++;
+      failed++;
+      i--;
+      continue;
+    }
+    long cost = 0;
+    for (auto item: _helperBytes[lostobj]) {
+      cost = max(cost, _readLoad[item.first] + _recvLoad[item.first] + item.second);
+    }
+    cost = max(cost, destload + repairBytes(lostobj));
+    if (bestidx == -1 || cost < bestcost) {
+      bestidx = i;
+      bestcost = cost;
+      bestdest = dest;
+    }
+  }
+  if (failed > 0) logFinish();
+  if (bestidx == -1) return "";
+
+  // 2. reserve the load
+  string lostobj = _pending[bestidx];
+  _pending.erase(_pending.begin() + bestidx);
+  _inflight.insert(lostobj);
+  _dest[lostobj] = bestdest;
+  for (auto item: _helperBytes[lostobj]) _readLoad[item.first] += item.second;
+  _recvLoad[bestdest] += repairBytes(lostobj);
+  return lostobj;
+}
+
+unsigned int RecoveryJob::getDest(string lostobj) {
+  lock_guard<mutex> lk(_lock);
+  if (_dest.find(lostobj) == _dest.end()) return 0;
+  return _dest[lostobj];
+}
+
+bool RecoveryJob::contains(string lostobj) {
+  lock_guard<mutex> lk(_lock);
+  return _helperBytes.find(lostobj) != _helperBytes.end();
+}
+
+bool RecoveryJob::hasPending() {
+  lock_guard<mutex> lk(_lock);
+  return !_pending.empty();
+}
+
+void RecoveryJob::release(string lostobj) {
+  _inflight.erase(lostobj);
+  for (auto item: _helperBytes[lostobj]) _readLoad[item.first] -= item.second;
+  _recvLoad[_dest[lostobj]] -= repairBytes(lostobj);
+}
+
+void RecoveryJob::logFinish() {
+  if (_done + _failed != _total) return;
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  cout << "RecoveryJob::finish recovery of " << RedisUtil::ip2Str(_failedIp) << " finishes, "
+       << _done << " of " << _total << " stripes repaired, " << _failed << " failed in "
+       << RedisUtil::duration(_start, now) << " ms" << endl;
+}
+
+void RecoveryJob::finish(string lostobj) {
+  lock_guard<mutex> lk(_lock);
+  if (_inflight.find(lostobj) == _inflight.end()) return;
+  release(lostobj);
+  _done++;
+  _doneBytes += repairBytes(lostobj);
+  logFinish();
+}
+
+void RecoveryJob::fail(string lostobj) {
+  lock_guard<mutex> lk(_lock);
+  if (_inflight.find(lostobj) == _inflight.end()) return;
+  release(lostobj);
+  _failed++;
+  logFinish();
+}
+
+bool RecoveryJob::finished() {
+  lock_guard<mutex> lk(_lock);
+  return _done + _failed == _total;
+}
+
+unsigned int RecoveryJob::getFailedIp() {
+  return _failedIp;
+}
+
+string RecoveryJob::progress() {
+  lock_guard<mutex> lk(_lock);
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  double elapsed = RedisUtil::duration(_start, now) / 1000;
+  double rate = elapsed > 0 ? _doneBytes / 1048576.0 / elapsed : 0;
+  string eta = "-";
+  if (_done + _failed == _total) eta = "0";
+  else if (_doneBytes > 0) eta = to_string((long)(elapsed * (_totalBytes - _doneBytes) / _doneBytes));
+
+  string toret = "recovery of " + RedisUtil::ip2Str(_failedIp) + ": "
+               + to_string(_done) + "/" + to_string(_total) + " stripes, " + to_string(_failed) + " failed, "
+               + to_string(_doneBytes/1048576) + "/" + to_string(_totalBytes/1048576) + " MB read, "
+               + to_string(_inflight.size()) + " in progress, "
+               + to_string((long)rate) + " MB/s, eta " + eta + " s\n";
+  // outstanding load of the busiest agents tells whether the job is balanced
+  long maxload = 0;
+  long sumload = 0;
+  for (auto ip: _agents) {
+    long load = _readLoad[ip] + _recvLoad[ip];
+    maxload = max(maxload, load);
+    sumload += load;
+  }
+  long avgload = _agents.size() ? sumload / _agents.size() : 0;
+  toret += "outstanding MB per agent: max " + to_string(maxload/1048576) + ", avg " + to_string(avgload/1048576) + "\n";
+  return toret;
+}
@@ -0,0 +1,71 @@
+#ifndef _RECOVERYJOB_HH_
+#define _RECOVERYJOB_HH_
+
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+using namespace std;
+
+// number of pending stripes examined for each scheduling decision
+#define RECOVERY_WINDOW 128
+
+/**
+ * Recovery of all the objects of a failed agent. Each lost object is
+ * scheduled with the bytes its repair reads from every helper, and the
+ * next one to dispatch is the one that keeps the outstanding disk and
+ * network load of the surviving agents the most even.
+ */
+class RecoveryJob {
+  private:
+    unsigned int _failedIp;
+    vector<unsigned int> _agents;  // surviving agents, candidates for destination
+    mutex _lock;
+
+    // stripes to repair, identified by the lost object
+    deque<string> _pending;
+    set<string> _inflight;
+    unordered_map<string, unordered_map<unsigned int, long>> _helperBytes; // lostobj -> helper -> bytes read
+    unordered_map<string, vector<unsigned int>> _stripeIps;  // lostobj -> agents that hold the stripe
+    unordered_map<string, unsigned int> _dest;  // lostobj -> destination reserved at dispatch
+
+    // outstanding bytes of dispatched repairs on each agent
+    unordered_map<unsigned int, long> _readLoad;  // read from disk and sent
+    unordered_map<unsigned int, long> _recvLoad;  // received and written by the destination
+
+    // progress
+    int _total = 0;
+    int _done = 0;
+    int _failed = 0;  // stripes whose repair cannot be planned or has no destination
+    long _totalBytes = 0;
+    long _doneBytes = 0;
+    struct timeval _start;
+
+    long repairBytes(string lostobj);
+    unsigned int chooseDest(string lostobj, long& destload);
+    // release the load of an inflight stripe, the caller holds the lock
+    void release(string lostobj);
+    void logFinish();
+
+  public:
+    RecoveryJob(unsigned int failedIp, vector<unsigned int> agents);
+
+    void addStripe(string lostobj, vector<unsigned int> stripeIps, unordered_map<unsigned int, long> helperBytes);
+    // pick the next stripe to repair and reserve its destination, "" if none is pending
+    string next();
+    // destination reserved for lostobj, 0 if lostobj is not part of this job
+    unsigned int getDest(string lostobj);
+    bool contains(string lostobj);
+    // there are pending stripes that can be scheduled now
+    bool hasPending();
+    void finish(string lostobj);
+    // the repair of lostobj failed, the job finishes without it
+    void fail(string lostobj);
+    // every stripe is repaired or failed
+    bool finished();
+
+    unsigned int getFailedIp();
+    // failed ip, stripes done/failed/total, bytes done/total, rate, eta and helper loads
+    string progress();
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "SSEntryIndex.hh"
+
+SSEntryIndex::SSEntryIndex(NameTable* names) {
+  _names = names;
+  for (int i=0; i<SSINDEX_SHARDS; i++) pthread_rwlock_init(&_shards[i].lock, NULL);
+}
+
+SSEntryIndex::~SSEntryIndex() {
+  for (int i=0; i<SSINDEX_SHARDS; i++) pthread_rwlock_destroy(&_shards[i].lock);
+}
+
+bool SSEntryIndex::insert(string name, SSEntry* entry) {
+  unsigned int id = _names->intern(name);
+  Shard& shard = _shards[id % SSINDEX_SHARDS];
+  pthread_rwlock_wrlock(&shard.lock);
+  bool toret = shard.entries.insert(make_pair(id, entry)).second;
+  pthread_rwlock_unlock(&shard.lock);
+  return toret;
+}
+
+SSEntry* SSEntryIndex::get(string name) {
+  unsigned int id;
+  if (!_names->lookup(name, id)) return NULL;
+  Shard& shard = _shards[id % SSINDEX_SHARDS];
+  SSEntry* toret = NULL;
+  pthread_rwlock_rdlock(&shard.lock);
+  unordered_map<unsigned int, SSEntry*>::iterator it = shard.entries.find(id);
+  if (it != shard.entries.end()) toret = it->second;
+  pthread_rwlock_unlock(&shard.lock);
+  return toret;
+}
+
+bool SSEntryIndex::erase(string name) {
+  unsigned int id;
+  if (!_names->lookup(name, id)) return false;
+  Shard& shard = _shards[id % SSINDEX_SHARDS];
+  pthread_rwlock_wrlock(&shard.lock);
+  bool toret = shard.entries.erase(id) > 0;
+  pthread_rwlock_unlock(&shard.lock);
+  return toret;
+}
+
+bool SSEntryIndex::exists(string name) {
+  return get(name) != NULL;
+}
+
+long SSEntryIndex::size() {
+  long toret = 0;
+  for (int i=0; i<SSINDEX_SHARDS; i++) {
+    pthread_rwlock_rdlock(&_shards[i].lock);
+    toret += _shards[i].entries.size();
+    pthread_rwlock_unlock(&_shards[i].lock);
+  }
+  return toret;
+}
+
+long SSEntryIndex::memoryBytes() {
+  long toret = 0;
+  for (int i=0; i<SSINDEX_SHARDS; i++) {
+    Shard& shard = _shards[i];
+    pthread_rwlock_rdlock(&shard.lock);
+    // hash node: next pointer, id and entry
+    long node = sizeof(void*) + sizeof(pair<const unsigned int, SSEntry*>);
+    toret += shard.entries.size() * node + shard.entries.bucket_count() * sizeof(void*);
+    pthread_rwlock_unlock(&shard.lock);
+  }
+  return toret;
+}
+
+void SSEntryIndex::forEach(function<void(string, SSEntry*)> visit) {
+  for (int i=0; i<SSINDEX_SHARDS; i++) {
+    pthread_rwlock_rdlock(&_shards[i].lock);
+    for (auto item: _shards[i].entries) visit(_names->name(item.first), item.second);
+    pthread_rwlock_unlock(&_shards[i].lock);
+  }
+}
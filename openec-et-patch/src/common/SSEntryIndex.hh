@@ -0,0 +1,47 @@
+#ifndef _SSENTRYINDEX_HH_
+#define _SSENTRYINDEX_HH_
+
+#include "NameTable.hh"
+#include "SSEntry.hh"
+
+#include "../inc/include.hh"
+
+#include <pthread.h>
+
+using namespace std;
+
+#define SSINDEX_SHARDS NAMETABLE_SHARDS
+
+/**
+ * Map from a file or object name to its SSEntry, keyed by the id of the
+ * name in a NameTable and partitioned into shards. Each shard has a
+ * reader-writer lock, so lookups of different names never contend and
+ * lookups of the same shard proceed in parallel.
+ */
+class SSEntryIndex {
+  private:
+    NameTable* _names;
+    struct Shard {
+      unordered_map<unsigned int, SSEntry*> entries;
+      pthread_rwlock_t lock;
+    };
+    Shard _shards[SSINDEX_SHARDS];
+
+  public:
+    SSEntryIndex(NameTable* names);
+    ~SSEntryIndex();
+
+    // insert name -> entry, return false if name already exists
+    bool insert(string name, SSEntry* entry);
+    SSEntry* get(string name);
+    // remove name, return false if it does not exist
+    bool erase(string name);
+    bool exists(string name);
+    long size();
+    // estimated heap bytes of the index, names are accounted by the NameTable
+    long memoryBytes();
+    // visit all the items, one shard under read lock at a time
+    void forEach(function<void(string, SSEntry*)> visit);
+};
+
+#endif
@@ -1,17 +1,22 @@
 #include "StripeStore.hh"
 
-StripeStore::StripeStore(Config* conf) {
+#include "ETTiering.hh"
+
+#include <unistd.h>
+
+StripeStore::StripeStore(Config* conf) : _ssEntryIndex(&_names), _objEntryIndex(&_names) {
   _conf = conf;
   // by default, encode scheduling is delayed
   _enableScan = false;
   _enableRepair = false;
+  _completion = new CompletionChannel(conf);
+  _tiering = new ETTiering(conf, this);
+  _planPool = new PlanPool();
 
 //   if (_conf->_repair_scheduling == "delay") _enableRepair = false;
 //   else if (_conf->_repair_scheduling == "threshold") _enableRepair = false;
 //   else _enableRepair = true;
 
-  // TODO: if metaStore exists, we need to load metadata into memory
-  //       if not, we need to create a metaStore 
   // check whether entryStore exists, and read data from entryStore
   ifstream entryStore(_entryStorePath);
   if (entryStore.is_open()) {
@@ -32,43 +37,36 @@ StripeStore::StripeStore(Config* conf) {
     string line;
     while (getline(poolStore, line)) {
       vector<string> entryitems = RedisUtil::str2container(line);
-      string ecpoolid = entryitems[0];
-      string ecid = _conf->_offlineECMap[ecpoolid];
-      int basesizeMB = _conf->_offlineECBase[ecpoolid];
-      ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-      OfflineECPool* ecpool = getECPool(ecpoolid, ecpolicy, basesizeMB);
-      ecpool->constructPool(entryitems);
+      loadStripeRecord(entryitems);
     }
     poolStore.close();
   }
+
+  // load the snapshot and replay the wal tail
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  _metaLog = new MetaLog("metaWal", "metaSnapshot");
+  long records = _metaLog->load([this](int type, string payload) { replayMeta(type, payload); });
+  gettimeofday(&time2, NULL);
+  cout << "StripeStore::load " << records << " metadata records in " << RedisUtil::duration(time1, time2) << " ms" << endl;
+}
+
+void StripeStore::replayMeta(int type, string payload) {
+  if (payload.length() && payload[payload.length()-1] == '\n') payload.pop_back();
+  if (type == METALOG_ENTRY) insertEntry(new SSEntry(payload));
+  else if (type == METALOG_POOL) loadStripeRecord(RedisUtil::str2container(payload));
+  else if (type == METALOG_UPDATE) loadUpdateRecord(payload);
 }
 
 bool StripeStore::existEntry(string filename) {
-  unordered_map<string, SSEntry*>::iterator it = _ssEntryMap.find(filename);
-  return it == _ssEntryMap.end() ? false:true;
+  return _ssEntryIndex.exists(filename);
 }
 
 void StripeStore::insertEntry(SSEntry* entry) {
-  unordered_map<string, SSEntry*>::iterator it = _ssEntryMap.find(entry->getFilename());
-  if (it == _ssEntryMap.end()) {
-    // the entry does not exist, insert this entry
-    _lockSSEntryMap.lock();
-    _ssEntryMap.insert(make_pair(entry->getFilename(), entry));
-    _lockSSEntryMap.unlock();
-
-    for (auto obj: entry->getObjlist()) {
-      _lockObjEntryMap.lock();
-      _objEntryMap.insert(make_pair(obj, entry));
-      _lockObjEntryMap.unlock();
-    }
-  } else {
-//     // the entry exist, only need to update the entry
-//     _lockSSEntryMap.lock();
-//     SSEntry* oldEntry = _ssEntryMap[entry->_filename];
-//     _ssEntryMap[entry->_filename] = entry;
-//     _lockSSEntryMap.unlock();
-//     // need to delete the old entry?
-//     delete oldEntry;
+  // an existing entry is kept
+  if (!_ssEntryIndex.insert(entry->getFilename(), entry)) return;
+  for (auto obj: entry->getObjlist()) {
+    _objEntryIndex.insert(obj, entry);
   }
 
   // TODO: add it to metaStore
@@ -77,14 +75,20 @@ void StripeStore::insertEntry(SSEntry* entry) {
 //  cout << "StripeStore::insertEntry.entrystr: " << entrystr << endl;
 }
 
+void StripeStore::removeEntry(string filename) {
+  SSEntry* entry = _ssEntryIndex.get(filename);
+  if (entry == NULL) return;
+  for (auto obj: entry->getObjlist()) _objEntryIndex.erase(obj);
+  _ssEntryIndex.erase(filename);
+  // lookups hand out the entry without a lock, so it is not freed
+}
+
 SSEntry* StripeStore::getEntry(string filename) {
-  if (existEntry(filename)) return _ssEntryMap[filename];
-  else return NULL;
+  return _ssEntryIndex.get(filename);
 }
 
 SSEntry* StripeStore::getEntryFromObj(string objname) {
-  if (_objEntryMap.find(objname) != _objEntryMap.end()) return _objEntryMap[objname];
-  else return NULL;
+  return _objEntryIndex.get(objname);
 }
 
 void StripeStore::insertECPool(string ecpoolid, OfflineECPool* pool) {
@@ -112,8 +116,9 @@ OfflineECPool* StripeStore::getECPool(string poolname) {
   _lockECPoolMap.lock();
   unordered_map<string, OfflineECPool*>::iterator it = _offlineECPoolMap.find(poolname);
   assert (it != _offlineECPoolMap.end());
+  toret = it->second;
   _lockECPoolMap.unlock();
-  return _offlineECPoolMap[poolname];
+  return toret;
 }
 
 int StripeStore::getControlLoad(unsigned int ip) {
@@ -189,43 +194,106 @@ void StripeStore::increaseEncodeLoadMap(unsigned int ip, int load) {
   _lockELMap.unlock();
 }
 
+double StripeStore::getNodeCost(unsigned int ip) {
+  return getDataLoad(ip) + getRepairLoad(ip) + getEncodeLoad(ip);
+}
+
 void StripeStore::setECStatus(int op, string ectype) {
   if (ectype == "encode") {
     if (op == 1) _enableScan = true;
     else _enableScan = false;
+    notifyEncode();
   } else if (ectype == "repair") {
     if (op == 1) _enableRepair = true;
     else _enableRepair = false;
+    notifyRepair();
   }
 }
 
+CompletionChannel* StripeStore::getCompletion() {
+  return _completion;
+}
+
+void StripeStore::notifyEncode() {
+  // take the lock so that a scheduler between its check and its wait sees the change
+  lock_guard<mutex> lk(_lockSchedule);
+  _encodeCv.notify_all();
+}
+
+void StripeStore::notifyRepair() {
+  lock_guard<mutex> lk(_lockSchedule);
+  _repairCv.notify_all();
+}
+
 // offline encoding
 void StripeStore::scanning() {
   int concurrentNum = _conf->_ec_concurrent;
   while(true) {
-    std::this_thread::sleep_for (std::chrono::seconds(1));
-    if (!_enableScan) continue;
-    // offline encoding is enabled
-    cout << "StripeStore::scanning the pendingECQueue" << endl;
+    // wait until encoding is enabled, a stripe is pending and a slot is free
+    {
+      unique_lock<mutex> lk(_lockSchedule);
+      _encodeCv.wait(lk, [&]{
+        lock_guard<mutex> clk(_lockPConvert);
+        return ((_enableScan && _pendingECQueue.getSize()) || _pendingConvert.size()) && getECInProgressNum() < concurrentNum;
+      });
+    }
     _lockPECQueue.lock();
     int ecInProgressNum = getECInProgressNum();
     cout << "StripeStore::pendingECQueue.size = " << _pendingECQueue.getSize() << ", ecInProgress = "  << ecInProgressNum << ", concurrentNum = " << concurrentNum << endl;
-    while (_pendingECQueue.getSize() && ecInProgressNum < concurrentNum) {
-      pair<string, string> curpair = _pendingECQueue.pop();
-      string ecpoolid = curpair.first;
-      string stripename = curpair.second;
-      startECStripe(stripename);     
+    while (_enableScan && _pendingECQueue.getSize() && ecInProgressNum < concurrentNum) {
+      // 1. take up to ec.batch.num stripes that fit in the free slots
+      int batchnum = min(_conf->_ec_batch, concurrentNum - ecInProgressNum);
+      vector<string> pools;
+      unordered_map<string, vector<string>> pool2stripes;
+      while (_pendingECQueue.getSize() && batchnum > 0) {
+        pair<string, string> curpair = _pendingECQueue.pop();
+        string ecpoolid = curpair.first;
+        string stripename = curpair.second;
+        startECStripe(stripename);
+        if (pool2stripes.find(ecpoolid) == pool2stripes.end()) pools.push_back(ecpoolid);
+        pool2stripes[ecpoolid].push_back(stripename);
+        batchnum--;
+      }
 
-      // send offline encode request to coordinator
-      CoorCommand* coorCmd = new CoorCommand();
-      coorCmd->buildType4(4, _conf->_localIp, ecpoolid, stripename);
-      coorCmd->sendTo(_conf->_coorIp);
-      delete coorCmd;
+      // 2. send offline encode request to coordinator, one per pool
+      for (auto ecpoolid: pools) {
+        vector<string>& stripenames = pool2stripes[ecpoolid];
+        CoorCommand* coorCmd = new CoorCommand();
+        if (stripenames.size() > 1) coorCmd->buildType19(19, _conf->_localIp, ecpoolid, stripenames);
+        else coorCmd->buildType4(4, _conf->_localIp, ecpoolid, stripenames[0]);
+        coorCmd->sendTo(_conf->_coorIp);
+        delete coorCmd;
+      }
 
       // obtain latest ecInProgress
       ecInProgressNum = getECInProgressNum();
     } 
     _lockPECQueue.unlock();
+
+    // 3. conversions take the free slots that encoding leaves, one request per stripe
+    while (ecInProgressNum < concurrentNum) {
+      _lockPConvert.lock();
+      if (_pendingConvert.size() == 0) {
+        _lockPConvert.unlock();
+        break;
+      }
+      pair<string, pair<string, string>> item = _pendingConvert.front();
+      _pendingConvert.pop_front();
+      _lockPConvert.unlock();
+      string ecid = item.first;
+      string ecpoolid = item.second.first;
+      string stripename = item.second.second;
+      // a stripe that is encoded, converted or updated meanwhile is skipped
+      if (!claimECStripe(stripename, 0)) {
+        cout << "StripeStore::scanning skip the conversion of " << stripename << " in progress" << endl;
+        continue;
+      }
+      CoorCommand* coorCmd = new CoorCommand();
+      coorCmd->buildType27(27, _conf->_localIp, ecpoolid, stripename, ecid);
+      coorCmd->sendTo(_conf->_coorIp);
+      delete coorCmd;
+      ecInProgressNum = getECInProgressNum();
+    }
   }
 }
 
@@ -233,6 +301,14 @@ void StripeStore::addEncodeCandidate(string ecpoolid, string stripename) {
   _lockPECQueue.lock();
   _pendingECQueue.push(make_pair(ecpoolid, stripename));
   _lockPECQueue.unlock();
+  notifyEncode();
+}
+
+void StripeStore::addConvertCandidate(string ecpoolid, string stripename, string ecid) {
+  _lockPConvert.lock();
+  _pendingConvert.push_back(make_pair(ecid, make_pair(ecpoolid, stripename)));
+  _lockPConvert.unlock();
+  notifyEncode();
 }
 
 int StripeStore::getECInProgressNum() {
@@ -246,22 +322,191 @@ int StripeStore::getECInProgressNum() {
 void StripeStore::startECStripe(string stripename) {
   _lockECInProgress.lock();
   if (_ECInProgress.size() == 0) gettimeofday(&_startEnc, NULL);
-  _ECInProgress.push_back(stripename);
+  _ECInProgress.insert(stripename);
   _lockECInProgress.unlock();
 }
 
-void StripeStore::finishECStripe(OfflineECPool* pool, string stripename) {
+bool StripeStore::claimECStripe(string stripename, int concurrentNum) {
+  unique_lock<mutex> lk(_lockSchedule);
+  if (concurrentNum > 0) _encodeCv.wait(lk, [&]{ return getECInProgressNum() < concurrentNum; });
+  lock_guard<mutex> ilk(_lockECInProgress);
+  if (_ECInProgress.find(stripename) != _ECInProgress.end()) return false;
+  if (_ECInProgress.size() == 0) gettimeofday(&_startEnc, NULL);
+  _ECInProgress.insert(stripename);
+  return true;
+}
+
+void StripeStore::finishECStripe(string ecpoolid, string stripename) {
   _lockECInProgress.lock();
-  vector<string>::iterator pos = find(_ECInProgress.begin(), _ECInProgress.end(), stripename);
-  if (pos != _ECInProgress.end()) _ECInProgress.erase(pos);
+  _ECInProgress.erase(stripename);
   if (_ECInProgress.size() == 0) {
     gettimeofday(&_endEnc, NULL);
     cout << "StripeStore::finishECStripe.encodeTime = " << RedisUtil::duration(_startEnc, _endEnc) << endl;
   }
   _lockECInProgress.unlock();
+  notifyEncode();
+
+  // we need to backup offlineecpool, the record also carries the parity locations
+  OfflineECPool* pool = getECPool(ecpoolid);
+  pool->lock();
+  string poolstr = stripeRecord(ecpoolid, pool, stripename);
+  pool->unlock();
+  backupPoolStripe(poolstr);
+}
 
-  // we need to backup offlineecpool
-  backupPoolStripe(pool->stripe2String(stripename));
+vector<string> StripeStore::convertStripe(string ecpoolid, string stripename, string ecid, vector<string> objlist) {
+  int k = _conf->_ecPolicyMap[ecid]->getK();
+  unsigned int stripeid = _names.intern(stripename);
+  ConvertedStripe converted;
+  converted.ecid = _names.intern(ecid);
+  for (auto obj: objlist) converted.objs.push_back(_names.intern(obj));
+  vector<string> previous;
+  _lockConverted.lock();
+  auto it = _convertedStripes.find(stripeid);
+  if (it != _convertedStripes.end()) {
+    for (auto id: it->second.objs) {
+      previous.push_back(_names.name(id));
+      _convertedObjs.erase(id);
+    }
+  } else {
+    // parity objs of the stripe as it was encoded
+    ECPolicy* ecpolicy = getECPool(ecpoolid)->getEcpolicy();
+    previous.resize(ecpolicy->getK());
+    for (int i=ecpolicy->getK(); i<ecpolicy->getN(); i++) previous.push_back("/"+ecpoolid+"-"+stripename+"-"+to_string(i));
+  }
+  _convertedStripes[stripeid] = converted;
+  for (int i=k; i<converted.objs.size(); i++) _convertedObjs[converted.objs[i]] = stripeid;
+  _lockConverted.unlock();
+
+  // parity objs that are no longer in the stripe, data objs always stay
+  vector<string> toret;
+  for (int i=k; i<previous.size(); i++) {
+    if (find(objlist.begin(), objlist.end(), previous[i]) != objlist.end()) continue;
+    removeEntry(previous[i]);
+    toret.push_back(previous[i]);
+  }
+  return toret;
+}
+
+ECPolicy* StripeStore::getStripePolicy(OfflineECPool* ecpool, string stripename) {
+  ECPolicy* toret = ecpool->getEcpolicy();
+  unsigned int stripeid;
+  if (!_names.lookup(stripename, stripeid)) return toret;
+  _lockConverted.lock();
+  auto it = _convertedStripes.find(stripeid);
+  if (it != _convertedStripes.end()) toret = _conf->_ecPolicyMap[_names.name(it->second.ecid)];
+  _lockConverted.unlock();
+  return toret;
+}
+
+vector<string> StripeStore::getStripeObjs(OfflineECPool* ecpool, string stripename) {
+  unsigned int stripeid;
+  if (!_names.lookup(stripename, stripeid)) return ecpool->getStripeObjList(stripename);
+  _lockConverted.lock();
+  auto it = _convertedStripes.find(stripeid);
+  if (it != _convertedStripes.end()) {
+    vector<string> toret;
+    for (auto id: it->second.objs) toret.push_back(_names.name(id));
+    _lockConverted.unlock();
+    return toret;
+  }
+  _lockConverted.unlock();
+  return ecpool->getStripeObjList(stripename);
+}
+
+string StripeStore::getStripeForObj(OfflineECPool* ecpool, string objname) {
+  unsigned int objid;
+  if (!_names.lookup(objname, objid)) return ecpool->getStripeForObj(objname);
+  _lockConverted.lock();
+  auto it = _convertedObjs.find(objid);
+  if (it != _convertedObjs.end()) {
+    unsigned int stripeid = it->second;
+    _lockConverted.unlock();
+    return _names.name(stripeid);
+  }
+  _lockConverted.unlock();
+  return ecpool->getStripeForObj(objname);
+}
+
+vector<string> StripeStore::commitUpdate(string ecpoolid, string stripename, string ecid, vector<string> objlist,
+                                         string objname, string stagedname) {
+  vector<string> toret = convertStripe(ecpoolid, stripename, ecid, objlist);
+  OfflineECPool* ecpool = getECPool(ecpoolid);
+  ecpool->lock();
+  string record = stripeRecord(ecpoolid, ecpool, stripename);
+  ecpool->unlock();
+  _lockPendingUpdates.lock();
+  _pendingUpdates[objname] = stagedname;
+  _lockPendingUpdates.unlock();
+  if (!_metaLog->append(METALOG_UPDATE, objname + ";" + stagedname + ";" + record)) {
+    cerr << "StripeStore::commitUpdate fail to log the update of " << objname << endl;
+  }
+  return toret;
+}
+
+void StripeStore::finishUpdate(string objname) {
+  _lockPendingUpdates.lock();
+  _pendingUpdates.erase(objname);
+  _lockPendingUpdates.unlock();
+  if (!_metaLog->append(METALOG_UPDATE, objname + ";;")) {
+    cerr << "StripeStore::finishUpdate fail to log the update of " << objname << endl;
+  }
+}
+
+unordered_map<string, string> StripeStore::getPendingUpdates() {
+  lock_guard<mutex> lk(_lockPendingUpdates);
+  return _pendingUpdates;
+}
+
+bool StripeStore::claimTask(string task) {
+  lock_guard<mutex> lk(_lockClaimedTasks);
+  return _claimedTasks.insert(task).second;
+}
+
+ETTiering* StripeStore::getTiering() {
+  return _tiering;
+}
+
+PlanPool* StripeStore::getPlanPool() {
+  return _planPool;
+}
+
+void StripeStore::loadUpdateRecord(string payload) {
+  int pos = payload.find(';');
+  int pos2 = payload.find(';', pos+1);
+  if (pos == -1 || pos2 == -1) {
+    cerr << "StripeStore::loadUpdateRecord bad record " << payload << endl;
+    return;
+  }
+  string objname = payload.substr(0, pos);
+  string stagedname = payload.substr(pos+1, pos2-pos-1);
+  lock_guard<mutex> lk(_lockPendingUpdates);
+  if (stagedname.empty()) {
+    _pendingUpdates.erase(objname);
+    return;
+  }
+  _pendingUpdates[objname] = stagedname;
+  // the metalog replays the stripe record of the update as a pool record
+  if (pos2 + 1 < payload.length()) loadStripeRecord(RedisUtil::str2container(payload.substr(pos2+1)));
+}
+
+vector<string> StripeStore::getEncodedStripes(string ecpoolid) {
+  OfflineECPool* ecpool = getECPool(ecpoolid);
+  vector<string> objs;
+  _objEntryIndex.forEach([&](string objname, SSEntry* entry) {
+    if (entry->getType() != 0 && entry->getEcidpool() == ecpoolid) objs.push_back(objname);
+  });
+
+  set<string> stripes;
+  ecpool->lock();
+  for (auto obj: objs) {
+    string stripename = getStripeForObj(ecpool, obj);
+    if (stripes.count(stripename)) continue;
+    // stripes that are not erasure-coded yet only list their data objs
+    if (getStripeObjs(ecpool, stripename).size() == getStripePolicy(ecpool, stripename)->getN()) stripes.insert(stripename);
+  }
+  ecpool->unlock();
+  return vector<string>(stripes.begin(), stripes.end());
 }
 
 int StripeStore::getRPInProgressNum() {
@@ -276,11 +521,14 @@ void StripeStore::addLostObj(string objname) {
   // check whether objname is in _RPInProgress
   bool inrepair = false;
   _lockRPInProgress.lock();
-  if (find(_RPInProgress.begin(), _RPInProgress.end(), objname) != _RPInProgress.end()) {
-    inrepair = true;
-  }
+  if (_RPInProgress.find(objname) != _RPInProgress.end()) inrepair = true;
   _lockRPInProgress.unlock();
   if (inrepair) return;
+  // objects of a failed node are scheduled by the recovery job
+  _lockRecoveryJob.lock();
+  if (_recoveryJob && _recoveryJob->contains(objname)) inrepair = true;
+  _lockRecoveryJob.unlock();
+  if (inrepair) return;
   _lockLostMap.lock();
   if (_lostMap.find(objname) == _lostMap.end()) {
     _lostMap.insert(make_pair(objname, 1));
@@ -288,41 +536,58 @@ void StripeStore::addLostObj(string objname) {
     _lostMap[objname]++;
   }
   _lockLostMap.unlock();
+  notifyRepair();
+}
+
+bool StripeStore::repairReady(int concurrentNum) {
+  if (getRPInProgressNum() >= concurrentNum) return false;
+  bool toret = false;
+  _lockRecoveryJob.lock();
+  if (_recoveryJob && _recoveryJob->hasPending()) toret = true;
+  _lockRecoveryJob.unlock();
+  if (toret || !_enableRepair) return toret;
+  _lockLostMap.lock();
+  for (auto item: _lostMap) {
+    if (_conf->_repair_scheduling != "threshold" || item.second >= _conf->_repair_threshold) {
+      toret = true;
+      break;
+    }
+  }
+  _lockLostMap.unlock();
+  return toret;
 }
 
 void StripeStore::scanRepair() {
   int concurrentNum = _conf->_ec_concurrent;
   while (true) {
-     std::this_thread::sleep_for(std::chrono::seconds(1));
-     if (!_enableRepair) continue;
-     cout << "StripeStore::scanning repair queue" << endl;
-     int rpInProgressNum = getRPInProgressNum();
-     cout << "StripeStore::scanRepair.rpInProgressNum = " << rpInProgressNum << endl;
-     while (_lostMap.size() && (rpInProgressNum < concurrentNum)) {
-       string objname;
- 
-       // search the lost map and find the one with the most request num
-       int maxreq=0;
-       _lockLostMap.lock();
-       for (auto item: _lostMap) {
-         if (item.second > maxreq) {
-           maxreq = item.second;
-           objname = item.first;
-         }
-       }
-       _lockLostMap.unlock();
- 
-       // now we have the obj with the most request num
-       if (_conf->_repair_scheduling == "threshold") {
-         if (!_enableRepair) continue;
-         if (maxreq < _conf->_repair_threshold) continue;
-       }
-
-      if ((_conf->_repair_scheduling == "delay" ) && 
-          !_enableRepair) continue;
-
-//      if (_conf->_repair_scheduling == "normal") continue;
-    
+    // wait until a repair can start, finishRepair and addLostObj wake us up
+    {
+      unique_lock<mutex> lk(_lockSchedule);
+      _repairCv.wait(lk, [&]{ return repairReady(concurrentNum); });
+    }
+    // a full-node recovery is requested explicitly, it does not wait for enableRepair
+    int rpInProgressNum = dispatchNodeRecovery(getRPInProgressNum(), concurrentNum);
+    if (!_enableRepair) continue;
+    cout << "StripeStore::scanRepair.rpInProgressNum = " << rpInProgressNum << endl;
+    while (rpInProgressNum < concurrentNum) {
+      string objname;
+
+      // search the lost map and find the one with the most request num
+      int maxreq=0;
+      _lockLostMap.lock();
+      for (auto item: _lostMap) {
+        if (item.second > maxreq) {
+          maxreq = item.second;
+          objname = item.first;
+        }
+      }
+      _lockLostMap.unlock();
+      if (maxreq == 0) break;
+
+      // now we have the obj with the most request num, under threshold
+      // scheduling it waits for more requests
+      if (_conf->_repair_scheduling == "threshold" && maxreq < _conf->_repair_threshold) break;
+
       // send repair request to coordinator  
       CoorCommand* coorCmd = new CoorCommand();
       coorCmd->buildType8(8, _conf->_localIp, objname);
@@ -343,25 +608,250 @@ void StripeStore::scanRepair() {
 
 void StripeStore::startRepair(string objname) {
   _lockRPInProgress.lock();
-  _RPInProgress.push_back(objname);
+  _RPInProgress.insert(objname);
+  _lockRPInProgress.unlock();
+}
+
+bool StripeStore::claimRepair(string objname) {
+  _lockRecoveryJob.lock();
+  bool inrepair = _recoveryJob && _recoveryJob->contains(objname);
+  _lockRecoveryJob.unlock();
+  if (inrepair) return false;
+
+  _lockRPInProgress.lock();
+  if (_RPInProgress.find(objname) != _RPInProgress.end()) inrepair = true;
+  else _RPInProgress.insert(objname);
   _lockRPInProgress.unlock();
+  if (inrepair) return false;
+
+  _lockLostMap.lock();
+  if (_lostMap.find(objname) != _lostMap.end()) _lostMap.erase(objname);
+  _lockLostMap.unlock();
+  return true;
 }
 
 void StripeStore::finishRepair(string objname) {
   _lockRPInProgress.lock();
-  vector<string>::iterator pos = find(_RPInProgress.begin(), _RPInProgress.end(), objname);
-  if (pos != _RPInProgress.end()) _RPInProgress.erase(pos);
+  _RPInProgress.erase(objname);
   _lockRPInProgress.unlock();
+
+  _lockRecoveryJob.lock();
+  if (_recoveryJob) _recoveryJob->finish(objname);
+  _lockRecoveryJob.unlock();
+  notifyRepair();
+}
+
+void StripeStore::failRepair(string objname) {
+  cerr << "StripeStore::failRepair " << objname << endl;
+  _lockRPInProgress.lock();
+  _RPInProgress.erase(objname);
+  _lockRPInProgress.unlock();
+
+  _lockRecoveryJob.lock();
+  if (_recoveryJob) _recoveryJob->fail(objname);
+  _lockRecoveryJob.unlock();
+  notifyRepair();
+}
+
+int StripeStore::startNodeRecovery(unsigned int failedIp) {
+  _lockRecoveryJob.lock();
+  bool busy = _recoveryJob && !_recoveryJob->finished();
+  _lockRecoveryJob.unlock();
+  if (busy) {
+    cout << "StripeStore::startNodeRecovery another node recovery is in progress" << endl;
+    return -1;
+  }
+
+  // 1. objects placed on the failed node
+  vector<string> lostobjs;
+  _objEntryIndex.forEach([&](string objname, SSEntry* entry) {
+    if (entry->getLocOfObj(objname) == failedIp) lostobjs.push_back(objname);
+  });
+
+  RecoveryJob* job = new RecoveryJob(failedIp, _conf->_agentsIPs);
+  int scheduled = 0;
+  for (auto lostobj: lostobjs) {
+    // 2. stripe, ec policy and object size of each lost object
+    SSEntry* ssentry = getEntryFromObj(lostobj);
+    string ecidpool = ssentry->getEcidpool();
+    vector<string> stripeobjs;
+    ECPolicy* ecpolicy;
+    long objbytes;
+    if (ssentry->getType() == 0) {
+      ecpolicy = _conf->_ecPolicyMap[ecidpool];
+      stripeobjs = ssentry->getObjlist();
+      objbytes = (long)ssentry->getFilesizeMB() * 1048576 / ecpolicy->getK();
+    } else {
+      OfflineECPool* ecpool = getECPool(ecidpool);
+      ecpool->lock();
+      string stripename = getStripeForObj(ecpool, lostobj);
+      stripeobjs = getStripeObjs(ecpool, stripename);
+      ecpolicy = getStripePolicy(ecpool, stripename);
+      ecpool->unlock();
+      objbytes = (long)ecpool->getBasesize() * 1048576;
+    }
+    int ecn = ecpolicy->getN();
+    int ecw = ecpolicy->getW();
+    // stripes that are not erasure-coded yet cannot be repaired
+    if (stripeobjs.size() != ecn) continue;
+    int lostidx = find(stripeobjs.begin(), stripeobjs.end(), lostobj) - stripeobjs.begin();
+
+    // 3. bytes each helper reads for the repair
+    vector<int> plan = getRepairPlan(ecidpool, ecpolicy, lostidx);
+    vector<unsigned int> stripeIps;
+    unordered_map<unsigned int, long> helperBytes;
+    for (int i=0; i<ecn; i++) {
+      unsigned int ip = getEntryFromObj(stripeobjs[i])->getLocOfObj(stripeobjs[i]);
+      stripeIps.push_back(ip);
+      if (i == lostidx || plan[i] == 0) continue;
+      helperBytes[ip] += objbytes / ecw * plan[i];
+    }
+    job->addStripe(lostobj, stripeIps, helperBytes);
+    scheduled++;
+  }
+  cout << "StripeStore::startNodeRecovery " << scheduled << " of " << lostobjs.size()
+       << " lost objs scheduled, the others are not erasure-coded yet" << endl;
+  cout << "StripeStore::startNodeRecovery " << job->progress();
+
+  _lockRecoveryJob.lock();
+  if (_recoveryJob) delete _recoveryJob;
+  _recoveryJob = job;
+  _lockRecoveryJob.unlock();
+  notifyRepair();
+  return scheduled;
+}
+
+vector<int> StripeStore::getRepairPlan(string ecidpool, ECPolicy* ecpolicy, int lostidx) {
+  // converted stripes of a pool have their own policy
+  string key = ecidpool + ":" + ecpolicy->getPolicyId() + ":" + to_string(lostidx);
+  _lockRepairPlanCache.lock();
+  if (_repairPlanCache.find(key) != _repairPlanCache.end()) {
+    vector<int> toret = _repairPlanCache[key];
+    _lockRepairPlanCache.unlock();
+    return toret;
+  }
+  _lockRepairPlanCache.unlock();
+
+  // the same decode the coordinator builds for a single lost object
+  int ecn = ecpolicy->getN();
+  int ecw = ecpolicy->getW();
+  vector<int> availcidx;
+  vector<int> toreccidx;
+  for (int i=0; i<ecn; i++) {
+    for (int j=0; j<ecw; j++) {
+      if (i == lostidx) toreccidx.push_back(i*ecw+j);
+      else availcidx.push_back(i*ecw+j);
+    }
+  }
+  ECBase* ec = ecpolicy->getECClass();
+  ec->SetNodeCost(vector<double>());
+  ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
+  vector<int> toret(ecn, 0);
+  for (auto cid: ecdag->getLeaves()) {
+    int sid = cid/ecw;
+    if (sid < ecn && sid != lostidx) toret[sid]++;
+  }
+  delete ecdag;
+
+  _lockRepairPlanCache.lock();
+  _repairPlanCache[key] = toret;
+  _lockRepairPlanCache.unlock();
+  return toret;
+}
+
+ECDAG* StripeStore::getDegradedPlan(ECPolicy* ecpolicy, int lostidx) {
+  string key = ecpolicy->getPolicyId() + ":" + to_string(lostidx);
+  _lockDegradedPlans.lock();
+  if (_degradedPlans.find(key) != _degradedPlans.end()) {
+    ECDAG* toret = _degradedPlans[key];
+    _lockDegradedPlans.unlock();
+    cout << "StripeStore::getDegradedPlan reuse plan " << key << endl;
+    return toret;
+  }
+  _lockDegradedPlans.unlock();
+
+  // ET decodes pick helper symbols by their decoupling cost and do not take
+  // node costs, so one plan of a lost idx serves all stripes
+  int ecn = ecpolicy->getN();
+  int ecw = ecpolicy->getW();
+  vector<int> availcidx;
+  vector<int> toreccidx;
+  for (int i=0; i<ecn; i++) {
+    for (int j=0; j<ecw; j++) {
+      if (i == lostidx) toreccidx.push_back(i*ecw+j);
+      else availcidx.push_back(i*ecw+j);
+    }
+  }
+  ECBase* ec = ecpolicy->getECClass();
+  ec->SetNodeCost(vector<double>());
+  ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
+
+  _lockDegradedPlans.lock();
+  if (_degradedPlans.find(key) == _degradedPlans.end()) {
+    _degradedPlans.insert(make_pair(key, ecdag));
+  } else {
+    // planned by another thread meanwhile
+    delete ecdag;
+    ecdag = _degradedPlans[key];
+  }
+  _lockDegradedPlans.unlock();
+  return ecdag;
+}
+
+int StripeStore::dispatchNodeRecovery(int rpInProgressNum, int concurrentNum) {
+  _lockRecoveryJob.lock();
+  while (_recoveryJob && rpInProgressNum < concurrentNum) {
+    // 1. take up to ec.batch.num objs that fit in the free slots
+    int batchnum = min(_conf->_ec_batch, concurrentNum - rpInProgressNum);
+    vector<string> objnames;
+    while (batchnum > 0) {
+      string objname = _recoveryJob->next();
+      if (objname == "") break;
+      startRepair(objname);
+      _lockLostMap.lock();
+      if (_lostMap.find(objname) != _lostMap.end()) _lostMap.erase(objname);
+      _lockLostMap.unlock();
+      objnames.push_back(objname);
+      batchnum--;
+    }
+    if (objnames.size() == 0) break;
+
+    // 2. send repair request to coordinator, one for the batch
+    CoorCommand* coorCmd = new CoorCommand();
+    if (objnames.size() > 1) coorCmd->buildType26(26, _conf->_localIp, objnames);
+    else coorCmd->buildType8(8, _conf->_localIp, objnames[0]);
+    coorCmd->sendTo(_conf->_coorIp);
+    delete coorCmd;
+
+    rpInProgressNum = getRPInProgressNum();
+  }
+  _lockRecoveryJob.unlock();
+  return rpInProgressNum;
+}
+
+unsigned int StripeStore::getRecoveryDest(string objname, vector<unsigned int> candidates) {
+  unsigned int toret = 0;
+  _lockRecoveryJob.lock();
+  if (_recoveryJob) toret = _recoveryJob->getDest(objname);
+  _lockRecoveryJob.unlock();
+  if (find(candidates.begin(), candidates.end(), toret) == candidates.end()) return 0;
+  return toret;
+}
+
+string StripeStore::getRecoveryProgress() {
+  string toret = "no node recovery\n";
+  _lockRecoveryJob.lock();
+  if (_recoveryJob) toret = _recoveryJob->progress();
+  _lockRecoveryJob.unlock();
+  return toret;
 }
 
 void StripeStore::backupEntry(string entrystr) {
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  _lockEntryStore.lock();
-  _entryStore.open(_entryStorePath, ios::out | ios::app);
-  _entryStore << entrystr;
-  _entryStore.close();
-  _lockEntryStore.unlock();
+  if (!_metaLog->append(METALOG_ENTRY, entrystr)) {
+    cerr << "StripeStore::backupEntry fail to log an entry" << endl;
+  }
   gettimeofday(&time2, NULL);
 //  cout << "StripeStore::backupEntry.duration = " << RedisUtil::duration(time1, time2) << endl;
 }
@@ -369,20 +859,238 @@ void StripeStore::backupEntry(string entrystr) {
 void StripeStore::backupPoolStripe(string poolstr) {
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  _lockPoolStore.lock();
-  _poolStore.open(_poolStorePath, ios::out | ios::app);
-  _poolStore << poolstr;
-  _poolStore.close();
-  _lockPoolStore.unlock();
+  if (!_metaLog->append(METALOG_POOL, poolstr)) {
+    cerr << "StripeStore::backupPoolStripe fail to log " << poolstr.substr(0, poolstr.find(';', poolstr.find(';') + 1)) << endl;
+  }
   gettimeofday(&time2, NULL);
 //  cout << "StripeStore::backupPool.duration = " << RedisUtil::duration(time1, time2) << endl;
 }
 
+string StripeStore::stripeRecord(string ecpoolid, OfflineECPool* ecpool, string stripename) {
+  // ecpoolid;stripename;E;srcobj_0;...;srcobj_k-1;agentidx_k;...;agentidx_n-1;
+  //   an encoded stripe, parity objs are named by the pool, stripe and index
+  // ecpoolid;stripename;P;obj_0;...;
+  //   a stripe whose objs are all listed
+  // ecpoolid;stripename;C;ecid;srcobj_0;...;srcobj_k-1;obj_k;agentidx_k;...;obj_n-1;agentidx_n-1;
+  //   a stripe converted in place to ecid, with its own parity objs
+  // a location that is not a configured agent is kept as its ip instead of agentidx
+  vector<string> objlist = getStripeObjs(ecpool, stripename);
+  ECPolicy* ecpolicy = getStripePolicy(ecpool, stripename);
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+
+  unsigned int stripeid;
+  bool converted = false;
+  if (_names.lookup(stripename, stripeid)) {
+    _lockConverted.lock();
+    converted = _convertedStripes.find(stripeid) != _convertedStripes.end();
+    _lockConverted.unlock();
+  }
+  if (converted) {
+    string toret = ecpoolid + ";" + stripename + ";C;" + ecpolicy->getPolicyId() + ";";
+    for (int i=0; i<objlist.size(); i++) {
+      toret += objlist[i] + ";";
+      if (i < k) continue;
+      toret += locToken(objlist[i]) + ";";
+    }
+    return toret;
+  }
+
+  bool encoded = objlist.size() == n;
+  for (int i=k; i<objlist.size() && encoded; i++) {
+    if (objlist[i] != "/"+ecpoolid+"-"+stripename+"-"+to_string(i)) encoded = false;
+  }
+
+  string toret = ecpoolid + ";" + stripename + ";" + (encoded ? "E;" : "P;");
+  for (int i=0; i<objlist.size(); i++) {
+    if (encoded && i >= k) {
+      toret += locToken(objlist[i]) + ";";
+    } else {
+      toret += objlist[i] + ";";
+    }
+  }
+  return toret;
+}
+
+string StripeStore::locToken(string objname) {
+  SSEntry* entry = getEntryFromObj(objname);
+  unsigned int loc = entry == NULL ? 0 : entry->getLocOfObj(objname);
+  int agentidx = find(_conf->_agentsIPs.begin(), _conf->_agentsIPs.end(), loc) - _conf->_agentsIPs.begin();
+  if (agentidx < _conf->_agentsIPs.size()) return to_string(agentidx);
+  cout << "StripeStore::locToken " << objname << " is not on a configured agent" << endl;
+  return RedisUtil::ip2Str(loc);
+}
+
+bool StripeStore::locFromToken(string token, unsigned int& loc) {
+  if (token.find(".") != -1) {
+    loc = inet_addr(token.c_str());
+    return true;
+  }
+  int agentidx = atoi(token.c_str());
+  if (token.empty() || token.find_first_not_of("0123456789") != -1 || agentidx >= _conf->_agentsIPs.size()) return false;
+  loc = _conf->_agentsIPs[agentidx];
+  return true;
+}
+
+void StripeStore::loadStripeRecord(vector<string> items) {
+  if (items.size() < 2 || _conf->_offlineECMap.find(items[0]) == _conf->_offlineECMap.end()) {
+    cout << "StripeStore::loadStripeRecord skip a record of an unknown pool" << endl;
+    return;
+  }
+  string ecpoolid = items[0];
+  string stripename = items[1];
+  string ecid = _conf->_offlineECMap[ecpoolid];
+  int basesizeMB = _conf->_offlineECBase[ecpoolid];
+  ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+  OfflineECPool* ecpool = getECPool(ecpoolid, ecpolicy, basesizeMB);
+  if (items.size() < 3 || (items[2] != "E" && items[2] != "P" && items[2] != "C")) {
+    // record of the previous format lists all the objs
+    ecpool->constructPool(items);
+    return;
+  }
+
+  vector<string> poolitems = {ecpoolid, stripename};
+  if (items[2] == "C") {
+    string convertid = items.size() > 3 ? items[3] : "";
+    if (_conf->_ecPolicyMap.find(convertid) == _conf->_ecPolicyMap.end()) {
+      cout << "StripeStore::loadStripeRecord skip " << stripename << " converted to unknown " << convertid << endl;
+      return;
+    }
+    int n = _conf->_ecPolicyMap[convertid]->getN();
+    int k = _conf->_ecPolicyMap[convertid]->getK();
+    vector<unsigned int> locs;
+    for (int i=k; i<n && items.size() == 4+k+2*(n-k); i++) {
+      unsigned int loc;
+      if (locFromToken(items[5+k+2*(i-k)], loc)) locs.push_back(loc);
+    }
+    if (locs.size() != n-k) {
+      cout << "StripeStore::loadStripeRecord skip malformed record of " << stripename << endl;
+      return;
+    }
+    // the pool lists the stripe as it was encoded, unless its record is replayed as well
+    if (ecpool->getStripeObjList(stripename).size() == 0) {
+      for (int i=0; i<k; i++) poolitems.push_back(items[4+i]);
+      for (int i=k; i<n; i++) poolitems.push_back("/"+ecpoolid+"-"+stripename+"-"+to_string(i));
+      ecpool->constructPool(poolitems);
+    }
+    vector<string> objlist(items.begin()+4, items.begin()+4+k);
+    for (int i=k; i<n; i++) {
+      string objname = items[4+k+2*(i-k)];
+      objlist.push_back(objname);
+      insertEntry(new SSEntry(objname, 1, basesizeMB, ecpoolid, {objname}, {locs[i-k]}));
+    }
+    // the parity objs of the previous records of the stripe are gone
+    convertStripe(ecpoolid, stripename, convertid, objlist);
+    return;
+  }
+  if (items[2] == "P") {
+    poolitems.insert(poolitems.end(), items.begin()+3, items.end());
+    ecpool->constructPool(poolitems);
+    return;
+  }
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  vector<unsigned int> locs;
+  for (int i=k; i<n && items.size() == n+3; i++) {
+    unsigned int loc;
+    if (locFromToken(items[3+i], loc)) locs.push_back(loc);
+  }
+  if (locs.size() != n-k) {
+    cout << "StripeStore::loadStripeRecord skip malformed record of " << stripename << endl;
+    return;
+  }
+  for (int i=0; i<k; i++) poolitems.push_back(items[3+i]);
+  for (int i=k; i<n; i++) {
+    string objname = "/"+ecpoolid+"-"+stripename+"-"+to_string(i);
+    poolitems.push_back(objname);
+    // parity objs have no record in entryStore
+    insertEntry(new SSEntry(objname, 1, basesizeMB, ecpoolid, {objname}, {locs[i-k]}));
+  }
+  ecpool->constructPool(poolitems);
+}
+
+// heap bytes of a string, short strings are kept inline
+static long strBytes(const string& str) {
+  return sizeof(string) + (str.capacity() > 15 ? str.capacity() + 1 : 0);
+}
+
+string StripeStore::getMetaUsage() {
+  long files = _ssEntryIndex.size();
+  long objs = _objEntryIndex.size();
+  long names = _names.size();
+  long node = 2 * sizeof(void*);
+
+  // 1. packed records kept by id: the name table, the indexes, the
+  // converted stripes and the hdfs blocks
+  long nameBytes = _names.memoryBytes();
+  long indexBytes = _ssEntryIndex.memoryBytes() + _objEntryIndex.memoryBytes();
+  long convertedBytes = 0;
+  _lockConverted.lock();
+  for (auto item: _convertedStripes) {
+    convertedBytes += node + sizeof(unsigned int) + sizeof(ConvertedStripe) + item.second.objs.capacity() * sizeof(unsigned int);
+  }
+  convertedBytes += _convertedObjs.size() * (node + 2 * sizeof(unsigned int));
+  convertedBytes += (_convertedStripes.bucket_count() + _convertedObjs.bucket_count()) * sizeof(void*);
+  _lockConverted.unlock();
+  convertedBytes += _hdfsfile2block.size() * (node + 2 * sizeof(unsigned int)) + _hdfsfile2block.bucket_count() * sizeof(void*);
+  long packed = nameBytes + indexBytes + convertedBytes;
+
+  // 2. SSEntry and OfflineECPool keep their own copies of the names
+  long entryBytes = 0;
+  _ssEntryIndex.forEach([&](string filename, SSEntry* entry) {
+    entryBytes += sizeof(SSEntry) + strBytes(entry->getFilename()) + strBytes(entry->getEcidpool());
+    vector<string> objlist = entry->getObjlist();
+    for (auto obj: objlist) entryBytes += strBytes(obj);
+    entryBytes += objlist.size() * sizeof(unsigned int);
+  });
+  // a pool lists each obj in its obj set and under its stripe, and maps it
+  // to its stripe; each stripe is listed once and keys its obj list
+  long poolBytes = 0;
+  unordered_map<string, vector<string>> pool2objs;
+  _objEntryIndex.forEach([&](string objname, SSEntry* entry) {
+    if (entry->getType() != 0) pool2objs[entry->getEcidpool()].push_back(objname);
+  });
+  _lockECPoolMap.lock();
+  unordered_map<string, OfflineECPool*> pools = _offlineECPoolMap;
+  _lockECPoolMap.unlock();
+  for (auto item: pools) {
+    OfflineECPool* ecpool = item.second;
+    set<string> stripes;
+    ecpool->lock();
+    for (auto obj: pool2objs[item.first]) {
+      string stripename = getStripeForObj(ecpool, obj);
+      poolBytes += 3 * strBytes(obj) + strBytes(stripename) + 2 * node + sizeof(bool);
+      stripes.insert(stripename);
+    }
+    ecpool->unlock();
+    for (auto stripename: stripes) poolBytes += 2 * strBytes(stripename) + node + sizeof(vector<string>);
+  }
+
+  string toret = to_string(files) + " files, " + to_string(objs) + " objects, " + to_string(names) + " names\n";
+  toret += "packed: name table " + to_string(nameBytes/1024) + " KB, indexes " + to_string(indexBytes/1024) + " KB, "
+         + "converted " + to_string(convertedBytes/1024) + " KB, "
+         + to_string(objs ? packed / objs : 0) + " bytes per object\n";
+  toret += "by name: entries " + to_string(entryBytes/1024) + " KB, pools " + to_string(poolBytes/1024) + " KB, "
+         + to_string(objs ? (entryBytes + poolBytes) / objs : 0) + " bytes per object\n";
+
+  // 3. what the process really holds, resident pages of /proc/self/statm
+  long pages = 0;
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm != NULL) {
+    if (fscanf(statm, "%*ld %ld", &pages) != 1) pages = 0;
+    fclose(statm);
+  }
+  toret += "process resident " + to_string(pages * sysconf(_SC_PAGESIZE) / 1048576) + " MB\n";
+  return toret;
+}
+
 void StripeStore::setHDFSMeta(string hdfsfile, string block) {
-  _hdfsfile2block.insert(make_pair(hdfsfile, block));
+  _hdfsfile2block.insert(make_pair(_names.intern(hdfsfile), _names.intern(block)));
 }
 
 string StripeStore::getHDFSBlkName(string hdfsfile) {
-  assert (_hdfsfile2block.find(hdfsfile) != _hdfsfile2block.end());
-  return _hdfsfile2block[hdfsfile];
+  unsigned int fileid;
+  bool found = _names.lookup(hdfsfile, fileid);
+  assert (found && _hdfsfile2block.find(fileid) != _hdfsfile2block.end());
+  return _names.name(_hdfsfile2block[fileid]);
 }
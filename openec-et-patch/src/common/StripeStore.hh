@@ -2,17 +2,26 @@
 #define _STRIPESTORE_HH_
 
 #include "BlockingQueue.hh"
+#include "CompletionChannel.hh"
 #include "Config.hh"
+#include "MetaLog.hh"
+#include "RecoveryJob.hh"
 #include "SSEntry.hh"
+#include "NameTable.hh"
+#include "PlanPool.hh"
+#include "SSEntryIndex.hh"
 //#include "ECPolicy.hh"
 //#include "OfflineECPool.hh"
 
 #include "../inc/include.hh"
+#include "../ec/ECDAG.hh"
 #include "../ec/OfflineECPool.hh"
 #include "../protocol/CoorCommand.hh"
 
 using namespace std;
 
+class ETTiering;
+
 class StripeStore {
   private:
     Config* _conf;
@@ -20,13 +29,14 @@ class StripeStore {
     // map original file name to SSEntry
     // for online-encoded file, we can get objname for each split
     // for offline encoded file, we can get splited blocks
-    unordered_map<string, SSEntry*> _ssEntryMap;  
-    mutex _lockSSEntryMap;
+    // names of files, objects and stripes are interned once for all the indexes,
+    // which key by id; entries and pools keep their own copies of the names
+    NameTable _names;
+    SSEntryIndex _ssEntryIndex;
     // map objname to original file name
     // for online encoded file, given a split name, we can get the original filename
     // for offline encoded file, given a block name, we can get the original filename
-    unordered_map<string, SSEntry*> _objEntryMap;
-    mutex _lockObjEntryMap;
+    SSEntryIndex _objEntryIndex;
     
     unordered_map<unsigned int, int> _dataLoadMap;
     mutex _lockDLMap;
@@ -41,15 +51,62 @@ class StripeStore {
     mutex _lockECPoolMap;
     BlockingQueue<pair<string, string>> _pendingECQueue;
     mutex _lockPECQueue;
-    vector<string> _ECInProgress;
+    // in-place conversions, ecid -> {ecpoolid, stripename}, scheduled with encoding
+    deque<pair<string, pair<string, string>>> _pendingConvert;
+    mutex _lockPConvert;
+    unordered_set<string> _ECInProgress;
     mutex _lockECInProgress;
     unordered_map<string, int> _lostMap;
     mutex _lockLostMap;
-    vector<string> _RPInProgress;
+    unordered_set<string> _RPInProgress;
     mutex _lockRPInProgress;
 
+    // full-node recovery
+    RecoveryJob* _recoveryJob = NULL;
+    mutex _lockRecoveryJob;
+    // ecidpool:lostidx -> number of symbols read from each stripe index
+    unordered_map<string, vector<int>> _repairPlanCache;
+    mutex _lockRepairPlanCache;
+    // policy:lostidx -> decode ecdag of an ET degraded read, never evicted
+    unordered_map<string, ECDAG*> _degradedPlans;
+    mutex _lockDegradedPlans;
+
+    // in-place conversion, a converted stripe keeps its data objs in the
+    // pool and has its own policy and parity objs. Names are kept by id
+    struct ConvertedStripe {
+      unsigned int ecid;
+      vector<unsigned int> objs;
+    };
+    // stripe -> ecid, objs
+    unordered_map<unsigned int, ConvertedStripe> _convertedStripes;
+    // parity obj of a converted stripe -> stripe
+    unordered_map<unsigned int, unsigned int> _convertedObjs;
+    mutex _lockConverted;
+
+    // updates whose stripe switched to the new parity but whose data obj is
+    // not overwritten yet, objname -> staged obj with the new data
+    unordered_map<string, string> _pendingUpdates;
+    mutex _lockPendingUpdates;
+    void loadUpdateRecord(string payload);
+
     mutex _lockRandom;
 
+    // accesses and tiers of encoded stripes, for all the coordinator instances
+    ETTiering* _tiering;
+
+    // planning threads of all the coordinator instances
+    PlanPool* _planPool;
+
+    // tasks that one of the coordinator instances runs for all of them
+    unordered_set<string> _claimedTasks;
+    mutex _lockClaimedTasks;
+
+    // the schedulers sleep until their queue or in-progress slots change
+    mutex _lockSchedule;
+    condition_variable _encodeCv;
+    condition_variable _repairCv;
+    CompletionChannel* _completion;
+
     // offline encoding
     bool _enableScan;
     struct timeval _startEnc, _endEnc; 
@@ -57,22 +114,22 @@ class StripeStore {
     bool _enableRepair;
 
     // backup
+    // entryStore and poolStore of the previous text format are only read
     string _entryStorePath = "entryStore";
-    ofstream _entryStore;
-    mutex _lockEntryStore;
-
     string _poolStorePath = "poolStore";
-    ofstream _poolStore;
-    mutex _lockPoolStore;
+    MetaLog* _metaLog;
+    void replayMeta(int type, string payload);
     
-    // for ET
-    unordered_map<string, string> _hdfsfile2block;
+    // for ET, hdfs file -> block by id
+    unordered_map<unsigned int, unsigned int> _hdfsfile2block;
     
   public:
     StripeStore(Config* conf);
 
     bool existEntry(string filename);
     void insertEntry(SSEntry* entry);
+    // drop the entry of a file and its objs from the indexes
+    void removeEntry(string filename);
     SSEntry* getEntry(string filename);
     SSEntry* getEntryFromObj(string objname);
 
@@ -89,6 +146,8 @@ class StripeStore {
     int getControlLoad(unsigned int ip);
     int getRepairLoad(unsigned int ip);
     int getEncodeLoad(unsigned int ip);
+    // work placed on an agent, used to pick helpers that are not busy
+    double getNodeCost(unsigned int ip);
 
 //    bool poolExists(string poolname);
 //    void addECPool(OfflineECPool* ecpool);
@@ -99,13 +158,24 @@ class StripeStore {
     // set status
     void setECStatus(int op, string ectype);
 
+    // event-driven scheduling
+    CompletionChannel* getCompletion();
+    void notifyEncode();
+    void notifyRepair();
+    bool repairReady(int concurrentNum);
+
 //    // offline encode
     void scanning();
     void addEncodeCandidate(string ecpoolid, string stripename);
+    // convert a stripe in place to ecid once an encode slot is free
+    void addConvertCandidate(string ecpoolid, string stripename, string ecid);
     int getECInProgressNum();
     void startECStripe(string stripename);
+    // start a stripe once fewer than concurrentNum are in progress (no limit
+    // if concurrentNum is 0), false if the stripe is in progress already
+    bool claimECStripe(string stripename, int concurrentNum);
 //    void setScan(bool status);
-    void finishECStripe(OfflineECPool* ecpool, string stripename);
+    void finishECStripe(string ecpoolid, string stripename);
     
     // repair
     void scanRepair();
@@ -113,11 +183,59 @@ class StripeStore {
 //    void setRepair(bool status);
     void startRepair(string objname);
     void finishRepair(string objname);
+    // the repair of objname cannot be planned, a node recovery counts it as failed
+    void failRepair(string objname);
+    // move a lost obj in repair unless a repair or a node recovery has it already
+    bool claimRepair(string objname);
     int getRPInProgressNum();
+
+    // in-place conversion, the caller holds the pool lock for the lookups
+    // the entries of the parity objs the stripe no longer has are removed,
+    // and these objs are returned to be deleted
+    vector<string> convertStripe(string ecpoolid, string stripename, string ecid, vector<string> objlist);
+    ECPolicy* getStripePolicy(OfflineECPool* ecpool, string stripename);
+    vector<string> getStripeObjs(OfflineECPool* ecpool, string stripename);
+    string getStripeForObj(OfflineECPool* ecpool, string objname);
+    // update of a data obj, the stripe switches to its new parity and the
+    // overwrite from the staged obj becomes pending in one record
+    vector<string> commitUpdate(string ecpoolid, string stripename, string ecid, vector<string> objlist,
+                                string objname, string stagedname);
+    void finishUpdate(string objname);
+    unordered_map<string, string> getPendingUpdates();
+    // true for the first coordinator instance that claims task, it runs the
+    // task for all the instances that share this stripestore
+    bool claimTask(string task);
+    ETTiering* getTiering();
+    PlanPool* getPlanPool();
+    // erasure-coded stripes of a pool
+    vector<string> getEncodedStripes(string ecpoolid);
+
+    // full-node recovery
+    // lost objs of the node scheduled for repair, -1 if another recovery is running
+    int startNodeRecovery(unsigned int failedIp);
+    vector<int> getRepairPlan(string ecidpool, ECPolicy* ecpolicy, int lostidx);
+    // decode ecdag of a degraded read of lostidx, planned once for all the
+    // coordinator instances and only read by the callers
+    ECDAG* getDegradedPlan(ECPolicy* ecpolicy, int lostidx);
+    int dispatchNodeRecovery(int rpInProgressNum, int concurrentNum);
+    unsigned int getRecoveryDest(string objname, vector<unsigned int> candidates);
+    string getRecoveryProgress();
   
     // backup
     void backupEntry(string entrystr);
     void backupPoolStripe(string stripename);
+    // metadata record of a stripe, the caller holds the pool lock
+    string stripeRecord(string ecpoolid, OfflineECPool* ecpool, string stripename);
+    // malformed records, or records of unknown pools, policies or agents, are skipped
+    void loadStripeRecord(vector<string> items);
+    // agent index of the location of an obj in a stripe record, its ip if it
+    // is not a configured agent
+    string locToken(string objname);
+    bool locFromToken(string token, unsigned int& loc);
+
+    // number of entries, estimated bytes of the name table, indexes, entries
+    // and pools, and the resident size of the process for comparison
+    string getMetaUsage();
 
     // for ET
     void setHDFSMeta(string hdfsfile, string block);
@@ -0,0 +1,158 @@
+#include "Throttle.hh"
+
+TokenBucket Throttle::_buckets[AG_PRIO_NUM][THROTTLE_RES_NUM];
+
+TokenBucket::TokenBucket() {
+  _last = chrono::steady_clock::now();
+  _winStart = _last;
+}
+
+void TokenBucket::refill(chrono::steady_clock::time_point now) {
+  double elapsed = chrono::duration<double>(now - _last).count();
+  _last = now;
+  if (_rate <= 0) return;
+  // allow bursts of 100ms worth of tokens
+  double cap = _rate / 10.0;
+  _tokens += elapsed * _rate;
+  if (_tokens > cap) _tokens = cap;
+}
+
+void TokenBucket::account(long bytes, chrono::steady_clock::time_point now) {
+  _total += bytes;
+  double winElapsed = chrono::duration<double>(now - _winStart).count();
+  if (winElapsed >= 2) {
+    // idle for more than a window
+    _lastWinBytes = 0;
+    _winBytes = 0;
+    _winStart = now;
+  } else if (winElapsed >= 1) {
+    _lastWinBytes = _winBytes;
+    _winBytes = 0;
+    _winStart = now;
+  }
+  _winBytes += bytes;
+}
+
+void TokenBucket::setRate(long rate) {
+  lock_guard<mutex> lk(_lock);
+  refill(chrono::steady_clock::now());
+  _rate = rate;
+  if (_tokens > _rate / 10.0) _tokens = _rate / 10.0;
+}
+
+long TokenBucket::getRate() {
+  lock_guard<mutex> lk(_lock);
+  return _rate;
+}
+
+void TokenBucket::consume(long bytes) {
+  if (bytes <= 0) return;
+  while (true) {
+    double wait;
+    {
+      lock_guard<mutex> lk(_lock);
+      auto now = chrono::steady_clock::now();
+      refill(now);
+      if (_rate <= 0 || _tokens > 0) {
+        if (_rate > 0) _tokens -= bytes;
+        account(bytes, now);
+        return;
+      }
+      wait = -_tokens / _rate;
+    }
+    // wait until the debt is paid back, the rate may change meanwhile
+    this_thread::sleep_for(chrono::duration<double>(min(wait, 0.1) + 0.0001));
+  }
+}
+
+long TokenBucket::getTotal() {
+  lock_guard<mutex> lk(_lock);
+  return _total;
+}
+
+long TokenBucket::getUsage() {
+  lock_guard<mutex> lk(_lock);
+  double winElapsed = chrono::duration<double>(chrono::steady_clock::now() - _winStart).count();
+  if (winElapsed >= 2) return 0;
+  if (winElapsed >= 1) return _winBytes;
+  return _lastWinBytes;
+}
+
+void Throttle::consume(int prio, int res, long bytes) {
+  if (prio < 0 || prio >= AG_PRIO_NUM) prio = AG_PRIO_FOREGROUND;
+  _buckets[prio][res].consume(bytes);
+}
+
+bool Throttle::validPrio(int prio) {
+  return prio == THROTTLE_ALL || (prio >= 0 && prio < AG_PRIO_NUM);
+}
+
+bool Throttle::validRes(int res) {
+  return res == THROTTLE_ALL || (res >= 0 && res < THROTTLE_RES_NUM);
+}
+
+bool Throttle::setRate(int prio, int res, long rate) {
+  if (!validPrio(prio) || !validRes(res)) {
+    cout << "Throttle::setRate unknown class " << prio << " or resource " << res << endl;
+    return false;
+  }
+  for (int i=0; i<AG_PRIO_NUM; i++) {
+    if (prio >= 0 && prio != i) continue;
+    for (int j=0; j<THROTTLE_RES_NUM; j++) {
+      if (res >= 0 && res != j) continue;
+      _buckets[i][j].setRate(rate);
+      cout << "Throttle::setRate " << prioName(i) << "." << resName(j) << " = " << rate << " B/s" << endl;
+    }
+  }
+  return true;
+}
+
+string Throttle::usage() {
+  string toret;
+  for (int i=0; i<AG_PRIO_NUM; i++) {
+    for (int j=0; j<THROTTLE_RES_NUM; j++) {
+      TokenBucket& bucket = _buckets[i][j];
+      toret += prioName(i) + "," + resName(j) + ","
+             + to_string(bucket.getRate()/1024) + ","
+             + to_string(bucket.getUsage()/1024) + ","
+             + to_string(bucket.getTotal()/1024) + ";";
+    }
+  }
+  return toret;
+}
+
+int Throttle::prioFromName(string name) {
+  if (name == "fg" || name == "foreground") return AG_PRIO_FOREGROUND;
+  if (name == "repair") return AG_PRIO_REPAIR;
+  if (name == "encode") return AG_PRIO_ENCODE;
+  if (name == "all") return THROTTLE_ALL;
+  return THROTTLE_UNKNOWN;
+}
+
+int Throttle::resFromName(string name) {
+  if (name == "disk") return THROTTLE_DISK;
+  if (name == "netin") return THROTTLE_NETIN;
+  if (name == "netout") return THROTTLE_NETOUT;
+  if (name == "compute") return THROTTLE_COMPUTE;
+  if (name == "all") return THROTTLE_ALL;
+  return THROTTLE_UNKNOWN;
+}
+
+string Throttle::prioName(int prio) {
+  switch (prio) {
+    case AG_PRIO_FOREGROUND: return "fg";
+    case AG_PRIO_REPAIR: return "repair";
+    case AG_PRIO_ENCODE: return "encode";
+    default: return "all";
+  }
+}
+
+string Throttle::resName(int res) {
+  switch (res) {
+    case THROTTLE_DISK: return "disk";
+    case THROTTLE_NETIN: return "netin";
+    case THROTTLE_NETOUT: return "netout";
+    case THROTTLE_COMPUTE: return "compute";
+    default: return "all";
+  }
+}
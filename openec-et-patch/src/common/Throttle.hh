@@ -0,0 +1,75 @@
+#ifndef _THROTTLE_HH_
+#define _THROTTLE_HH_
+
+#include "../inc/include.hh"
+#include "../protocol/AGCommand.hh"
+
+using namespace std;
+
+// throttled resources of an agent
+#define THROTTLE_DISK 0     // bytes read from the underlying fs
+#define THROTTLE_NETIN 1    // bytes fetched from remote agents
+#define THROTTLE_NETOUT 2   // bytes cached for other agents to fetch
+#define THROTTLE_COMPUTE 3  // input bytes of coding computation
+#define THROTTLE_RES_NUM 4
+
+// class or resource of a rate that applies to all of them, or that is not known
+#define THROTTLE_ALL -1
+#define THROTTLE_UNKNOWN -2
+
+/**
+ * Token bucket in bytes. A consumer may drive the bucket into debt with a
+ * single large request; later consumers wait until the debt is paid back,
+ * so the long term rate never exceeds the configured one.
+ */
+class TokenBucket {
+  private:
+    mutex _lock;
+    long _rate = 0;       // bytes per second, 0 means unlimited
+    double _tokens = 0;
+    chrono::steady_clock::time_point _last;
+
+    // usage
+    long _total = 0;      // bytes consumed since start
+    long _winBytes = 0;   // bytes consumed in the current window
+    long _lastWinBytes = 0;
+    chrono::steady_clock::time_point _winStart;
+
+    void refill(chrono::steady_clock::time_point now);
+    void account(long bytes, chrono::steady_clock::time_point now);
+
+  public:
+    TokenBucket();
+    void setRate(long rate);
+    long getRate();
+    void consume(long bytes);
+    long getTotal();
+    long getUsage(); // bytes/s over the last full second
+};
+
+/**
+ * Per-agent throttles for each priority class (AG_PRIO_*) and resource
+ * (THROTTLE_*). Shared by all workers and streams of an agent process.
+ */
+class Throttle {
+  private:
+    static TokenBucket _buckets[AG_PRIO_NUM][THROTTLE_RES_NUM];
+
+  public:
+    static void consume(int prio, int res, long bytes);
+    // prio/res THROTTLE_ALL applies the rate to all classes/resources,
+    // false if either is neither THROTTLE_ALL nor a valid one
+    static bool setRate(int prio, int res, long rate);
+    static bool validPrio(int prio);
+    static bool validRes(int res);
+    // class,resource,rateKB/s,usageKB/s,totalKB; per line
+    static string usage();
+
+    // THROTTLE_UNKNOWN for names that are not listed by OECClient
+    static int prioFromName(string name);
+    static int resFromName(string name);
+    static string prioName(int prio);
+    static string resName(int res);
+};
+
+#endif
@@ -142,18 +142,54 @@ void AzureLRC::Decode(vector<int> from, vector<int> to, ECDAG *ecdag) {
             }
         } else {
             // global parity
-            generate_matrix(_encode_matrix, _k, _l, _m, 8);
             for (int i=0; i<_k; i++) {
                 data.push_back(_layout[0][i]);
                 coef.push_back(_encode_matrix[sidx * _k + i]);
             }
         }
+        global_decode(from, sidx, data, coef);
         ecdag->Join(ridx, data, coef);
     } else {
         printf("Don't support multiple failures now!\n");
     }
 }
 
+void AzureLRC::global_decode(vector<int> from, int sidx, vector<int> &data, vector<int> &coef) {
+    if (GetNodeCost().empty()) return;
+
+    // the busiest helper bounds the repair
+    vector<double> cost = GetSymbolCost(data);
+    double maxcost = 0;
+    for (auto c : cost) maxcost = max(maxcost, c);
+
+    // only symbols of this instance take part
+    vector<int> avail;
+    for (auto symbol : from) {
+        if (find(_layout[0].begin(), _layout[0].end(), symbol) != _layout[0].end()) avail.push_back(symbol);
+    }
+    if (avail.size() < _k) return;
+
+    vector<int> helpers = CheapestSymbols(avail, _k);
+    cost = GetSymbolCost(helpers);
+    double globalcost = 0;
+    for (auto c : cost) globalcost = max(globalcost, c);
+    if (globalcost >= maxcost) return;
+
+    // decode from the k helpers, which must be independent
+    int select_matrix[_k * _k];
+    int invert_matrix[_k * _k];
+    for (int i = 0; i < _k; i++) {
+        int hidx = find(_layout[0].begin(), _layout[0].end(), helpers[i]) - _layout[0].begin();
+        memcpy(select_matrix + i * _k, _encode_matrix + hidx * _k, _k * sizeof(int));
+    }
+    if (jerasure_invert_matrix(select_matrix, invert_matrix, _k, 8) == -1) return;
+
+    int *coef_vector = jerasure_matrix_multiply(_encode_matrix + sidx * _k, invert_matrix, 1, _k, _k, _k, 8);
+    data = helpers;
+    coef = vector<int>(coef_vector, coef_vector + _k);
+    free(coef_vector);
+}
+
 void AzureLRC::generate_matrix(int* matrix, int k, int l, int r, int w) {
     int n = k + l + r;
     memset(matrix, 0, n * k * sizeof(int));
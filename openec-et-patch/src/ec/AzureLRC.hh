@@ -31,6 +31,18 @@ class AzureLRC : public ECBase {
      */
     void generate_matrix(int* matrix, int k, int l, int r, int w);
 
+    /**
+     * @brief replace the local repair of symbol sidx in data/coef with a
+     * repair from the k cheapest helpers of from, if that avoids a busier
+     * helper and the k helpers are independent
+     * 
+     * @param from available symbols
+     * @param sidx index of the lost symbol in the stripe
+     * @param data helpers of the local repair
+     * @param coef coefficients of the local repair
+     */
+    void global_decode(vector<int> from, int sidx, vector<int> &data, vector<int> &coef);
+
      /**
      * @brief initialize layout and symbols by instance id (out of num_instances)
      * 
@@ -0,0 +1,102 @@
+#include "CodeTable.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+mutex CodeTable::_lock;
+string CodeTable::_dir;
+unordered_map<string, shared_ptr<const CodeTable::Rows>> CodeTable::_tables;
+
+void CodeTable::setDir(string dir) {
+    lock_guard<mutex> lk(_lock);
+    _dir = dir;
+    if (!_dir.empty()) mkdir(_dir.c_str(), 0755);
+}
+
+string CodeTable::key(string cls, int n, int k, int w, vector<string> param) {
+    string toret = cls + "_" + to_string(n) + "_" + to_string(k) + "_" + to_string(w);
+    for (auto &s : param) {
+        toret += "_" + s;
+    }
+    // keep the key usable as a file name
+    for (auto &c : toret) {
+        if (!isalnum(c) && c != '_' && c != '-') c = '-';
+    }
+    return toret;
+}
+
+shared_ptr<const CodeTable::Rows> CodeTable::get(string key) {
+    lock_guard<mutex> lk(_lock);
+    auto it = _tables.find(key);
+    if (it != _tables.end()) return it->second;
+
+    Rows rows;
+    if (_dir.empty() || !load(key, rows)) return NULL;
+    shared_ptr<const Rows> table = make_shared<const Rows>(rows);
+    _tables.insert(make_pair(key, table));
+    return table;
+}
+
+void CodeTable::put(string key, Rows rows) {
+    lock_guard<mutex> lk(_lock);
+    if (!_dir.empty()) persist(key, rows);
+    _tables[key] = make_shared<const Rows>(rows);
+}
+
+void CodeTable::clear() {
+    lock_guard<mutex> lk(_lock);
+    _tables.clear();
+}
+
+string CodeTable::path(string key) {
+    return _dir + "/" + key + ".tbl";
+}
+
+// | CODETABLE | version | key | numrows |, then each row as | len | values... |
+bool CodeTable::load(string key, Rows& rows) {
+    ifstream in(path(key));
+    if (!in.is_open()) return false;
+
+    string magic, name;
+    int version = 0;
+    long numRows = -1;
+    in >> magic >> version >> name >> numRows;
+    if (!in || magic != "CODETABLE" || version != CODETABLE_VERSION || name != key || numRows < 0) {
+        printf("CodeTable::load %s is stale, rebuild\n", key.c_str());
+        return false;
+    }
+    rows.resize(numRows);
+    for (auto &row : rows) {
+        long len = -1;
+        in >> len;
+        if (!in || len < 0) return false;
+        row.resize(len);
+        for (auto &v : row) in >> v;
+    }
+    if (!in) {
+        printf("CodeTable::load %s is truncated, rebuild\n", key.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CodeTable::persist(string key, Rows& rows) {
+    // write aside and rename, a concurrent reader never sees a partial table
+    string tmp = path(key) + ".tmp." + to_string(getpid());
+    ofstream out(tmp);
+    if (!out.is_open()) {
+        printf("CodeTable::persist fails to open %s\n", tmp.c_str());
+        return;
+    }
+    out << "CODETABLE " << CODETABLE_VERSION << " " << key << " " << rows.size() << "\n";
+    for (auto &row : rows) {
+        out << row.size();
+        for (auto v : row) out << " " << v;
+        out << "\n";
+    }
+    out.close();
+    if (!out || rename(tmp.c_str(), path(key).c_str()) != 0) {
+        printf("CodeTable::persist fails to write %s\n", path(key).c_str());
+        unlink(tmp.c_str());
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef _CODETABLE_HH_
+#define _CODETABLE_HH_
+
+#include <memory>
+
+#include "../inc/include.hh"
+
+using namespace std;
+
+// bump when the tables a code derives change, persisted tables of other versions are rebuilt
+#define CODETABLE_VERSION 1
+
+/**
+ * Derived tables of a code construction, e.g., the parity source packets and
+ * coefficients HTEC finds by partition search, keyed by (class, n, k, w,
+ * params). A table is a list of int rows in an order defined by its code.
+ *
+ * Tables are shared by all instances in a process. With a table directory,
+ * a table missing in memory is loaded lazily from a versioned artifact, and
+ * a newly built table is persisted there.
+ */
+class CodeTable {
+  public:
+    typedef vector<vector<int>> Rows;
+
+    // directory of persisted tables, empty to keep tables in memory only
+    static void setDir(string dir);
+    static string key(string cls, int n, int k, int w, vector<string> param);
+
+    // NULL if the table is neither in memory nor persisted
+    static shared_ptr<const Rows> get(string key);
+    static void put(string key, Rows rows);
+
+    // drop tables in memory, persisted tables are kept
+    static void clear();
+
+  private:
+    static mutex _lock;
+    static string _dir;
+    static unordered_map<string, shared_ptr<const Rows>> _tables;
+
+    static string path(string key);
+    static bool load(string key, Rows& rows);
+    static void persist(string key, Rows& rows);
+};
+
+#endif
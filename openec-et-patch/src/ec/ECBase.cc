@@ -1,4 +1,5 @@
 #include "ECBase.hh"
+#include "Computation.hh"
 
 ECBase::ECBase(){
 }
@@ -12,4 +13,148 @@ vector<int> ECBase::GetNodeSymbols(int nodeid) {
 
 vector<vector<int>> ECBase::GetLayout() {
     return vector<vector<int>>();
-}
\ No newline at end of file
+}
+
+thread_local ECBase *ECBase::_costOwner = NULL;
+thread_local vector<double> ECBase::_nodeCost;
+
+void ECBase::SetNodeCost(vector<double> cost) {
+    _costOwner = this;
+    _nodeCost = cost;
+}
+
+vector<double> ECBase::GetNodeCost() {
+    return _costOwner == this ? _nodeCost : vector<double>();
+}
+
+vector<double> ECBase::GetSymbolCost(vector<int> symbols) {
+    vector<double> toret(symbols.size(), 0);
+    vector<double> nodeCost = GetNodeCost();
+    if (nodeCost.empty()) return toret;
+
+    // the node of a symbol follows the layout if the code has one
+    unordered_map<int, int> sym2node;
+    vector<vector<int>> layout = GetLayout();
+    for (int sp = 0; sp < layout.size(); sp++) {
+        for (int i = 0; i < layout[sp].size(); i++) sym2node[layout[sp][i]] = i;
+    }
+
+    for (int i = 0; i < symbols.size(); i++) {
+        int nodeid = -1;
+        if (sym2node.find(symbols[i]) != sym2node.end()) nodeid = sym2node[symbols[i]];
+        else if (_w > 0) nodeid = symbols[i] / _w;
+        if (nodeid >= 0 && nodeid < nodeCost.size()) toret[i] = nodeCost[nodeid];
+    }
+    return toret;
+}
+
+vector<int> ECBase::CheapestSymbols(vector<int> from, int num) {
+    if (GetNodeCost().empty() || num >= from.size()) {
+        return vector<int>(from.begin(), from.begin() + min(num, (int)from.size()));
+    }
+
+    vector<int> order;
+    for (int i = 0; i < from.size(); i++) order.push_back(i);
+    vector<double> cost = GetSymbolCost(from);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return cost[a] < cost[b]; });
+    order.resize(num);
+    sort(order.begin(), order.end());
+
+    vector<int> toret;
+    for (auto i : order) toret.push_back(from[i]);
+    return toret;
+}
+
+vector<int> ECBase::LinearSolve(ECDAG *encode, vector<int> from, vector<int> to,
+    vector<vector<int>> &children, vector<vector<int>> &coefs) {
+    children.clear();
+    coefs.clear();
+
+    // 1. coefs of each symbol over the leaves, in topological order
+    vector<int> leaves = encode->getLeaves();
+    unordered_map<int, vector<int>> value;
+    for (auto cidx : encode->toposort()) {
+        ECNode *node = encode->getNode(cidx);
+        // a bind node of BindX computes its headers, which are evaluated through it
+        if (node->getCoefmap().size() > 1) continue;
+        vector<int> cur(leaves.size(), 0);
+        if (node->getChildNum() == 0) {
+            cur[find(leaves.begin(), leaves.end(), cidx) - leaves.begin()] = 1;
+        } else {
+            vector<ECNode *> childNodes = node->getChildren();
+            vector<int> childCoefs = node->getCoefmap()[cidx];
+            for (int i = 0; i < childNodes.size(); i++) {
+                // terms of the child, a bind node contributes its children by the coefs of cidx
+                vector<ECNode *> terms = {childNodes[i]};
+                vector<int> termCoefs = {childCoefs[i]};
+                if (childNodes[i]->getCoefmap().size() > 1) {
+                    terms = childNodes[i]->getChildren();
+                    termCoefs = childNodes[i]->getCoefmap()[cidx];
+                    for (int t = 0; t < termCoefs.size(); t++)
+                        termCoefs[t] = galois_single_multiply(termCoefs[t], childCoefs[i], 8);
+                }
+                for (int t = 0; t < terms.size(); t++) {
+                    vector<int> &child = value[terms[t]->getNodeId()];
+                    for (int j = 0; j < cur.size(); j++) {
+                        if (child[j]) cur[j] ^= galois_single_multiply(child[j], termCoefs[t], 8);
+                    }
+                }
+            }
+        }
+        value[cidx] = cur;
+    }
+
+    // 2. echelon form of from, each row keeps its combination of from
+    vector<vector<int>> rows;
+    vector<vector<int>> combos;
+    vector<int> pivots;
+    vector<int> solved;
+    vector<bool> done(to.size(), false);
+    for (int i = 0; i < from.size() && solved.size() < to.size(); i++) {
+        if (value.find(from[i]) == value.end()) continue;
+        vector<int> row = value[from[i]];
+        vector<int> combo(from.size(), 0);
+        combo[i] = 1;
+        for (int l = 0; l < rows.size(); l++) {
+            int f = row[pivots[l]];
+            if (!f) continue;
+            for (int c = 0; c < row.size(); c++) row[c] ^= galois_single_multiply(f, rows[l][c], 8);
+            for (int c = 0; c < combo.size(); c++) combo[c] ^= galois_single_multiply(f, combos[l][c], 8);
+        }
+        int pivot = find_if(row.begin(), row.end(), [](int v) { return v != 0; }) - row.begin();
+        if (pivot == row.size()) continue;
+        int inv = galois_single_divide(1, row[pivot], 8);
+        for (int c = 0; c < row.size(); c++) row[c] = galois_single_multiply(inv, row[c], 8);
+        for (int c = 0; c < combo.size(); c++) combo[c] = galois_single_multiply(inv, combo[c], 8);
+        rows.push_back(row);
+        combos.push_back(combo);
+        pivots.push_back(pivot);
+
+        // 3. symbols of to in the span of the rows so far
+        for (int t = 0; t < to.size(); t++) {
+            if (done[t] || value.find(to[t]) == value.end()) continue;
+            vector<int> target = value[to[t]];
+            vector<int> coef(from.size(), 0);
+            for (int l = 0; l < rows.size(); l++) {
+                int f = target[pivots[l]];
+                if (!f) continue;
+                for (int c = 0; c < target.size(); c++) target[c] ^= galois_single_multiply(f, rows[l][c], 8);
+                for (int c = 0; c < coef.size(); c++) coef[c] ^= galois_single_multiply(f, combos[l][c], 8);
+            }
+            if (find_if(target.begin(), target.end(), [](int v) { return v != 0; }) != target.end()) continue;
+
+            vector<int> symbols, symbolCoefs;
+            for (int c = 0; c < coef.size(); c++) {
+                if (!coef[c]) continue;
+                symbols.push_back(from[c]);
+                symbolCoefs.push_back(coef[c]);
+            }
+            if (symbols.empty()) continue;
+            done[t] = true;
+            solved.push_back(to[t]);
+            children.push_back(symbols);
+            coefs.push_back(symbolCoefs);
+        }
+    }
+    return solved;
+}
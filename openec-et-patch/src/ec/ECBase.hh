@@ -15,6 +15,7 @@ class ECBase {
 
     ECBase();
     ECBase(int n, int k, int w, int opt, vector<string> param);
+    virtual ~ECBase() {}
     
     virtual ECDAG* Encode() = 0;
     virtual ECDAG* Decode(vector<int> from, vector<int> to) = 0;
@@ -39,6 +40,64 @@ class ECBase {
      * @return vector<vector<int>> 
      */
     virtual vector<vector<int>> GetLayout();
+
+    /**
+     * @brief Set the cost of reading from each node for the decodes of the
+     * calling thread on this instance, until it is set again. An instance is
+     * shared by concurrent requests, so the cost is the only state a request
+     * sets on it
+     * 
+     * @param cost indexed by node id, empty for no cost
+     */
+    void SetNodeCost(vector<double> cost);
+
+    /**
+     * @brief Get the cost set by the calling thread on this instance
+     * 
+     * @return vector<double> empty if no cost is set
+     */
+    vector<double> GetNodeCost();
+
+    /**
+     * @brief Get the cost of reading each symbol, 0 if no cost is set
+     * 
+     * @param symbols 
+     * @return vector<double> 
+     */
+    vector<double> GetSymbolCost(vector<int> symbols);
+
+    /**
+     * @brief Choose num symbols of from with the least cost, keeping their
+     * order in from. Ties keep the order in from as well.
+     * 
+     * @param from 
+     * @param num 
+     * @return vector<int> 
+     */
+    vector<int> CheapestSymbols(vector<int> from, int num);
+
+    /**
+     * @brief Solve symbols of to as linear combinations of symbols of from,
+     * both evaluated over the leaves of encode. Symbols of from are taken in
+     * order, skipping the dependent ones, until all of to are solvable, so
+     * the cheapest should come first.
+     * 
+     * @param encode ecdag computing from and to from its leaves
+     * @param from 
+     * @param to 
+     * @param children symbols of from each solved symbol is computed from
+     * @param coefs 
+     * @return vector<int> solved symbols of to, aligned with children and coefs
+     */
+    vector<int> LinearSolve(ECDAG *encode, vector<int> from, vector<int> to,
+        vector<vector<int>> &children, vector<vector<int>> &coefs);
+
+  private:
+    // cost of reading from each node of the stripe, e.g., its current load.
+    // empty by default; when set, codes with alternative helper sets decode
+    // from the cheapest feasible one
+    static thread_local ECBase *_costOwner;
+    static thread_local vector<double> _nodeCost;
 };
 
 #endif
@@ -357,6 +357,11 @@ void ECDAG::optimize2(int opt,
       unsigned int ip = candidates[randomidx];
       cid2ip.insert(make_pair(curcid, ip));
     }
+  } else if (opt == 3) {
+    // Opt3 places the nodes it creates by itself
+    Opt3(cid2ip, ip2Rack, allIps);
+  } else if (opt == 4) {
+    Opt4(cid2ip, ip2Rack, allIps);
   }
 }
 
@@ -616,6 +621,263 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
   }
 }
 
+void ECDAG::Opt3(unordered_map<int, unsigned int>& cid2ip,
+                 unordered_map<unsigned int, string> ip2Rack,
+                 vector<unsigned int> allIps) {
+  // rewrite each wide cluster into a helper chain:
+  // helper i fetches the partial sum of helper i-1, adds its own weighted
+  // symbols and forwards the result, so the parent only receives one stream.
+  // each hop is a fetch&compute command that streams slice by slice.
+  aggregate(3, cid2ip, ip2Rack, allIps);
+}
+
+void ECDAG::Opt4(unordered_map<int, unsigned int>& cid2ip,
+                 unordered_map<unsigned int, string> ip2Rack,
+                 vector<unsigned int> allIps) {
+  // same rewrite as Opt3, but each cluster picks star, chain or a binary
+  // aggregation tree by the cost estimated from the link bandwidth model
+  aggregate(4, cid2ip, ip2Rack, allIps);
+}
+
+void ECDAG::setLinkBw(unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw,
+                      double innerBw, double crossBw, int pktSize, int pktNum) {
+  _linkBw = linkBw;
+  _innerBw = innerBw;
+  _crossBw = crossBw;
+  _pktSize = pktSize;
+  _pktNum = pktNum;
+}
+
+double ECDAG::linkBw(unsigned int src, unsigned int dst, unordered_map<unsigned int, string>& ip2Rack) {
+  // measured bandwidth first, then the configured one of the rack pair
+  if (_linkBw.find(dst) != _linkBw.end() && _linkBw[dst].find(src) != _linkBw[dst].end()) {
+    double bw = _linkBw[dst][src];
+    if (bw > 0) return bw;
+  }
+  double bw = (ip2Rack[src] == ip2Rack[dst]) ? _innerBw : _crossBw;
+  return bw > 0 ? bw : 1;
+}
+
+double ECDAG::aggregationCost(int topology,
+                              vector<unsigned int> helpers,
+                              unordered_map<unsigned int, int> helperload,
+                              int width,
+                              unsigned int pip,
+                              unordered_map<unsigned int, string>& ip2Rack) {
+  // 1. edges with the number of streams they carry, the result always ends on pip.
+  //    a star moves the raw symbols, chain and tree hops move one partial sum per output
+  vector<pair<pair<unsigned int, unsigned int>, int>> edges;
+  int depth = 0;
+  int m = helpers.size();
+  if (topology == AGG_STAR) {
+    for (auto ip: helpers) if (ip != pip) edges.push_back(make_pair(make_pair(ip, pip), helperload[ip]));
+    depth = 1;
+  } else if (topology == AGG_CHAIN) {
+    for (int i=0; i<m-1; i++) edges.push_back(make_pair(make_pair(helpers[i], helpers[i+1]), width));
+    if (helpers[m-1] != pip) edges.push_back(make_pair(make_pair(helpers[m-1], pip), width));
+    depth = edges.size();
+  } else {
+    // heap over the reversed helper order, the root sits next to pip
+    vector<unsigned int> heap(helpers.rbegin(), helpers.rend());
+    for (int i=1; i<m; i++) edges.push_back(make_pair(make_pair(heap[i], heap[(i-1)/2]), width));
+    for (int i=m; i>1; i/=2) depth++;
+    if (heap[0] != pip) {
+      edges.push_back(make_pair(make_pair(heap[0], pip), width));
+      depth++;
+    }
+  }
+
+  // 2. slices are pipelined, so the most loaded ingress bounds the throughput
+  //    and each level of the topology adds the latency of one packet
+  double pktnum = _pktNum > 0 ? _pktNum : 1;
+  double pktsize = _pktSize > 0 ? _pktSize : 1;
+  unordered_map<unsigned int, double> ingress;
+  double slowest = 0;
+  for (auto e: edges) {
+    double t = pktsize / linkBw(e.first.first, e.first.second, ip2Rack);
+    ingress[e.first.second] += t * pktnum * e.second;
+    slowest = max(slowest, t);
+  }
+  double cost = 0;
+  for (auto item: ingress) cost = max(cost, item.second);
+  return cost + depth * slowest;
+}
+
+void ECDAG::aggregate(int opt,
+                      unordered_map<int, unsigned int>& cid2ip,
+                      unordered_map<unsigned int, string> ip2Rack,
+                      vector<unsigned int> allIps) {
+  unordered_map<unsigned int, int> ip2Order;
+  for (int i=0; i<allIps.size(); i++) ip2Order.insert(make_pair(allIps[i], i));
+
+  set<int> deleteset;
+  vector<int> deletenodes;
+  int numcluster = _clusterMap.size();
+  for (int clusteridx = 0; clusteridx < numcluster; clusteridx++) {
+    Cluster* curCluster = _clusterMap[clusteridx];
+    // aggregation hops are already done
+    int curopt = curCluster->getOpt();
+    if (curopt == 3 || curopt == 4) continue;
+    if (deleteset.find(clusteridx) != deleteset.end()) continue;
+    vector<int> curChilds = curCluster->getChilds();
+    vector<int> outputs = curCluster->getParents();
+    if (outputs.size() < 1 || curChilds.size() < 3) continue;
+
+    // 0. the node holding the coefs: the parent itself, or the bind node of a BindX cluster
+    ECNode* coefnode = _ecNodeMap[outputs[0]];
+    int bindid = -1;
+    if (outputs.size() > 1) {
+      if (coefnode->getChildNum() != 1) continue;
+      coefnode = coefnode->getChildren()[0];
+      if (coefnode->getCoefmap().size() != outputs.size()) continue;
+      bindid = coefnode->getNodeId();
+    }
+    if (coefnode->getChildNum() != curChilds.size()) continue;
+    int compid = (bindid == -1) ? outputs[0] : bindid;
+
+    // 1. group childs by the helper they are placed on
+    bool placed = true;
+    unordered_map<unsigned int, vector<int>> ip2childs;
+    unordered_map<unsigned int, int> helperload;
+    vector<unsigned int> helpers;
+    for (auto c: curChilds) {
+      if (cid2ip.find(c) == cid2ip.end()) {
+        placed = false;
+        break;
+      }
+      unsigned int ip = cid2ip[c];
+      if (ip2childs.find(ip) == ip2childs.end()) {
+        vector<int> tmp={c};
+        ip2childs.insert(make_pair(ip, tmp));
+        helpers.push_back(ip);
+      } else ip2childs[ip].push_back(c);
+      helperload[ip]++;
+    }
+    if (!placed || helpers.size() < 2) continue;
+
+    // 2. order helpers: other racks first, the rack and the node of the computation last
+    unsigned int pip = cid2ip.find(compid) != cid2ip.end() ? cid2ip[compid] : 0;
+    string prack = ip2Rack.find(pip) != ip2Rack.end() ? ip2Rack[pip] : "";
+    sort(helpers.begin(), helpers.end(), [&](unsigned int a, unsigned int b) {
+      if ((a == pip) != (b == pip)) return b == pip;
+      bool ainp = ip2Rack[a] == prack;
+      bool binp = ip2Rack[b] == prack;
+      if (ainp != binp) return binp;
+      if (ip2Rack[a] != ip2Rack[b]) return ip2Rack[a] < ip2Rack[b];
+      int ao = ip2Order.find(a) != ip2Order.end() ? ip2Order[a] : allIps.size();
+      int bo = ip2Order.find(b) != ip2Order.end() ? ip2Order[b] : allIps.size();
+      if (ao != bo) return ao < bo;
+      return a < b;
+    });
+
+    // 3. choose the topology
+    int topology = AGG_CHAIN;
+    int width = outputs.size();
+    if (opt == 4 && pip != 0) {
+      double starcost = aggregationCost(AGG_STAR, helpers, helperload, width, pip, ip2Rack);
+      double chaincost = aggregationCost(AGG_CHAIN, helpers, helperload, width, pip, ip2Rack);
+      double treecost = aggregationCost(AGG_TREE, helpers, helperload, width, pip, ip2Rack);
+      if (ECDAG_DEBUG_ENABLE) cout << "ECDAG::Opt4.cost for " << compid << ": star " << starcost
+                                   << ", chain " << chaincost << ", tree " << treecost << endl;
+      if (starcost <= chaincost && starcost <= treecost) topology = AGG_STAR;
+      else if (treecost < chaincost) topology = AGG_TREE;
+    } else if (width > 1 && width >= helpers.size()) {
+      // a chain would move more partial sums than a star moves symbols
+      topology = AGG_STAR;
+    }
+    if (topology == AGG_STAR) {
+      curCluster->setOpt(opt);
+      continue;
+    }
+
+    if (ECDAG_DEBUG_ENABLE) {
+      cout << "ECDAG::aggregate." << (topology == AGG_CHAIN ? "chain" : "tree") << " for " << compid << ":";
+      for (auto ip: helpers) {
+        cout << " " << RedisUtil::ip2Str(ip) << "( ";
+        for (auto c: ip2childs[ip]) cout << c << " ";
+        cout << ")";
+      }
+      cout << endl;
+    }
+
+    // 4. the outputs no longer reference the childs directly
+    unordered_map<int, unordered_map<int, int>> out2coef;
+    for (auto out: outputs) {
+      unordered_map<int, int> child2coef;
+      for (auto c: curChilds) child2coef.insert(make_pair(c, coefnode->getCoefOfChildForParent(c, out)));
+      out2coef.insert(make_pair(out, child2coef));
+    }
+    for (auto c: curChilds) _ecNodeMap[c]->decRefNumFor(c);
+
+    // 5. build the hops, the last one (chain) or the root (tree) computes the outputs.
+    //    a hop with several outputs is a bind node, so it stays one command
+    int m = helpers.size();
+    vector<unsigned int> order = helpers;
+    if (topology == AGG_TREE) reverse(order.begin(), order.end());
+    vector<vector<int>> hopids(m);
+    for (int j=0; j<m; j++) {
+      // chains are built from the head, trees from the leaves
+      int i = (topology == AGG_CHAIN) ? j : m-1-j;
+      vector<int> previous;
+      if (topology == AGG_CHAIN) {
+        if (i > 0) previous.push_back(i-1);
+      } else {
+        if (2*i+1 < m) previous.push_back(2*i+1);
+        if (2*i+2 < m) previous.push_back(2*i+2);
+      }
+      vector<int> datav;
+      for (auto prev: previous) for (auto pid: hopids[prev]) datav.push_back(pid);
+      for (auto c: ip2childs[order[i]]) datav.push_back(c);
+
+      bool last = (topology == AGG_CHAIN) ? (i == m-1) : (i == 0);
+      for (int o=0; o<width; o++) {
+        int out = outputs[o];
+        vector<int> coefv;
+        for (auto prev: previous) {
+          for (int q=0; q<width; q++) coefv.push_back(q == o ? 1 : 0);
+        }
+        for (auto c: ip2childs[order[i]]) coefv.push_back(out2coef[out][c]);
+        int tmpid = last ? out : _optId++;
+        Join(tmpid, datav, coefv);
+        cid2ip[tmpid] = order[i];
+        hopids[i].push_back(tmpid);
+      }
+      int first = ip2childs[order[i]][0];
+      if (width > 1) {
+        int vidx = BindX(hopids[i]);
+        BindY(vidx, first);
+        for (auto tmpid: hopids[i]) BindY(tmpid, vidx);
+        cid2ip[vidx] = order[i];
+      } else {
+        BindY(hopids[i][0], first);
+      }
+      sort(datav.begin(), datav.end());
+      _clusterMap[findCluster(datav)]->setOpt(opt);
+    }
+    deleteset.insert(clusteridx);
+
+    // 6. the old bind node is replaced by the hops
+    if (bindid != -1) {
+      for (int i=0; i<numcluster; i++) {
+        if (_clusterMap[i]->childsInCluster({bindid})) deleteset.insert(i);
+      }
+      deletenodes.push_back(bindid);
+    }
+  }
+
+  // delete rewritten clusters and bind nodes
+  for (auto it=deleteset.rbegin(); it!=deleteset.rend(); it++) {
+    int idx = *it;
+    delete _clusterMap[idx];
+    _clusterMap.erase(_clusterMap.begin() + idx);
+  }
+  for (auto bindid: deletenodes) {
+    delete _ecNodeMap[bindid];
+    _ecNodeMap.erase(bindid);
+    cid2ip.erase(bindid);
+  }
+}
+
 unordered_map<int, AGCommand*> ECDAG::parseForOEC(unordered_map<int, unsigned int> cid2ip,
                                       string stripename, 
                                       int n, int k, int w, int num,
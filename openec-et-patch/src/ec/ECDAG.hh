@@ -13,6 +13,11 @@ using namespace std;
 #define BINDSTART 10200
 #define OPTSTART 10300
 
+// aggregation topologies of a wide linear combination
+#define AGG_STAR 0
+#define AGG_CHAIN 1
+#define AGG_TREE 2
+
 class ECDAG {
   private:
     unordered_map<int, ECNode*> _ecNodeMap;
@@ -21,7 +26,25 @@ class ECDAG {
     vector<Cluster*> _clusterMap;
     int _optId = OPTSTART; 
 
+    // link model for Opt4, in bytes per second
+    unordered_map<unsigned int, unordered_map<unsigned int, double>> _linkBw; // dst -> src -> measured bw
+    double _innerBw = 0;
+    double _crossBw = 0;
+    int _pktSize = 0;
+    int _pktNum = 0;
+
     int findCluster(vector<int> childs);
+    double linkBw(unsigned int src, unsigned int dst, unordered_map<unsigned int, string>& ip2Rack);
+    double aggregationCost(int topology,
+                           vector<unsigned int> helpers,
+                           unordered_map<unsigned int, int> helperload,
+                           int width,
+                           unsigned int pip,
+                           unordered_map<unsigned int, string>& ip2Rack);
+    void aggregate(int opt,
+                   unordered_map<int, unsigned int>& cid2ip,
+                   unordered_map<unsigned int, string> ip2Rack,
+                   vector<unsigned int> allIps);
   public:
     ECDAG(); 
     ~ECDAG();
@@ -44,6 +67,8 @@ class ECDAG {
                   int ecn,
                   int eck,
                   int ecw);
+    // opt 2: rack-level pipelining, opt 3: slice-level helper chain,
+    // opt 4: star/chain/tree aggregation chosen by link bandwidth (see setLinkBw)
     void optimize2(int opt, 
                   unordered_map<int, unsigned int>& cid2ip,
                   unordered_map<unsigned int, string> ip2Rack,
@@ -54,6 +79,14 @@ class ECDAG {
     void Opt0();
     void Opt1();
     void Opt2(unordered_map<int, string> n2Rack);
+    void Opt3(unordered_map<int, unsigned int>& cid2ip,
+              unordered_map<unsigned int, string> ip2Rack,
+              vector<unsigned int> allIps);
+    void Opt4(unordered_map<int, unsigned int>& cid2ip,
+              unordered_map<unsigned int, string> ip2Rack,
+              vector<unsigned int> allIps);
+    void setLinkBw(unordered_map<unsigned int, unordered_map<unsigned int, double>> linkBw,
+                   double innerBw, double crossBw, int pktSize, int pktNum);
 
     // parse cmd
     unordered_map<int, AGCommand*> parseForOEC(unordered_map<int, unsigned int> cid2ip,
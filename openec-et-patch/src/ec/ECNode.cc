@@ -406,7 +406,8 @@ AGCommand* ECNode::parseAGCommand(string stripename,
     
     // modification here
     string objname;
-    if (sid >= n) {
+    if (sid >= n && stripeobjs.find(sid) == stripeobjs.end()) {
+      // symbols beyond the stripe are shortened, unless the plan names an obj for them
       objname = stripename + "_shortening";
     } else {
       pair<string, unsigned int> curpair = stripeobjs[sid];
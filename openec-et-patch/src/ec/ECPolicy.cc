@@ -12,6 +12,10 @@ ECPolicy::ECPolicy(string id, string classname, int n, int k, int w, int opt, ve
   _param = param;
 }
 
+ECPolicy::~ECPolicy() {
+  if (_ec) delete _ec;
+}
+
 ECBase* ECPolicy::createECClass() {
   ECBase* toret;
   if (_classname == "RSCONV") {
@@ -50,10 +54,20 @@ ECBase* ECPolicy::createECClass() {
   return toret;
 }
 
+ECBase* ECPolicy::getECClass() {
+  lock_guard<mutex> lk(_ecLock);
+  if (_ec == NULL) _ec = createECClass();
+  return _ec;
+}
+
 string ECPolicy::getPolicyId() {
   return _id;
 }
 
+string ECPolicy::getClassName() {
+  return _classname;
+}
+
 int ECPolicy::getN() {
   return _n;
 }
@@ -73,3 +87,7 @@ bool ECPolicy::getLocality() {
 int ECPolicy::getOpt() {
   return _opt;
 }
+
+bool ECPolicy::isET() {
+  return _classname == "ETRSConv" || _classname == "ETAzureLRC" || _classname == "ETHHXORPlus" || _classname == "ETHTEC";
+}
@@ -29,16 +29,26 @@ class ECPolicy {
     int _opt;
 
     vector<string> _param;
+
+    // one instance shared by all requests of the policy
+    mutex _ecLock;
+    ECBase* _ec = NULL;
   public:
 //    ECPolicy(string id, string classname, int n, int k, int w, bool locality, int opt, vector<string> param);
     ECPolicy(string id, string classname, int n, int k, int w, int opt, vector<string> param);
+    ~ECPolicy();
     ECBase* createECClass();
+    // shared instance, built on first use; callers must not delete or modify it
+    ECBase* getECClass();
     string getPolicyId();
+    string getClassName();
     int getN();
     int getK();
     int getW();
     bool getLocality();
     int getOpt();
+    // a code built by elastic transformation of a base code
+    bool isET();
 };
 
 #endif
@@ -1,4 +1,5 @@
 #include "ETAzureLRC.hh"
+#include "ETRepair.hh"
 
 ETAzureLRC::ETAzureLRC(int n, int k, int w, int opt, vector<string> param) {
     _n = n;
@@ -7,6 +8,7 @@ ETAzureLRC::ETAzureLRC(int n, int k, int w, int opt, vector<string> param) {
     _opt = opt;
     //_m = _n - _k;
     _base_w = 1;
+    _num_instances = 0;
 
 
     if (param.size() < 3) {
@@ -19,7 +21,7 @@ ETAzureLRC::ETAzureLRC(int n, int k, int w, int opt, vector<string> param) {
         return;
     }
 
-    int _num_instances = atoi(param[2].c_str());
+    _num_instances = atoi(param[2].c_str());
     if (_num_instances != _w) {
         printf("error: invalid _w (for base code RS, sub-packetization must be 1)\n");
         return;
@@ -221,16 +223,15 @@ ETAzureLRC::ETAzureLRC(int n, int k, int w, int opt, vector<string> param) {
         }
     }
     printf("ETAzureLRC::ETAzureLRC finished initialization\n");
-    _ins_num = _num_instances;
 }
 
 ETAzureLRC::~ETAzureLRC() {
     for (auto ins_ptr : _instances) {
-        free(ins_ptr);
+        delete ins_ptr;
     }
 
     for (auto et_unit_ptr : _parity_et_units) {
-        free(et_unit_ptr);
+        delete et_unit_ptr;
     }
 }
 
@@ -258,7 +259,6 @@ ECDAG* ETAzureLRC::Encode() {
 
 ECDAG* ETAzureLRC::Decode(vector<int> from, vector<int> to) {
     ECDAG* ecdag = new ECDAG();
-    _num_instances = _ins_num;
     
     // num_lost_symbols * w lost symbols
     if (from.size() % _w != 0 || to.size() % _w != 0) {
@@ -433,13 +433,11 @@ ECDAG *ETAzureLRC::DecodeSingle(vector<int> from, vector<int> to) {
 }
 
 ECDAG *ETAzureLRC::DecodeMultiple(vector<int> from, vector<int> to) {
+    // decouple only the affected parity units, and decode instance by instance
+    vector<ECBase *> instances(_instances.begin(), _instances.end());
 
-    ECDAG* ecdag = new ECDAG();
-
-    // NOT implemented
-    printf("ETAzureLRC::DecodeMultiple Not implemented\n");
-
-    return ecdag;
+    ETRepair repair(this, _parity_et_units, instances);
+    return repair.Decode(from, to);
 }
 
 void ETAzureLRC::Place(vector<vector<int>>& group) {
@@ -18,7 +18,6 @@ private:
     int _m; // n - k
     int _l; // local group
     int _base_w; // w for base code
-    int _ins_num;
     int _num_instances; // number of base code instances
 
     vector<vector<int>> _uncoupled_layout; // uncoupled layout (w * n)
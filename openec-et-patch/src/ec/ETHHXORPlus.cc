@@ -1,4 +1,5 @@
 #include "ETHHXORPlus.hh"
+#include "ETRepair.hh"
 
 ETHHXORPlus::ETHHXORPlus(int n, int k, int w, int opt, vector<string> param)
 {
@@ -229,11 +230,11 @@ ETHHXORPlus::ETHHXORPlus(int n, int k, int w, int opt, vector<string> param)
 ETHHXORPlus::~ETHHXORPlus()
 {
     for (auto ins_ptr : _instances) {
-        free(ins_ptr);
+        delete ins_ptr;
     }
 
     for (auto et_unit_ptr : _parity_et_units) {
-        free(et_unit_ptr);
+        delete et_unit_ptr;
     }
 }
 
@@ -458,13 +459,11 @@ ECDAG *ETHHXORPlus::DecodeSingle(vector<int> from, vector<int> to) {
 }
 
 ECDAG *ETHHXORPlus::DecodeMultiple(vector<int> from, vector<int> to) {
+    // decouple only the affected parity units, and decode instance by instance
+    vector<ECBase *> instances(_instances.begin(), _instances.end());
 
-    ECDAG* ecdag = new ECDAG();
-
-    // NOT implemented
-    printf("ETHHXORPlus::DecodeMultiple Not implemented\n");
-
-    return ecdag;
+    ETRepair repair(this, _parity_et_units, instances);
+    return repair.Decode(from, to);
 }
 
 void ETHHXORPlus::Place(vector<vector<int>>& group) {
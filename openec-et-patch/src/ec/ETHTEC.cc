@@ -85,7 +85,13 @@ ETHTEC::ETHTEC(int n, int k, int alpha, int opt, vector<string> param) {
         }
     }
 
-    FillTransformationMaps();
+    // the transformation maps are shared by instances of the same construction
+    string tableKey = CodeTable::key("ETHTEC", _n, _k, _w, {_useLargerBase? _useLargerBaseKey : ""});
+    shared_ptr<const CodeTable::Rows> table = CodeTable::get(tableKey);
+    if (table == NULL || !RestoreTransformationMaps(*table)) {
+        FillTransformationMaps();
+        CodeTable::put(tableKey, SaveTransformationMaps());
+    }
 
     //PrintParityInfo();
 }
@@ -109,6 +115,38 @@ void ETHTEC::FillTransformationMaps() {
     //PrintSourcePackets(/* transform */ false);
 }
 
+CodeTable::Rows ETHTEC::SaveTransformationMaps() const {
+    CodeTable::Rows rows;
+    vector<int>*** maps[4] = { _transformationSourcePackets, _transformationMatrix, _reverseTransformationSourcePackets, _reverseTransformationMatrix };
+
+    // m * w rows of each map
+    for (auto map : maps) {
+        for (int i = 0; i < _m; i++) {
+            for (int j = 0; j < _w; j++) {
+                rows.push_back(*map[i][j]);
+            }
+        }
+    }
+
+    return rows;
+}
+
+bool ETHTEC::RestoreTransformationMaps(const CodeTable::Rows &rows) {
+    vector<int>*** maps[4] = { _transformationSourcePackets, _transformationMatrix, _reverseTransformationSourcePackets, _reverseTransformationMatrix };
+
+    if (rows.size() != 4 * _m * _w) { return false; }
+
+    for (int a = 0; a < 4; a++) {
+        for (int i = 0; i < _m; i++) {
+            for (int j = 0; j < _w; j++) {
+                *maps[a][i][j] = rows.at((a * _m + i) * _w + j);
+            }
+        }
+    }
+
+    return true;
+}
+
 void ETHTEC::FillMapWithPermutedIndices() {
     int p = 0, pkt = 0;
     int groupParities = _m % _numInstances == 0? _numInstances : _m; // form square matrix whenever possible
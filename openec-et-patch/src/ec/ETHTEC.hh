@@ -63,6 +63,22 @@ private:
      **/
     void FillTransformationMaps();
 
+    /**
+     * Serialize the forward and backward transformation maps as rows of a code table
+     *
+     * @return rows of the transformation maps
+     **/
+    CodeTable::Rows SaveTransformationMaps() const;
+
+    /**
+     * Restore the forward and backward transformation maps from a code table
+     *
+     * @param rows                    rows saved by an instance of the same construction
+     *
+     * @return true if the rows fit this construction, false otherwise
+     **/
+    bool RestoreTransformationMaps(const CodeTable::Rows &rows);
+
     /**
      * Fill out the forward transformation map with permuted indices 
      **/
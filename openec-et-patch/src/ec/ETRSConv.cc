@@ -1,4 +1,5 @@
 #include "ETRSConv.hh"
+#include "ETRepair.hh"
 
 #include <iomanip> // setprecision
 #include <set>
@@ -6,6 +7,8 @@
 
 const char *ETRSConv::_better_parity_repair_key= "bpr";
 const char *ETRSConv::_smooth_parity_repair_key= "spr";
+const char *ETRSConv::_data_groups_key= "dg=";
+const char *ETRSConv::_parity_groups_key= "pg=";
 
 ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
     _n = n;
@@ -34,11 +37,14 @@ ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
 
     bool better_parity_repair = false;
     bool smooth_parity_repair = false;
+    string data_groups, parity_groups;
 
     // check the parmeter for optional constructions
     for (const auto &s : param) {
         if (s == _better_parity_repair_key) { better_parity_repair = true; }
         if (s == _smooth_parity_repair_key) { smooth_parity_repair = true; }
+        if (s.find(_data_groups_key) == 0) { data_groups = s.substr(strlen(_data_groups_key)); }
+        if (s.find(_parity_groups_key) == 0) { parity_groups = s.substr(strlen(_parity_groups_key)); }
     }
 
     int symbol_id = 0;
@@ -138,6 +144,28 @@ ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
     }
 
 
+    // group sizes of the default construction: groups of num_instances nodes,
+    // the last group takes the remaining nodes
+    vector<int> data_group_sizes, parity_group_sizes;
+    num_data_groups = _k / _data_num_instances.at(0);
+    num_parity_groups = _m / _parity_num_instances.at(0);
+    for (int i = 0; i < num_data_groups; i++) {
+        int num_instances = _data_num_instances.at(0);
+        data_group_sizes.push_back((i < num_data_groups - 1) ? num_instances : (_k - num_instances * i));
+    }
+    for (int i = 0; i < num_parity_groups; i++) {
+        int num_instances = _parity_num_instances.at(0);
+        parity_group_sizes.push_back((i < num_parity_groups - 1) ? num_instances : (_m - num_instances * i));
+    }
+
+    // 0.3 an explicit construction (e.g., found by ETSearch) replaces the default one
+    if (!data_groups.empty()) {
+        ParseGroups(data_groups, _k, _w, data_group_sizes, _data_base_w, _data_num_instances);
+    }
+    if (!parity_groups.empty()) {
+        ParseGroups(parity_groups, _m, _w, parity_group_sizes, _parity_base_w, _parity_num_instances);
+    }
+
     // 1. initialize layouts, uncoupled layouts and additional symbols
 
     // 1.1 set layout (size: w * k)
@@ -164,14 +192,13 @@ ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
 
     // 2. initialize data and parity groups for elastic transformation
 
-    num_data_groups = _k / _data_num_instances.at(0);
-    num_parity_groups = _m / _parity_num_instances.at(0);
+    num_data_groups = data_group_sizes.size();
+    num_parity_groups = parity_group_sizes.size();
 
     // 2.1 data group
     for (int i = 0, grp_id = 0; i < num_data_groups; i++) {
-        int num_instances = _data_num_instances.at(0);
         vector<int> group;
-        int group_size = (i < num_data_groups - 1) ? num_instances : (_k - num_instances * i);
+        int group_size = data_group_sizes.at(i);
         for (int j = 0; j < group_size; j++) {
             group.push_back(grp_id++);
         }
@@ -181,9 +208,8 @@ ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
 
     // 2.2 parity group
     for (int i = 0, grp_id = _k; i < num_parity_groups; i++) {
-        int num_instances = _parity_num_instances.at(0);
         vector<int> group;
-        int group_size = (i < num_parity_groups - 1) ? num_instances : (_m - num_instances * i);
+        int group_size = parity_group_sizes.at(i);
         for (int j = 0; j < group_size; j++) {
             group.push_back(grp_id++);
         }
@@ -446,18 +472,18 @@ ETRSConv::ETRSConv(int n, int k, int w, int opt, vector<string> param) {
 
 ETRSConv::~ETRSConv() {
     for (auto ins_ptr : _instances) {
-        free(ins_ptr);
+        delete ins_ptr;
     }
 
     for (auto &et_units : _data_et_units) {
         for (auto et_unit_ptr : et_units) {
-            free(et_unit_ptr);
+            delete et_unit_ptr;
         }
     }
 
     for (auto &et_units : _parity_et_units) {
         for (auto et_unit_ptr : et_units) {
-            free(et_unit_ptr);
+            delete et_unit_ptr;
         }
     }
 }
@@ -564,6 +590,12 @@ ECDAG *ETRSConv::DecodeSingle(vector<int> from, vector<int> to) {
     printf("is_parity_group: %d, failed_node: %d, failed_group_idx: %d, failed_in_group_idx: %d\n",
         is_parity_group, failed_node, failed_group_idx, failed_in_group_idx);
 
+    if (failed_group_idx == -1) {
+        printf("error: node %d is not in any ET group\n", failed_node);
+        delete ecdag;
+        return NULL;
+    }
+
     int repair_bdwt = 0;
 
     int base_w = 0;
@@ -600,6 +632,12 @@ ECDAG *ETRSConv::DecodeSingle(vector<int> from, vector<int> to) {
             }
         }
 
+        if (failed_ins_id == -1) {
+            printf("error: no instance of ET unit %d repairs node %d\n", failed_et_unit_idx, failed_node);
+            delete ecdag;
+            return NULL;
+        }
+
         for (int w_idx = 0; w_idx < base_w; w_idx++) {
 
             // 3. get required uncoupled symbols for base code repair
@@ -697,6 +735,13 @@ ECDAG *ETRSConv::DecodeSingle(vector<int> from, vector<int> to) {
             //     printf("pkt_id: %d, num_required_uc_symbols: %d\n", item.first, item.second);
             // }
 
+            if (candidate_uc_symbols.size() < _k) {
+                printf("error: %lu of k = %d symbols left for the base code repair of node %d\n",
+                    candidate_uc_symbols.size(), _k, failed_node);
+                delete ecdag;
+                return NULL;
+            }
+
             // pick the first k candidate_uc_symbols
             for (size_t i = 0; i < candidate_uc_symbols.size(); i++) {
                 if (i >= _k) { // stop after k
@@ -861,13 +906,18 @@ ECDAG *ETRSConv::DecodeSingle(vector<int> from, vector<int> to) {
 }
 
 ECDAG *ETRSConv::DecodeMultiple(vector<int> from, vector<int> to) {
+    // decouple only the affected units, and decode instance by instance
+    vector<ETUnit *> units;
+    for (auto &group_units : _data_et_units) {
+        units.insert(units.end(), group_units.begin(), group_units.end());
+    }
+    for (auto &group_units : _parity_et_units) {
+        units.insert(units.end(), group_units.begin(), group_units.end());
+    }
+    vector<ECBase *> instances(_instances.begin(), _instances.end());
 
-    ECDAG* ecdag = new ECDAG();
-
-    // NOT implemented
-    printf("ETRSConv::DecodeMultiple Not implemented\n");
-
-    return ecdag;
+    ETRepair repair(this, units, instances);
+    return repair.Decode(from, to);
 }
 
 void ETRSConv::Place(vector<vector<int>>& group) {
@@ -885,3 +935,90 @@ vector<int> ETRSConv::GetNodeSymbols(int nodeid) {
 vector<vector<int>> ETRSConv::GetLayout() {
     return _layout;
 }
+
+void ETRSConv::ParseGroups(string spec, int num_nodes, int w, vector<int> &group_sizes, vector<int> &base_w, vector<int> &num_instances) {
+    // size:base_wxnum_instances;size:base_wxnum_instances;...
+    vector<int> sizes, bases, instances;
+    int total = 0;
+    size_t start = 0;
+    if (spec.empty()) {
+        throw invalid_argument("error: ET groups must not be empty.");
+    }
+    while (start <= spec.size()) {
+        size_t end = spec.find(";", start);
+        if (end == string::npos) end = spec.size();
+        string item = spec.substr(start, end - start);
+        start = end + 1;
+
+        int size = 0, base = 0, inst = 0, len = 0;
+        if (sscanf(item.c_str(), "%d:%dx%d%n", &size, &base, &inst, &len) != 3 || len != item.size()) {
+            throw invalid_argument("error: ET group " + item + " must be size:base_wxnum_instances.");
+        }
+        if (size < 1 || base < 1 || inst < 2) {
+            throw invalid_argument("error: ET group " + item + " must have a positive size and base w, and at least 2 instances.");
+        }
+        if (size < inst) {
+            throw invalid_argument("error: ET group " + item + " must have at least as many nodes as instances.");
+        }
+        if (w % (base * inst) != 0) {
+            throw invalid_argument("error: base w x instances of ET group " + item + " must divide w = " + to_string(w) + ".");
+        }
+        sizes.push_back(size);
+        bases.push_back(base);
+        instances.push_back(inst);
+        total += size;
+    }
+    if (total != num_nodes) {
+        throw invalid_argument("error: ET groups " + spec + " must cover " + to_string(num_nodes) + " nodes.");
+    }
+    if (bases.back() * instances.back() != w) {
+        throw invalid_argument("error: the last ET group of " + spec + " must reach w = " + to_string(w) + ".");
+    }
+
+    group_sizes = sizes;
+    base_w = bases;
+    num_instances = instances;
+}
+
+string ETRSConv::GetConstruction() {
+    string toret = _data_groups_key;
+    for (int i = 0; i < _data_et_groups.size(); i++) {
+        if (i > 0) toret += ";";
+        toret += to_string(_data_et_groups[i].size()) + ":" + to_string(_data_base_w[i]) + "x" + to_string(_data_num_instances[i]);
+    }
+    toret += ",";
+    toret += _parity_groups_key;
+    for (int i = 0; i < _parity_et_groups.size(); i++) {
+        if (i > 0) toret += ";";
+        toret += to_string(_parity_et_groups[i].size()) + ":" + to_string(_parity_base_w[i]) + "x" + to_string(_parity_num_instances[i]);
+    }
+    return toret;
+}
+
+string ETRSConv::Validate() {
+    for (int failed_node = 0; failed_node < _n; failed_node++) {
+        vector<int> from, to;
+        for (int i = 0; i < _n; i++) {
+            for (int j = 0; j < _w; j++) {
+                if (i == failed_node) to.push_back(i * _w + j);
+                else from.push_back(i * _w + j);
+            }
+        }
+        ECDAG *ecdag = Decode(from, to);
+        if (ecdag == NULL) {
+            return "error: node " + to_string(failed_node) + " is not repairable.";
+        }
+
+        // symbols beyond n * w are virtual, the others must survive
+        string toret;
+        for (auto cidx : ecdag->getLeaves()) {
+            if (cidx / _w == failed_node) {
+                toret = "error: the repair of node " + to_string(failed_node) + " reads its own symbol " + to_string(cidx) + ".";
+                break;
+            }
+        }
+        delete ecdag;
+        if (!toret.empty()) return toret;
+    }
+    return "";
+}
@@ -43,6 +43,8 @@ private:
 
     static const char *_better_parity_repair_key; // perfer a construction with better parity repair
     static const char *_smooth_parity_repair_key; // perfer a construction with smooth parity repair (if better parity repair is not enabled)
+    static const char *_data_groups_key; // explicit data groups, size:base_wxnum_instances;...
+    static const char *_parity_groups_key; // explicit parity groups, size:base_wxnum_instances;...
 
     ECDAG *DecodeSingle(vector<int> from, vector<int> to); // single failure decode
     ECDAG *DecodeMultiple(vector<int> from, vector<int> to); // multiple failure decode
@@ -50,6 +52,19 @@ private:
 public:
     ETRSConv(int n, int k, int w, int opt, vector<string> param);
     ~ETRSConv();
+
+    /**
+     * @brief parse explicit groups of an ET construction
+     * 
+     * @param spec size:base_wxnum_instances;... for consecutive groups of nodes
+     * @param num_nodes number of nodes the groups must cover
+     * @param w sub-packetization the last group must reach
+     * @param group_sizes 
+     * @param base_w 
+     * @param num_instances 
+     * @throw invalid_argument if spec is not a valid construction
+     */
+    static void ParseGroups(string spec, int num_nodes, int w, vector<int> &group_sizes, vector<int> &base_w, vector<int> &num_instances);
  
     ECDAG* Encode();
     ECDAG* Decode(vector<int> from, vector<int> to);
@@ -72,6 +87,24 @@ public:
      * @return vector<vector<int>> 
      */
     vector<vector<int>> GetLayout();
+
+    /**
+     * @brief Get the construction as policy parameters, which build the
+     * same code when appended to param
+     * 
+     * dg=3:1x3;3:3x3;4:9x3,pg=4:9x3
+     * 
+     * @return string 
+     */
+    string GetConstruction();
+
+    /**
+     * @brief Check that the repair of every single node decodes from the
+     * symbols of the other nodes
+     * 
+     * @return string empty if the construction is valid, otherwise the reason
+     */
+    string Validate();
 };
 
 #endif // __ET_RSCONV_HH__
@@ -0,0 +1,310 @@
+#include "ETRepair.hh"
+
+#include <iomanip> // setprecision
+
+ETRepair::ETRepair(ECBase *ec, vector<ETUnit *> units, vector<ECBase *> instances) {
+    _ec = ec;
+    _units = units;
+    _instances = instances;
+    for (auto instance : _instances) {
+        _ins_encode.push_back(instance->Encode());
+    }
+}
+
+ETRepair::~ETRepair() {
+    for (auto ecdag : _ins_encode) {
+        delete ecdag;
+    }
+}
+
+bool ETRepair::IsKnown(int symbol) {
+    return _alive.find(symbol) != _alive.end() || _joins.find(symbol) != _joins.end();
+}
+
+void ETRepair::Solved(int symbol, vector<int> children, vector<int> coefs) {
+    _joins[symbol] = make_pair(children, coefs);
+    for (auto child : children) {
+        if (_alive.find(child) != _alive.end()) {
+            _read.insert(child);
+        }
+    }
+}
+
+int ETRepair::SolveInUnit(int symbol, bool commit) {
+    for (auto unit : _units) {
+        if (!unit->HasSymbol(symbol)) {
+            continue;
+        }
+
+        // prefer the symbols read or solved so far
+        set<int> known = _read;
+        for (auto &item : _joins) {
+            known.insert(item.first);
+        }
+
+        vector<int> children, coefs;
+        if (!unit->Solve(symbol, known, children, coefs)) {
+            known.insert(_alive.begin(), _alive.end());
+            if (!unit->Solve(symbol, known, children, coefs)) {
+                return -1;
+            }
+        }
+
+        int cost = 0;
+        for (auto child : children) {
+            if (_alive.find(child) != _alive.end() && _read.find(child) == _read.end()) {
+                cost++;
+            }
+        }
+        if (commit) {
+            Solved(symbol, children, coefs);
+        }
+        return cost;
+    }
+
+    return -1;
+}
+
+bool ETRepair::DecodeInstance() {
+    int best_ins_id = -1;
+    bool best_all = false;
+    int best_cost = 0;
+    vector<int> best_solved;
+    vector<vector<int>> best_children, best_coefs;
+
+    for (int ins_id = 0; ins_id < _instances.size(); ins_id++) {
+        // 1. available uncoupled symbols of the instance, and their cost
+        vector<int> avail, unknown;
+        map<int, int> cost;
+        for (auto &row : _instances[ins_id]->GetLayout()) {
+            for (auto symbol : row) {
+                if (IsKnown(symbol)) {
+                    avail.push_back(symbol);
+                    cost[symbol] = (_alive.find(symbol) != _alive.end() && _read.find(symbol) == _read.end()) ? 1 : 0;
+                    continue;
+                }
+                int c = SolveInUnit(symbol, false);
+                if (c >= 0) {
+                    avail.push_back(symbol);
+                    cost[symbol] = c;
+                } else {
+                    unknown.push_back(symbol);
+                }
+            }
+        }
+
+        if (unknown.empty()) {
+            continue;
+        }
+
+        // 2. base code decode from the cheapest symbols
+        stable_sort(avail.begin(), avail.end(), [&](int a, int b) { return cost[a] < cost[b]; });
+        vector<vector<int>> children, coefs;
+        vector<int> solved = _ec->LinearSolve(_ins_encode[ins_id], avail, unknown, children, coefs);
+        if (solved.empty()) {
+            continue;
+        }
+
+        bool all = solved.size() == unknown.size();
+        set<int> used;
+        for (auto &symbols : children) {
+            used.insert(symbols.begin(), symbols.end());
+        }
+        int total = 0;
+        for (auto symbol : used) {
+            total += cost[symbol];
+        }
+
+        if (ETREPAIR_DEBUG_ENABLE) printf("ETRepair::DecodeInstance instance %d: %lu of %lu lost, cost %d\n", ins_id, solved.size(), unknown.size(), total);
+
+        // prefer instances decoded completely, then the cheapest, then the most decoded
+        bool better = best_ins_id == -1 || (all && !best_all) ||
+            (all == best_all && all && total < best_cost) ||
+            (all == best_all && !all && solved.size() > best_solved.size());
+        if (better) {
+            best_ins_id = ins_id;
+            best_all = all;
+            best_cost = total;
+            best_solved = solved;
+            best_children = children;
+            best_coefs = coefs;
+        }
+    }
+
+    if (best_ins_id == -1) {
+        return false;
+    }
+
+    // 3. decouple the uncoupled symbols in use, then decode
+    if (ETREPAIR_DEBUG_ENABLE) printf("ETRepair::DecodeInstance decode instance %d\n", best_ins_id);
+    for (int i = 0; i < best_solved.size(); i++) {
+        for (auto symbol : best_children[i]) {
+            if (!IsKnown(symbol)) {
+                SolveInUnit(symbol, true);
+            }
+        }
+        Solved(best_solved[i], best_children[i], best_coefs[i]);
+    }
+
+    return true;
+}
+
+void ETRepair::CollectReads(int symbol, set<int> &visited, set<int> &reads) {
+    if (_alive.find(symbol) != _alive.end()) {
+        reads.insert(symbol);
+        return;
+    }
+    if (visited.find(symbol) != visited.end() || _joins.find(symbol) == _joins.end()) {
+        return;
+    }
+    visited.insert(symbol);
+    for (auto child : _joins[symbol].first) {
+        CollectReads(child, visited, reads);
+    }
+}
+
+void ETRepair::Expand(int symbol, int coef, set<int> &lost, map<int, int> &terms) {
+    pair<vector<int>, vector<int>> &join = _joins[symbol];
+    for (int i = 0; i < join.first.size(); i++) {
+        int child = join.first[i];
+        int f = galois_single_multiply(coef, join.second[i], 8);
+        if (lost.find(child) != lost.end()) {
+            Expand(child, f, lost, terms);
+        } else {
+            terms[child] ^= f;
+        }
+    }
+}
+
+void ETRepair::Emit(int symbol, set<int> &lost, set<int> &emitted, ECDAG *ecdag) {
+    if (emitted.find(symbol) != emitted.end() || _joins.find(symbol) == _joins.end()) {
+        return;
+    }
+    emitted.insert(symbol);
+
+    // repaired symbols are expanded, so they stay headers of the ecdag
+    map<int, int> terms;
+    Expand(symbol, 1, lost, terms);
+
+    vector<int> children, coefs;
+    for (auto item : terms) {
+        if (item.second == 0) {
+            continue;
+        }
+        children.push_back(item.first);
+        coefs.push_back(item.second);
+        Emit(item.first, lost, emitted, ecdag);
+    }
+    assert(children.size() > 0);
+
+    ecdag->Join(symbol, children, coefs);
+
+    // BindX and BindY
+    ecdag->BindY(symbol, children[0]); // bind to child 0
+}
+
+ECDAG *ETRepair::Decode(vector<int> from, vector<int> to) {
+    _alive = set<int>(from.begin(), from.end());
+    _read.clear();
+    _joins.clear();
+
+    // 1. peel lost symbols by et units and base code instances
+    while (true) {
+        bool progress = false;
+        for (auto symbol : to) {
+            if (_joins.find(symbol) == _joins.end() && SolveInUnit(symbol, true) >= 0) {
+                progress = true;
+            }
+        }
+
+        int num_lost = 0;
+        for (auto symbol : to) {
+            if (_joins.find(symbol) == _joins.end()) {
+                num_lost++;
+            }
+        }
+        if (num_lost == 0 || (!progress && !DecodeInstance())) {
+            break;
+        }
+    }
+
+    // 2. solve the remaining lost symbols over the whole code, reading the
+    // symbols read so far first
+    vector<int> remaining;
+    for (auto symbol : to) {
+        if (_joins.find(symbol) == _joins.end()) {
+            remaining.push_back(symbol);
+        }
+    }
+
+    ECDAG *encode = _ec->Encode();
+    vector<vector<int>> children, coefs;
+    if (!remaining.empty()) {
+        if (ETREPAIR_DEBUG_ENABLE) printf("ETRepair::Decode solve %lu symbols over the whole code\n", remaining.size());
+        vector<int> avail;
+        for (auto symbol : from) {
+            if (_read.find(symbol) != _read.end()) {
+                avail.push_back(symbol);
+            }
+        }
+        for (auto symbol : from) {
+            if (_read.find(symbol) == _read.end()) {
+                avail.push_back(symbol);
+            }
+        }
+
+        vector<int> solved = _ec->LinearSolve(encode, avail, remaining, children, coefs);
+        if (solved.size() < remaining.size()) {
+            printf("error: %lu lost symbols are not recoverable\n", remaining.size() - solved.size());
+            delete encode;
+            return NULL;
+        }
+        for (int i = 0; i < solved.size(); i++) {
+            Solved(solved[i], children[i], coefs[i]);
+        }
+    }
+
+    // 3. when most instances are affected, decoding from whole alive nodes
+    // as a conventional repair may read less
+    set<int> peeled_read;
+    set<int> visited;
+    for (auto symbol : to) {
+        CollectReads(symbol, visited, peeled_read);
+    }
+
+    vector<int> solved = _ec->LinearSolve(encode, from, to, children, coefs);
+    delete encode;
+    set<int> conventional_read;
+    for (auto &symbols : children) {
+        conventional_read.insert(symbols.begin(), symbols.end());
+    }
+    if (solved.size() == to.size() && conventional_read.size() < peeled_read.size()) {
+        if (ETREPAIR_DEBUG_ENABLE) printf("ETRepair::Decode conventional repair reads %lu instead of %lu\n", conventional_read.size(), peeled_read.size());
+        _joins.clear();
+        for (int i = 0; i < solved.size(); i++) {
+            Solved(solved[i], children[i], coefs[i]);
+        }
+    }
+
+    // 4. ecdag of the lost symbols and the uncoupled symbols they need
+    ECDAG *ecdag = new ECDAG();
+    set<int> lost(to.begin(), to.end());
+    set<int> emitted;
+    for (auto symbol : to) {
+        Emit(symbol, lost, emitted, ecdag);
+    }
+
+    int num_packet_read = 0;
+    for (auto symbol : ecdag->getLeaves()) {
+        if (_alive.find(symbol) != _alive.end()) {
+            num_packet_read++;
+        }
+    }
+    if (ETREPAIR_DEBUG_ENABLE) {
+        cout << "ETRepair::Decode packets read = " << num_packet_read
+             << ", normalized bandwidth = " << fixed << setprecision(3) << num_packet_read * 1.0 / (_ec->_k * _ec->_w)
+             << endl;
+    }
+
+    return ecdag;
+}
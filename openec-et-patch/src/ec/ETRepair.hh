@@ -0,0 +1,82 @@
+#ifndef __ET_REPAIR_HH__
+#define __ET_REPAIR_HH__
+
+#include <map>
+#include <utility>
+
+#include "../inc/include.hh"
+#include "Computation.hh"
+
+#include "ECBase.hh"
+#include "ETUnit.hh"
+
+using namespace std;
+
+#define ETREPAIR_DEBUG_ENABLE false
+
+/**
+ * Repair of multiple failed nodes of an ET code, which couples the symbols
+ * of base code instances by et units. It peels the lost symbols in rounds:
+ *
+ * 1. a lost layout symbol is solved within its et unit once the packets
+ *    coupled with it are known (coupling or biased coupling);
+ * 2. otherwise, the instance whose lost uncoupled symbols are the cheapest
+ *    to decode is decoded by its base code, from the uncoupled symbols that
+ *    are decoupled only in the affected units, or read directly elsewhere.
+ *
+ * The symbols left when no instance can be decoded are solved over the
+ * whole code. If a conventional repair from whole alive nodes reads less,
+ * e.g., when most instances are affected, it is used instead. Repaired
+ * symbols are never inputs of other symbols, so the headers of the ecdag
+ * are the lost symbols.
+ */
+class ETRepair {
+private:
+    ECBase *_ec; // the ET code
+    vector<ETUnit *> _units; // et units of all groups
+    vector<ECBase *> _instances; // base code instances
+    vector<ECDAG *> _ins_encode; // encode ecdag of each instance
+
+    set<int> _alive; // alive layout symbols
+    set<int> _read; // alive layout symbols read so far
+    map<int, pair<vector<int>, vector<int>>> _joins; // solved symbol -> (children, coefs)
+
+    bool IsKnown(int symbol);
+    void Solved(int symbol, vector<int> children, vector<int> coefs);
+
+    /**
+     * @brief solve symbol within its et unit
+     *
+     * @param symbol
+     * @param commit record the solution
+     * @return int number of alive symbols newly read, -1 if not solvable
+     */
+    int SolveInUnit(int symbol, bool commit);
+
+    /**
+     * @brief decode the lost uncoupled symbols of the cheapest instance
+     *
+     * @return bool false if no instance can be decoded
+     */
+    bool DecodeInstance();
+
+    // alive symbols that symbol is computed from
+    void CollectReads(int symbol, set<int> &visited, set<int> &reads);
+    void Expand(int symbol, int coef, set<int> &lost, map<int, int> &terms);
+    void Emit(int symbol, set<int> &lost, set<int> &emitted, ECDAG *ecdag);
+
+public:
+    ETRepair(ECBase *ec, vector<ETUnit *> units, vector<ECBase *> instances);
+    ~ETRepair();
+
+    /**
+     * @brief decode ecdag of the lost layout symbols in to
+     *
+     * @param from alive layout symbols
+     * @param to lost layout symbols
+     * @return ECDAG* NULL if to is not recoverable
+     */
+    ECDAG *Decode(vector<int> from, vector<int> to);
+};
+
+#endif // __ET_REPAIR_HH__
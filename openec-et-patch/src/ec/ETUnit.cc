@@ -909,3 +909,134 @@ vector<int> ETUnit::GetRelatedUCSymbolsForUCSymbol(int uc_symbol_id, int ins_id)
 
     return related_uc_symbols;
 }
+
+bool ETUnit::HasSymbol(int symbol) {
+    for (int i = 0; i < _r * _base_w; i++) {
+        if (find(_layout[i].begin(), _layout[i].end(), symbol) != _layout[i].end() ||
+            find(_uncoupled_layout[i].begin(), _uncoupled_layout[i].end(), symbol) != _uncoupled_layout[i].end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ETUnit::Solve(int symbol, set<int> &known, vector<int> &children, vector<int> &coefs) {
+    children.clear();
+    coefs.clear();
+
+    int mtxr = _r * _c;
+
+    // 1. locate the packet of symbol
+    int sym_pkt_idx = -1;
+    int sym_w = -1;
+    for (int node_id = 0; node_id < _c && sym_pkt_idx == -1; node_id++) {
+        for (int ins_id = 0; ins_id < _r && sym_pkt_idx == -1; ins_id++) {
+            for (int w = 0; w < _base_w; w++) {
+                if (_layout[ins_id * _base_w + w][node_id] == symbol ||
+                    _uncoupled_layout[ins_id * _base_w + w][node_id] == symbol) {
+                    sym_pkt_idx = node_id * _r + ins_id;
+                    sym_w = w;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (sym_pkt_idx == -1) {
+        return false;
+    }
+
+    // 2. packets coupled with symbol
+    vector<int> packet_idxs;
+    packet_idxs.push_back(sym_pkt_idx);
+    for (int i = 0; i < packet_idxs.size(); i++) {
+        int pkt_idx = packet_idxs[i];
+        for (int j = 0; j < mtxr; j++) {
+            if ((_pc_matrix[pkt_idx * mtxr + j] != 0 || _pc_matrix[j * mtxr + pkt_idx] != 0) &&
+                find(packet_idxs.begin(), packet_idxs.end(), j) == packet_idxs.end()) {
+                packet_idxs.push_back(j);
+            }
+        }
+    }
+
+    // 3. equations: layout packet + sum of coupled uncoupled packets = 0;
+    // a packet without coupling has the same symbol in both layouts
+    vector<int> symbols;
+    vector<map<int, int>> equations;
+    for (auto pkt_idx : packet_idxs) {
+        map<int, int> equation;
+        int l_symbol = _layout[(pkt_idx % _r) * _base_w + sym_w][pkt_idx / _r];
+        equation[l_symbol] ^= 1;
+        for (auto uc_pkt_idx : packet_idxs) {
+            int coef = _pc_matrix[pkt_idx * mtxr + uc_pkt_idx];
+            if (coef == 0) {
+                continue;
+            }
+            int uc_symbol = _uncoupled_layout[(uc_pkt_idx % _r) * _base_w + sym_w][uc_pkt_idx / _r];
+            equation[uc_symbol] ^= coef;
+        }
+        for (auto item : equation) {
+            if (find(symbols.begin(), symbols.end(), item.first) == symbols.end()) {
+                symbols.push_back(item.first);
+            }
+        }
+        equations.push_back(equation);
+    }
+
+    // 4. eliminate the other unknown symbols, then symbol
+    vector<int> unknown;
+    for (auto s : symbols) {
+        if (s != symbol && known.find(s) == known.end()) {
+            unknown.push_back(s);
+        }
+    }
+    unknown.push_back(symbol);
+
+    int num_pivots = 0;
+    for (auto s : unknown) {
+        int pivot = -1;
+        for (int i = num_pivots; i < equations.size(); i++) {
+            if (equations[i][s] != 0) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == -1) {
+            continue;
+        }
+        swap(equations[num_pivots], equations[pivot]);
+        map<int, int> &prow = equations[num_pivots];
+        int inv = galois_single_divide(1, prow[s], 8);
+        for (auto &item : prow) {
+            item.second = galois_single_multiply(inv, item.second, 8);
+        }
+        for (int i = 0; i < equations.size(); i++) {
+            int f = equations[i][s];
+            if (i == num_pivots || f == 0) {
+                continue;
+            }
+            for (auto item : prow) {
+                equations[i][item.first] ^= galois_single_multiply(f, item.second, 8);
+            }
+        }
+        if (s == symbol) {
+            // the pivot row of symbol only has known symbols besides it
+            for (auto item : prow) {
+                if (item.first == symbol || item.second == 0) {
+                    continue;
+                }
+                if (known.find(item.first) == known.end()) {
+                    children.clear();
+                    coefs.clear();
+                    return false;
+                }
+                children.push_back(item.first);
+                coefs.push_back(item.second);
+            }
+            return !children.empty();
+        }
+        num_pivots++;
+    }
+
+    return false;
+}
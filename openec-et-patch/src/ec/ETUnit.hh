@@ -142,6 +142,27 @@ public:
      * @return vector<int> related uncoupled symbols for uc_symbol_id
      */
     vector<int> GetRelatedUCSymbolsForUCSymbol(int uc_symbol_id, int ins_id);
+
+    /**
+     * @brief Check whether symbol is a layout or uncoupled symbol of the unit
+     * 
+     * @param symbol 
+     * @return bool
+     */
+    bool HasSymbol(int symbol);
+
+    /**
+     * @brief solve a layout or uncoupled symbol from known symbols of the
+     * packets coupled with it; this covers decoupling, coupling and biased
+     * coupling when other symbols of the unit are also lost
+     * 
+     * @param symbol layout or uncoupled symbol
+     * @param known known symbols
+     * @param children known symbols that symbol is computed from
+     * @param coefs 
+     * @return bool true if symbol is solvable
+     */
+    bool Solve(int symbol, set<int> &known, vector<int> &children, vector<int> &coefs);
 };
 
 
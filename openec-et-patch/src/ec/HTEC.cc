@@ -99,8 +99,14 @@ HTEC::HTEC(int n, int k, int alpha, int opt, vector<string> param) {
         }
     }
 
-    // fill the parity information (matrix and source packet)
-    InitParityInfo();
+    // fill the parity information (matrix and source packet), the partition
+    // search only runs for a construction not seen before
+    string tableKey = CodeTable::key("HTEC", _n, _k, _w, {to_string(_targetW), to_string(_preceedW)});
+    shared_ptr<const CodeTable::Rows> table = CodeTable::get(tableKey);
+    if (table == NULL || !RestoreParityInfo(*table)) {
+        InitParityInfo();
+        CodeTable::put(tableKey, SaveParityInfo());
+    }
 }
 
 HTEC::~HTEC() {
@@ -211,6 +217,59 @@ void HTEC::InitParityInfo() {
     //PrintParityInfo(/* dense */ true);
 }
 
+CodeTable::Rows HTEC::SaveParityInfo() const {
+    CodeTable::Rows rows;
+    vector<int>*** arrays[4] = { _paritySourcePackets, _parityMatrix, _paritySourcePacketsD, _parityMatrixD };
+
+    // m * w rows of each array, then a row of (data node, subset...) for each selected subset
+    for (auto array : arrays) {
+        for (int i = 0; i < _m; i++) {
+            for (int j = 0; j < _w; j++) {
+                rows.push_back(*array[i][j]);
+            }
+        }
+    }
+    for (const auto &it : _selectedSubset) {
+        vector<int> row(1, it.first);
+        row.insert(row.end(), it.second.begin(), it.second.end());
+        rows.push_back(row);
+    }
+
+    return rows;
+}
+
+bool HTEC::RestoreParityInfo(const CodeTable::Rows &rows) {
+    vector<int>*** arrays[4] = { _paritySourcePackets, _parityMatrix, _paritySourcePacketsD, _parityMatrixD };
+    int numArrayRows = 4 * _m * _w;
+
+    if (rows.size() < numArrayRows) { return false; }
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < _m; i++) {
+            for (int j = 0; j < _w; j++) {
+                if (rows.at((a * _m + i) * _w + j).size() != GetNumSourcePackets(i)) { return false; }
+            }
+        }
+    }
+
+    for (int r = numArrayRows; r < rows.size(); r++) {
+        if (rows.at(r).empty()) { return false; }
+    }
+
+    for (int a = 0; a < 4; a++) {
+        for (int i = 0; i < _m; i++) {
+            for (int j = 0; j < _w; j++) {
+                *arrays[a][i][j] = rows.at((a * _m + i) * _w + j);
+            }
+        }
+    }
+    _selectedSubset.clear();
+    for (int r = numArrayRows; r < rows.size(); r++) {
+        _selectedSubset.emplace(make_pair(rows.at(r).at(0), vector<int>(rows.at(r).begin() + 1, rows.at(r).end())));
+    }
+
+    return true;
+}
+
 void HTEC::InitPartitionSearchMaps() {
 
     int st = 0; // step counter
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "CodeTable.hh"
 #include "ECBase.hh"
 #include "ECDAG.hh"
 
@@ -140,6 +141,22 @@ protected:
      **/
     void InitParityInfo();
 
+    /**
+     * Serialize the parity matrix, source packets and selected subsets as rows of a code table
+     *
+     * @return rows of the parity info
+     **/
+    CodeTable::Rows SaveParityInfo() const;
+
+    /**
+     * Restore the parity matrix, source packets and selected subsets from a code table
+     *
+     * @param rows                 rows saved by an instance of the same construction
+     *
+     * @return true if the rows fit this construction, false otherwise
+     **/
+    bool RestoreParityInfo(const CodeTable::Rows &rows);
+
     /**
      * Initialize the map of valid partitions
      **/
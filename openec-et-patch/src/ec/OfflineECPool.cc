@@ -8,11 +8,11 @@ OfflineECPool::OfflineECPool(string ecpoolid, ECPolicy* ecpolicy, int basesize)
 
 void OfflineECPool::addObj(string objname, string stripename) {
   _objs.insert(make_pair(objname, false));
-  if (find(_stripes.begin(), _stripes.end(), stripename) == _stripes.end())
-    _stripes.push_back(stripename);
+  // _stripe2objs indexes the stripes, a new stripe is appended to _stripes once
   unordered_map<string, vector<string>>::iterator it1 = _stripe2objs.find(stripename);
-  if (it1 != _stripe2objs.end()) _stripe2objs[stripename].push_back(objname);
+  if (it1 != _stripe2objs.end()) it1->second.push_back(objname);
   else {
+    _stripes.push_back(stripename);
     vector<string> curlist;
     curlist.push_back(objname);
     _stripe2objs.insert(make_pair(stripename, curlist));
@@ -55,9 +55,8 @@ string OfflineECPool::getStripeForObj(string objname) {
 //    cout << "OfflineECPool::getStripeForObj return " << _obj2stripe[objname] << endl;
 //    return _obj2stripe[objname];
 //  } 
-  if (_objs.find(objname) != _objs.end()) {
-    return _obj2stripe[objname];
-  }
+  unordered_map<string, string>::iterator it = _obj2stripe.find(objname);
+  if (it != _obj2stripe.end()) return it->second;
   vector<string> objlist;
   if (_stripes.size() == 0) {
     stripename = "oecstripe-"+getTimeStamp();
@@ -7,7 +7,8 @@ RSCONV::RSCONV(int n, int k, int w, int opt, vector<string> param) {
   _opt = opt;
 
   _m = _n - _k;
-  memset(_encode_matrix, 0, (_k+_m) * _k * sizeof(int));
+  // the matrix is only read by encode and decode
+  generate_matrix(_encode_matrix, _n, _k, 8);
   if(RSCONV_DEBUG_ENABLE) cout << "RSCONV::constructor ends" << endl; 
 }
 
@@ -26,7 +27,6 @@ ECDAG* RSCONV::Encode() {
     cout << endl;
   }
   
-  generate_matrix(_encode_matrix, _n, _k, 8);
   for (int i=0; i<_m; i++) {
     vector<int> coef;
     for (int j=0; j<_k; j++) {
@@ -47,12 +47,13 @@ ECDAG* RSCONV::Encode() {
 
 ECDAG* RSCONV::Decode(vector<int> from, vector<int> to) {
   ECDAG* ecdag = new ECDAG();
-  generate_matrix(_encode_matrix, _n, _k, 8);
+  // any k symbols decode, read the cheapest ones
+  vector<int> helpers = CheapestSymbols(from, _k);
   vector<int> data;
   int _select_matrix[_k*_k];
   for (int i=0; i<_k; i++) {
-    data.push_back(from[i]);
-    int sidx = from[i];
+    data.push_back(helpers[i]);
+    int sidx = helpers[i];
     memcpy(_select_matrix + i * _k,
            _encode_matrix + sidx * _k,
  	   sizeof(int) * _k);
@@ -129,7 +129,6 @@ void RSMultiIns::Encode(ECDAG *ecdag) {
     for (int i=0; i<_k; i++) data.push_back(_layout[0][i]); // only modification
     for (int i=_k; i<_n; i++) code.push_back(_layout[0][i]); // only modification
   
-    generate_cauchy_matrix(_encode_matrix, _n, _k, 8);
     for (int i=0; i<_m; i++) {
         vector<int> coef;
         for (int j=0; j<_k; j++) {
@@ -149,13 +148,14 @@ void RSMultiIns::Decode(vector<int> from, vector<int> to, ECDAG *ecdag) {
         return;
     }
 
-    generate_cauchy_matrix(_encode_matrix, _n, _k, 8);
+    // any k symbols decode, read the cheapest ones
+    vector<int> helpers = CheapestSymbols(from, _k);
     vector<int> data;
     int _select_matrix[_k*_k];
     for (int i=0; i<_k; i++) {
-        data.push_back(from[i]);
+        data.push_back(helpers[i]);
         // int sidx = from[i];
-        int sidx = find(_layout[0].begin(), _layout[0].end(), from[i]) - _layout[0].begin();
+        int sidx = find(_layout[0].begin(), _layout[0].end(), helpers[i]) - _layout[0].begin();
         memcpy(_select_matrix + i * _k,
             _encode_matrix + sidx * _k,
         sizeof(int) * _k);
@@ -179,12 +179,12 @@ void RSMultiIns::Decode(vector<int> from, vector<int> to, ECDAG *ecdag) {
     }
     if (to.size() > 1) {
         int vidx = ecdag->BindX(to);
-        ecdag->BindY(vidx, from[0]);
+        ecdag->BindY(vidx, data[0]);
         for (auto symbol : to) {
             ecdag->BindY(symbol, vidx);
         }
     } else {
-        ecdag->BindY(to[0], from[0]);
+        ecdag->BindY(to[0], data[0]);
     }
 }
 
@@ -14,7 +14,10 @@ AGCommand::~AGCommand() {
   _cmLen = 0;
 }
 
-AGCommand::AGCommand(char* reqStr) {
+AGCommand::AGCommand(char* reqStr) : AGCommand(reqStr, 0) {
+}
+
+AGCommand::AGCommand(char* reqStr, int reqLen) {
   _agCmd = reqStr;
   _cmLen = 0; 
 
@@ -34,8 +37,21 @@ AGCommand::AGCommand(char* reqStr) {
     // for shortening
     case 12: resolveType12ForShortening(); break;
 
+    // for throttling
+    case 13: resolveType13(); break;
+    case 14: resolveType14(); break;
+    case 15: resolveType15(); break;
+    case 16: resolveType16(); break;
+
     default: break;
   }
+
+  // optional priority trailer
+  if (reqLen >= _cmLen + 4) _priority = readInt();
+  if (_priority < 0 || _priority >= AG_PRIO_NUM) _priority = AG_PRIO_FOREGROUND;
+  // optional read start trailer
+  if (reqLen >= _cmLen + 4) _readStart = readInt();
+
   _agCmd = nullptr;
   _cmLen = 0;
 }
@@ -45,6 +61,12 @@ void AGCommand::writeInt(int value) {
   memcpy(_agCmd + _cmLen, (char*)&tmpv, 4); _cmLen += 4;
 }
 
+void AGCommand::writeLong(long value) {
+  // high and low 32 bits, each in network order
+  writeInt((int)(value >> 32));
+  writeInt((int)(value & 0xffffffff));
+}
+
 void AGCommand::writeString(string s) {
   int slen = s.length();
   int tmpslen = htonl(slen);
@@ -60,6 +82,12 @@ int AGCommand::readInt() {
   return ntohl(tmpint);
 }
 
+long AGCommand::readLong() {
+  long high = readInt();
+  long low = (unsigned int)readInt();
+  return (high << 32) | low;
+}
+
 string AGCommand::readString() {
   string toret;
   int slen = readInt();
@@ -170,6 +198,82 @@ int AGCommand::getBasesizeMB() {
   return _basesizeMB;
 }
 
+int AGCommand::getPriority() {
+  return _priority;
+}
+
+int AGCommand::getReadStart() {
+  return _readStart;
+}
+
+int AGCommand::getThrottlePrio() {
+  return _throttlePrio;
+}
+
+int AGCommand::getThrottleRes() {
+  return _throttleRes;
+}
+
+int AGCommand::getThrottleRateKB() {
+  return _throttleRateKB;
+}
+
+int AGCommand::getReportId() {
+  return _reportId;
+}
+
+int AGCommand::getBatchWindow() {
+  return _batchWindow;
+}
+
+vector<vector<string>> AGCommand::getBatchCmds() {
+  return _batchCmds;
+}
+
+long AGCommand::getRangeOffset() {
+  return _rangeOffset;
+}
+
+long AGCommand::getRangeLength() {
+  return _rangeLength;
+}
+
+void AGCommand::setPriority(int priority) {
+  _priority = priority;
+  // the trailer is appended once and overwritten afterwards
+  if (_prioOffset < 0) {
+    _prioOffset = _cmLen;
+    writeInt(_priority);
+  } else {
+    int tmpv = htonl(_priority);
+    memcpy(_agCmd + _prioOffset, (char*)&tmpv, 4);
+  }
+}
+
+void AGCommand::setReadStart(int startpkt) {
+  _readStart = startpkt;
+  // the read start follows the priority trailer
+  if (_prioOffset < 0) setPriority(_priority);
+  if (_startOffset < 0) {
+    _startOffset = _cmLen;
+    writeInt(_readStart);
+  } else {
+    int tmpv = htonl(_readStart);
+    memcpy(_agCmd + _startOffset, (char*)&tmpv, 4);
+  }
+}
+
+string AGCommand::laneKey(int priority, bool waits) {
+  string toret;
+  switch (priority) {
+    case AG_PRIO_REPAIR: toret = "ag_request:repair"; break;
+    case AG_PRIO_ENCODE: toret = "ag_request:encode"; break;
+    default: toret = "ag_request:fg"; break;
+  }
+  if (waits) toret += ":wait";
+  return toret;
+}
+
 void AGCommand::setRkey(string key) {
   _rKey = key;
 } 
@@ -506,6 +610,85 @@ void AGCommand::resolveType11() {
   _basesizeMB = readInt();
 }
 
+void AGCommand::buildType13(int type,
+                            int prio,
+                            int res,
+                            int rateKB) {
+  _type = type;
+  _throttlePrio = prio;
+  _throttleRes = res;
+  _throttleRateKB = rateKB;
+
+  writeInt(_type);
+  writeInt(_throttlePrio);
+  writeInt(_throttleRes);
+  writeInt(_throttleRateKB);
+}
+
+void AGCommand::resolveType13() {
+  _throttlePrio = readInt();
+  _throttleRes = readInt();
+  _throttleRateKB = readInt();
+}
+
+void AGCommand::buildType14(int type, int reqid) {
+  _type = type;
+  _reportId = reqid;
+
+  writeInt(_type);
+  writeInt(_reportId);
+}
+
+void AGCommand::resolveType14() {
+  _reportId = readInt();
+}
+
+void AGCommand::buildType15(int type,
+                     unsigned int sendIp,
+                     int window,
+                     vector<vector<AGCommand*>> stripeCmds) {
+  _shouldSend = true;
+  _type = type;
+  _sendIp = sendIp;
+  _batchWindow = window;
+
+  // the batch may exceed MAX_COMMAND_LEN
+  int len = 16 + 4;
+  for (auto cmds: stripeCmds) {
+    len += 4;
+    for (auto cmd: cmds) len += 4 + cmd->getCmdLen();
+  }
+  if (len > MAX_COMMAND_LEN) {
+    free(_agCmd);
+    _agCmd = (char*)calloc(len, sizeof(char));
+  }
+
+  writeInt(_type);
+  writeInt(_batchWindow);
+  writeInt(stripeCmds.size());
+  for (auto cmds: stripeCmds) {
+    writeInt(cmds.size());
+    for (auto cmd: cmds) {
+      writeInt(cmd->getCmdLen());
+      memcpy(_agCmd + _cmLen, cmd->getCmd(), cmd->getCmdLen()); _cmLen += cmd->getCmdLen();
+    }
+  }
+}
+
+void AGCommand::resolveType15() {
+  _batchWindow = readInt();
+  int nstripes = readInt();
+  for (int i=0; i<nstripes; i++) {
+    vector<string> cmds;
+    int ncmds = readInt();
+    for (int j=0; j<ncmds; j++) {
+      int len = readInt();
+      cmds.push_back(string(_agCmd + _cmLen, len)); _cmLen += len;
+    }
+    _batchCmds.push_back(cmds);
+  }
+}
+
 void AGCommand::buildType12ForShortening(int type,
                      unsigned int sendIp,
                      string stripeName,
@@ -557,11 +740,58 @@ void AGCommand::resolveType12ForShortening() {
   }
 }
 
+void AGCommand::buildType16(int type,
+                             string filename,
+                             long offset,
+                             long length) {
+  _type = type;
+  _filename = filename;
+  _rangeOffset = offset;
+  _rangeLength = length;
+
+  writeInt(_type);
+  writeString(_filename);
+  writeLong(_rangeOffset);
+  writeLong(_rangeLength);
+}
+
+void AGCommand::resolveType16() {
+  _filename = readString();
+  _rangeOffset = readLong();
+  _rangeLength = readLong();
+}
+
+AGCommand* AGCommand::rebind(string stripename,
+                             unordered_map<unsigned int, unsigned int> ipmap,
+                             unordered_map<string, string> objmap) {
+  unsigned int ip = ipmap.find(_sendIp) != ipmap.end() ? ipmap[_sendIp] : _sendIp;
+  vector<unsigned int> prevLocs;
+  for (auto loc: _prevLocs) prevLocs.push_back(ipmap.find(loc) != ipmap.end() ? ipmap[loc] : loc);
+  string readObjName = objmap.find(_readObjName) != objmap.end() ? objmap[_readObjName] : _readObjName;
+  string writeObjName = objmap.find(_writeObjName) != objmap.end() ? objmap[_writeObjName] : _writeObjName;
+
+  AGCommand* toret = new AGCommand();
+  switch (_type) {
+    case 2: toret->buildType2(2, ip, stripename, _ecw, _num, readObjName, _readCidList, _cacheRefs); break;
+    case 3: toret->buildType3(3, ip, stripename, _ecw, _num, _nprevs, _prevCids, prevLocs, _coefs, _cacheRefs); break;
+    case 5: toret->buildType5(5, ip, stripename, _ecw, _num, _nprevs, _prevCids, prevLocs, writeObjName); break;
+    case 7: toret->buildType7(7, ip, stripename, _ecw, _num, readObjName, _readCidList, _nprevs, _prevCids, prevLocs, _coefs, _cacheRefs); break;
+    case 12: toret->buildType12ForShortening(12, ip, stripename, _ecn, _ecw, _num, readObjName, _readCidList, _cacheRefs); break;
+    default: delete toret; return NULL;
+  }
+  toret->_shouldSend = _shouldSend;
+  if (_prioOffset >= 0) toret->setPriority(_priority);
+  if (_startOffset >= 0) toret->setReadStart(_readStart);
+  return toret;
+}
+
 void AGCommand::dump() {
   if (_type == 0) {
     cout << "AGCommand::clientWrite: " << _filename << ", ecid: " << _ecid << ", mode: " << _mode << ", size: " << _filesizeMB << endl;
   } else if (_type == 1) {
     cout << "AGCommand::clientRead: " << _filename << endl;
+  } else if (_type == 16) {
+    cout << "AGCommand::clientRead: " << _filename << ", offset: " << _rangeOffset << ", length: " << _rangeLength << endl;
   } else if (_type == 2) {
     cout << "AGCommand::Load, ip: " << RedisUtil::ip2Str(_sendIp) << " objname: " << _readObjName << ", cidlist: ";
     for (int i=0; i<_readCidList.size(); i++) cout << _readCidList[i] << " ";
@@ -6,6 +6,12 @@
 
 using namespace std;
 
+// priority classes of agent commands
+#define AG_PRIO_FOREGROUND 0
+#define AG_PRIO_REPAIR 1
+#define AG_PRIO_ENCODE 2
+#define AG_PRIO_NUM 3
+
 /*
  * OECAgent Command format
  * agent_request: type
@@ -20,9 +26,23 @@ using namespace std;
  *    type=10: (coor return cmd summary for client to online encoding)| |
  *    type=11: (coor return cmd summary for client to write obj of offline encoding)
  * 
+ *    type=13 (set throttle) | class | resource | rate KB/s | (class/resource -1 for all, rate 0 for unlimited)
+ *    type=14 (report throttle usage to coordinator) | reqid | reported to throttleusage:<reqid> |
+ *    type=15 (batch) | window | nstripes | nstripes * (ncmds | ncmds * (len | command)) |
+ *            commands of several stripes for one agent, at most window stripes run at a time
+ *    type=16 (client read a byte range) | filename | offset (8 bytes) | length (8 bytes) |
+ *
  *    below commands are only used for handling shortening packets
  *    type=12  (read disk->memory) **with n and w** | read? (| objname | unitIdx | scratio | cid |)
-
+ *
+ *    commands distributed by the coordinator may carry a trailing | priority | after
+ *    the type-specific fields. Agents route them into the lane of that priority class
+ *    (see AG_PRIO_*); commands without the trailer are foreground. Disk reads
+ *    (types 2 and 12) queue in the lane, commands that wait on other agents queue
+ *    in its wait queue, see OECWorker::waitsOnAgents.
+ *    disk reads (types 2, 7 and 12) may carry a further | readstart | after the
+ *    priority, the packet of the obj they start reading from (0 by default), so a
+ *    degraded read of a packet range only reads that range.
 
  */
 
@@ -35,6 +55,10 @@ class AGCommand {
     string _rKey;
 
     int _type;
+    int _priority = AG_PRIO_FOREGROUND;
+    int _prioOffset = -1; // offset of the priority trailer in _agCmd
+    int _readStart = 0;
+    int _startOffset = -1; // offset of the read start trailer in _agCmd
 
     // type 0
     string _filename;
@@ -84,16 +108,36 @@ class AGCommand {
     // type 11
     int _objnum;
     int _basesizeMB;
+
+    // type 13
+    int _throttlePrio;
+    int _throttleRes;
+    int _throttleRateKB;
+
+    // type 14
+    int _reportId;
+
+    // type 15
+    int _batchWindow;
+    vector<vector<string>> _batchCmds; // stripe -> serialized commands
+
+    // type 16
+    // _filename
+    long _rangeOffset;
+    long _rangeLength;
     
   public:
     AGCommand();
     ~AGCommand();
     AGCommand(char* reqStr);
+    AGCommand(char* reqStr, int reqLen);
 
     // basic construction methods
     void writeInt(int value);
+    void writeLong(long value);
     void writeString(string s);
     int readInt();
+    long readLong();
     string readString();
 
     int getType();
@@ -121,6 +165,23 @@ class AGCommand {
     int getComputen();
     int getObjnum();
     int getBasesizeMB();
+    int getPriority();
+    int getReadStart();
+    int getThrottlePrio();
+    int getThrottleRes();
+    int getThrottleRateKB();
+    int getReportId();
+    int getBatchWindow();
+    vector<vector<string>> getBatchCmds();
+    long getRangeOffset();
+    long getRangeLength();
+
+    // priority lanes
+    void setPriority(int priority);
+    // queue of a lane, or its wait queue for commands that wait on other agents
+    static string laneKey(int priority, bool waits = false);
+    // first packet read from disk, appended after the priority
+    void setReadStart(int startpkt);
 
     // send method
     void setRkey(string key);
@@ -181,6 +242,20 @@ class AGCommand {
     void buildType11(int type,
                      int objnum,
                      int basesizeMB);
+    void buildType13(int type,
+                     int prio,
+                     int res,
+                     int rateKB);
+    void buildType14(int type,
+                     int reqid);
+    void buildType15(int type,
+                     unsigned int sendIp,
+                     int window,
+                     vector<vector<AGCommand*>> stripeCmds);
+    void buildType16(int type,
+                     string filename,
+                     long offset,
+                     long length);
 
     // for shortening
     void buildType12ForShortening(int type,
@@ -193,6 +268,12 @@ class AGCommand {
                     vector<int> cidlist,
                     unordered_map<int, int> ref);
 
+    // the same ectask command for another stripe with the same placement,
+    // ips and obj names not in the maps are kept
+    AGCommand* rebind(string stripename,
+                      unordered_map<unsigned int, unsigned int> ipmap,
+                      unordered_map<string, string> objmap);
+
     // resolve AGCommand
     void resolveType0();
     void resolveType1();
@@ -202,6 +283,10 @@ class AGCommand {
     void resolveType7();
     void resolveType10();
     void resolveType11();
+    void resolveType13();
+    void resolveType14();
+    void resolveType15();
+    void resolveType16();
 
     // for shortening
     void resolveType12ForShortening();
@@ -34,9 +34,22 @@ CoorCommand::CoorCommand(char* reqStr) {
     case 9: resolveType9(); break;
     case 11: resolveType11(); break;
     case 12: resolveType12(); break;
+    case 13: resolveType13(); break;
+    case 14: resolveType14(); break;
+    case 15: resolveType15(); break;
+    case 16: resolveType16(); break;
+    case 17: resolveType17(); break;
+    case 18: resolveType18(); break;
+    case 19: resolveType19(); break;
+    case 20: resolveType20(); break;
     // ET
     case 21: resolveType21(); break;
     case 22: resolveType22(); break;
+    case 23: resolveType23(); break;
+    case 24: resolveType24(); break;
+    case 25: resolveType25(); break;
+    case 26: resolveType26(); break;
+    case 27: resolveType27(); break;
     default: break;
   }
   _coorCmd = nullptr;
@@ -115,6 +128,10 @@ string CoorCommand::getStripeName() {
   return _stripename;
 }
 
+vector<string> CoorCommand::getStripeNames() {
+  return _stripenames;
+}
+
 int CoorCommand::getOp() {
   return _op;
 }
@@ -127,10 +144,42 @@ vector<int> CoorCommand::getCorruptIdx() {
   return _corruptIdx;
 }
 
+int CoorCommand::getObjIdx() {
+  return _objIdx;
+}
+
+vector<string> CoorCommand::getObjNames() {
+  return _objnames;
+}
+
+int CoorCommand::getStartPkt() {
+  return _startPkt;
+}
+
+int CoorCommand::getPktNum() {
+  return _pktNum;
+}
+
 string CoorCommand::getBenchName() {
   return _benchname;
 }
 
+unsigned int CoorCommand::getAgentIp() {
+  return _agentIp;
+}
+
+int CoorCommand::getThrottlePrio() {
+  return _throttlePrio;
+}
+
+int CoorCommand::getThrottleRes() {
+  return _throttleRes;
+}
+
+int CoorCommand::getThrottleRateKB() {
+  return _throttleRateKB;
+}
+
 void CoorCommand::sendTo(unsigned int ip) {
   redisContext* sendCtx = RedisUtil::createContext(ip);
   redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", _rKey.c_str(), _coorCmd, _cmLen);
@@ -236,19 +285,25 @@ void CoorCommand::resolveType4() {
   _stripename = readString();
 }
 
-void CoorCommand::buildType5(int type, unsigned int ip, string objname) {
+void CoorCommand::buildType5(int type, unsigned int ip, string objname, int startpkt, int pktnum) {
   _type = type;
   _clientIp = ip;
   _filename = objname;
+  _startPkt = startpkt;
+  _pktNum = pktnum;
 
   writeInt(_type);
   writeInt(_clientIp);
   writeString(_filename);
+  writeInt(_startPkt);
+  writeInt(_pktNum);
 }
 
 void CoorCommand::resolveType5() {
   _clientIp = readInt();
   _filename = readString();
+  _startPkt = readInt();
+  _pktNum = readInt();
 }
 
 void CoorCommand::resolveType6() {
@@ -333,6 +388,136 @@ void CoorCommand::resolveType12() {
   _benchname = readString();
 }
 
+void CoorCommand::buildType13(int type,
+                              unsigned int ip,
+                              unsigned int agentip,
+                              int prio,
+                              int res,
+                              int rateKB) {
+  _type = type;
+  _clientIp = ip;
+  _agentIp = agentip;
+  _throttlePrio = prio;
+  _throttleRes = res;
+  _throttleRateKB = rateKB;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeInt(_agentIp);
+  writeInt(_throttlePrio);
+  writeInt(_throttleRes);
+  writeInt(_throttleRateKB);
+}
+
+void CoorCommand::resolveType13() {
+  _clientIp = readInt();
+  _agentIp = readInt();
+  _throttlePrio = readInt();
+  _throttleRes = readInt();
+  _throttleRateKB = readInt();
+}
+
+void CoorCommand::buildType14(int type, unsigned int ip) {
+  _type = type;
+  _clientIp = ip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+}
+
+void CoorCommand::resolveType14() {
+  _clientIp = readInt();
+}
+
+void CoorCommand::buildType15(int type, unsigned int ip, unsigned int failedip) {
+  _type = type;
+  _clientIp = ip;
+  _agentIp = failedip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeInt(_agentIp);
+}
+
+void CoorCommand::resolveType15() {
+  _clientIp = readInt();
+  _agentIp = readInt();
+}
+
+void CoorCommand::buildType16(int type, unsigned int ip) {
+  _type = type;
+  _clientIp = ip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+}
+
+void CoorCommand::resolveType16() {
+  _clientIp = readInt();
+}
+
+void CoorCommand::buildType17(int type, unsigned int ip) {
+  _type = type;
+  _clientIp = ip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+}
+
+void CoorCommand::resolveType17() {
+  _clientIp = readInt();
+}
+
+void CoorCommand::buildType18(int type, unsigned int ip) {
+  _type = type;
+  _clientIp = ip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+}
+
+void CoorCommand::resolveType18() {
+  _clientIp = readInt();
+}
+
+void CoorCommand::buildType19(int type, unsigned int ip, string poolname, vector<string> stripenames) {
+  _type = type;
+  _clientIp = ip;
+  _ecpoolid = poolname;
+  _stripenames = stripenames;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_ecpoolid);
+  writeInt(_stripenames.size());
+  for (auto stripename: _stripenames) writeString(stripename);
+}
+
+void CoorCommand::resolveType19() {
+  _clientIp = readInt();
+  _ecpoolid = readString();
+  int nstripes = readInt();
+  for (int i=0; i<nstripes; i++) _stripenames.push_back(readString());
+}
+
+void CoorCommand::buildType20(int type, unsigned int ip, string poolname, string ecid) {
+  _type = type;
+  _clientIp = ip;
+  _ecpoolid = poolname;
+  _ecid = ecid;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_ecpoolid);
+  writeString(_ecid);
+}
+
+void CoorCommand::resolveType20() {
+  _clientIp = readInt();
+  _ecpoolid = readString();
+  _ecid = readString();
+}
+
 void CoorCommand::buildType21(int type) {
   _type = type;
 
@@ -357,6 +542,89 @@ void CoorCommand::resolveType22() {
   _filename = readString();
 }
 
+void CoorCommand::buildType23(int type, unsigned int ip, string objname) {
+  _type = type;
+  _clientIp = ip;
+  _filename = objname;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_filename);
+}
+
+void CoorCommand::resolveType23() {
+  _clientIp = readInt();
+  _filename = readString();
+}
+
+void CoorCommand::buildType24(int type, unsigned int ip, string filename, int objidx) {
+  _type = type;
+  _clientIp = ip;
+  _filename = filename;
+  _objIdx = objidx;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_filename);
+  writeInt(_objIdx);
+}
+
+void CoorCommand::resolveType24() {
+  _clientIp = readInt();
+  _filename = readString();
+  _objIdx = readInt();
+}
+
+void CoorCommand::buildType25(int type, unsigned int ip) {
+  _type = type;
+  _clientIp = ip;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+}
+
+void CoorCommand::resolveType25() {
+  _clientIp = readInt();
+}
+
+void CoorCommand::buildType26(int type, unsigned int ip, vector<string> objnames) {
+  _type = type;
+  _clientIp = ip;
+  _objnames = objnames;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeInt(_objnames.size());
+  for (auto objname: _objnames) writeString(objname);
+}
+
+void CoorCommand::resolveType26() {
+  _clientIp = readInt();
+  int nobjs = readInt();
+  for (int i=0; i<nobjs; i++) _objnames.push_back(readString());
+}
+
+void CoorCommand::buildType27(int type, unsigned int ip, string poolname, string stripename, string ecid) {
+  _type = type;
+  _clientIp = ip;
+  _ecpoolid = poolname;
+  _stripename = stripename;
+  _ecid = ecid;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_ecpoolid);
+  writeString(_stripename);
+  writeString(_ecid);
+}
+
+void CoorCommand::resolveType27() {
+  _clientIp = readInt();
+  _ecpoolid = readString();
+  _stripename = readString();
+  _ecid = readString();
+}
+
 
 void CoorCommand::dump() {
   cout << "CoorCommand::type: " << _type;
@@ -377,10 +645,40 @@ void CoorCommand::dump() {
     cout << ", client: " << RedisUtil::ip2Str(_clientIp)
          << ", ecpoolid: " << _ecpoolid
          << ", stripename: " << _stripename << endl;
+  } else if (_type == 19) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", ecpoolid: " << _ecpoolid
+         << ", stripes: " << _stripenames.size() << endl;
+  } else if (_type == 26) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", objs: " << _objnames.size() << endl;
+  } else if (_type == 27) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", ecpoolid: " << _ecpoolid
+         << ", stripename: " << _stripename
+         << ", ecid: " << _ecid << endl;
+  } else if (_type == 20) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", ecpoolid: " << _ecpoolid
+         << ", ecid: " << _ecid << endl;
   } else if (_type == 6) {
     cout << ", client: " << RedisUtil::ip2Str(_clientIp)
          << ", filename: " << _filename << endl;
   } else if (_type == 7) {
     cout << ", enable: " << _op << ", ectype: " << _ectype << endl;
+  } else if (_type == 13) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", agent: " << (_agentIp ? RedisUtil::ip2Str(_agentIp) : "all")
+         << ", class: " << _throttlePrio << ", resource: " << _throttleRes
+         << ", rate: " << _throttleRateKB << " KB/s" << endl;
+  } else if (_type == 15) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", failed: " << RedisUtil::ip2Str(_agentIp) << endl;
+  } else if (_type == 5) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", objname: " << _filename << ", packets: " << _startPkt << "+" << _pktNum << endl;
+  } else if (_type == 24) {
+    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename << ", objidx: " << _objIdx << endl;
   }
 }
@@ -14,7 +14,7 @@ using namespace std;
  *   type = 2: clientip | filename |
  *   type = 3: clientip | filename | get redundancyType, filesize, ecid|
  *   type = 4: clientip | poolname | stripename |
- *   type = 5: clientip | objname // offline degraded for object
+ *   type = 5: clientip | objname | startpkt | pktnum | // offline degraded for packets of an object, pktnum -1 for all
  *   type = 5: clientip | filename | poolname | stripename |
  *   type = 6: clientip | filename |   // report lost
  *   type = 7:  0 (disable)/ 1 (enable) | encode/repair
@@ -23,9 +23,22 @@ using namespace std;
  *  ? type = 10: clientip| filename |  // update lostmap in stripestore
  *   type = 11: clientip| filename |   // report successfully repair
  *   type = 12: clientip | benchname | 
+ *   type = 13: clientip | agentip (0 for all) | class | resource | rate KB/s |  // set throttle
+ *   type = 14: clientip |  // collect throttle usage of agents
+ *   type = 15: clientip | failedip |  // recover all the objects of a failed agent
+ *   type = 16: clientip |  // progress of the node recovery
+ *   type = 17: clientip |  // metadata memory usage of the stripestore
+ *   type = 18: clientip |  // planning queue depth and latency of the coordinator
+ *   type = 19: clientip | poolname | nstripes | stripename * nstripes |  // offline encode a batch of stripes
+ *   type = 20: clientip | poolname | ecid |  // convert the encoded stripes of a pool in place to ecid
  *   
  *   type = 21: // get hdfs metadata and save in stripe store
  *   type = 22: clientip | objname // offline degraded for object for ET
+ *   type = 23: clientip | objname // a degraded read decoded the whole object, persist it from the client
+ *   type = 24: clientip | filename | objidx |  // overwrite an obj of an offline-encoded file from the client, updating parity by delta
+ *   type = 25: clientip |  // report of the last sub-packetization tiering round
+ *   type = 26: clientip | nobjs | objname * nobjs |  // stripestore sends a batch of repair requests
+ *   type = 27: clientip | poolname | stripename | ecid |  // stripestore sends the conversion of a stripe of a pool to ecid
  */
 
 
@@ -51,8 +64,23 @@ class CoorCommand {
     string _ecpoolid;
     string _stripename;
 
+    // type 19
+    // _ecpoolid
+    vector<string> _stripenames;
+
+    // type 20
+    // _ecpoolid
+    // _ecid
+
+    // type 27
+    // _ecpoolid
+    // _stripename
+    // _ecid
+
     // type 5
     // _filename
+    int _startPkt;
+    int _pktNum;
 
     // type 6
     // _filename
@@ -68,6 +96,22 @@ class CoorCommand {
     // type12
     string _benchname;
 
+    // type13
+    unsigned int _agentIp;
+    int _throttlePrio;
+    int _throttleRes;
+    int _throttleRateKB;
+
+    // type15
+    // _agentIp is the failed agent
+
+    // type24
+    // _filename
+    int _objIdx;
+
+    // type26
+    vector<string> _objnames;
+
   public:
     CoorCommand();
     ~CoorCommand();
@@ -89,10 +133,19 @@ class CoorCommand {
     int getNumOfReplicas();
     string getECPoolId();
     string getStripeName();
+    vector<string> getStripeNames();
     int getOp();
     string getECType();
     vector<int> getCorruptIdx();
     string getBenchName();
+    unsigned int getAgentIp();
+    int getThrottlePrio();
+    int getThrottleRes();
+    int getThrottleRateKB();
+    int getObjIdx();
+    vector<string> getObjNames();
+    int getStartPkt();
+    int getPktNum();
 
     // send method
     void sendTo(unsigned int ip);
@@ -117,7 +170,9 @@ class CoorCommand {
                     string stripename);
     void buildType5(int type,
                     unsigned int ip,
-                    string objname);
+                    string objname,
+                    int startpkt = 0,
+                    int pktnum = -1);
     void buildType7(int type,
                     int op,
                     string ectype);
@@ -131,10 +186,51 @@ class CoorCommand {
     void buildType12(int type,
                      unsigned int ip,
                      string benchname);
+    void buildType13(int type,
+                     unsigned int ip,
+                     unsigned int agentip,
+                     int prio,
+                     int res,
+                     int rateKB);
+    void buildType14(int type,
+                     unsigned int ip);
+    void buildType15(int type,
+                     unsigned int ip,
+                     unsigned int failedip);
+    void buildType16(int type,
+                     unsigned int ip);
+    void buildType17(int type,
+                     unsigned int ip);
+    void buildType18(int type,
+                     unsigned int ip);
+    void buildType19(int type,
+                     unsigned int ip,
+                     string poolname,
+                     vector<string> stripenames);
+    void buildType20(int type,
+                     unsigned int ip,
+                     string poolname,
+                     string ecid);
     void buildType21(int type);
     void buildType22(int type,
                     unsigned int ip,
                     string objname);
+    void buildType23(int type,
+                     unsigned int ip,
+                     string objname);
+    void buildType24(int type,
+                     unsigned int ip,
+                     string filename,
+                     int objidx);
+    void buildType25(int type, unsigned int ip);
+    void buildType26(int type,
+                     unsigned int ip,
+                     vector<string> objnames);
+    void buildType27(int type,
+                     unsigned int ip,
+                     string poolname,
+                     string stripename,
+                     string ecid);
     // resolve CoorCommand
     void resolveType0();
     void resolveType1();
@@ -148,8 +244,21 @@ class CoorCommand {
     void resolveType9();
     void resolveType11();
     void resolveType12();
+    void resolveType13();
+    void resolveType14();
+    void resolveType15();
+    void resolveType16();
+    void resolveType17();
+    void resolveType18();
+    void resolveType19();
+    void resolveType20();
     void resolveType21();
     void resolveType22();
+    void resolveType23();
+    void resolveType24();
+    void resolveType25();
+    void resolveType26();
+    void resolveType27();
 
     // for debug
     void dump();